@@ -0,0 +1,317 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <ctime>
+#include "core/event_queue.hpp"
+#include "utils/logger.hpp"
+
+using namespace crossexpand;
+
+namespace {
+
+struct RunResult {
+    double seconds;
+    uint64_t lost;        // Pushed but never popped
+    uint64_t duplicated;  // Popped more than once
+};
+
+// Producers push events_per_producer events each (retrying while the ring is full),
+// consumers pop until all have arrived. Every event is tagged by keycode and counted.
+template<typename Queue>
+RunResult RunQueue(size_t producers, size_t consumers, int events_per_producer) {
+    Queue queue;
+    const uint64_t total = static_cast<uint64_t>(producers) * events_per_producer;
+    std::vector<std::atomic<uint8_t>> seen(total);
+    std::atomic<uint64_t> popped{0};
+    std::atomic<bool> start{false};
+    
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            while (!start.load(std::memory_order_acquire)) std::this_thread::yield();
+            for (int i = 0; i < events_per_producer; ++i) {
+                SimpleKeyEvent key(static_cast<int>(p * events_per_producer + i), 'x', true);
+                while (!queue.push(key)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (size_t c = 0; c < consumers; ++c) {
+        threads.emplace_back([&] {
+            while (!start.load(std::memory_order_acquire)) std::this_thread::yield();
+            ProcessingEvent event;
+            while (popped.load(std::memory_order_relaxed) < total) {
+                if (queue.pop(event)) {
+                    seen[event.key_event.keycode].fetch_add(1, std::memory_order_relaxed);
+                    popped.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    
+    RunResult result{std::chrono::duration<double>(end - begin).count(), 0, 0};
+    for (auto& count : seen) {
+        uint8_t n = count.load();
+        if (n == 0) result.lost++;
+        if (n > 1) result.duplicated += n - 1;
+    }
+    return result;
+}
+
+void Report(const char* name, size_t producers, size_t consumers, uint64_t events, const RunResult& result) {
+    std::cout << std::setw(10) << name << std::setw(6) << producers << std::setw(6) << consumers
+              << std::setw(14) << std::fixed << std::setprecision(2) << events / result.seconds / 1e6
+              << std::setw(10) << result.lost << std::setw(10) << result.duplicated << "\n";
+}
+
+// The worker loop before wait_pop: poll, sleep 10 ms when empty
+bool SleepPoll(EventQueue& queue, ProcessingEvent& event, std::chrono::nanoseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!queue.pop(event)) {
+        if (std::chrono::steady_clock::now() >= deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+}
+
+double ThreadCpuMicros() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// Push-to-pop latency of isolated keystrokes, and CPU burnt by a consumer with no input
+template<typename WaitFn>
+void RunHandoff(const char* name, WaitFn wait) {
+    const int keystrokes = 200;
+    EventQueue queue;
+    std::vector<double> latencies;
+    
+    std::thread consumer([&] {
+        ProcessingEvent event;
+        while (static_cast<int>(latencies.size()) < keystrokes) {
+            if (wait(queue, event, std::chrono::milliseconds(100))) {
+                auto latency = std::chrono::steady_clock::now() - event.timestamp;
+                latencies.push_back(std::chrono::duration<double, std::micro>(latency).count());
+            }
+        }
+    });
+    for (int i = 0; i < keystrokes; ++i) {
+        std::this_thread::sleep_for(std::chrono::microseconds(1000 + (i * 7919) % 3000));  // Typing gaps
+        queue.push(SimpleKeyEvent(i, 'k', true));
+    }
+    consumer.join();
+    std::sort(latencies.begin(), latencies.end());
+    
+    double idle_cpu = 0;
+    std::thread idle([&] {
+        ProcessingEvent event;
+        double before = ThreadCpuMicros();
+        wait(queue, event, std::chrono::milliseconds(500));
+        idle_cpu = (ThreadCpuMicros() - before) * 2;  // Per second
+    });
+    idle.join();
+    
+    std::cout << std::setw(12) << name << std::setw(12) << std::fixed << std::setprecision(1)
+              << latencies[keystrokes / 2] << std::setw(12) << latencies[keystrokes * 99 / 100]
+              << std::setw(16) << idle_cpu << "\n";
+}
+
+// One producer pasting events_total events in batches, one consumer draining in batches;
+// batch 0 means the single-event push()/pop() calls
+double RunBatches(size_t batch, uint64_t events_total) {
+    EventQueue queue;
+    std::atomic<bool> start{false};
+    
+    std::thread producer([&] {
+        std::vector<ProcessingEvent> events(std::max<size_t>(batch, 1), ProcessingEvent(SimpleKeyEvent(1, 'p', true)));
+        while (!start.load(std::memory_order_acquire)) std::this_thread::yield();
+        for (uint64_t sent = 0; sent < events_total;) {
+            size_t n = std::min<uint64_t>(events.size(), events_total - sent);
+            size_t queued = batch == 0 ? queue.push(events[0]) : queue.push_batch(events.data(), n);
+            if (queued == 0) std::this_thread::yield();
+            sent += queued;
+        }
+    });
+    
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+    std::vector<ProcessingEvent> out(std::max<size_t>(batch, 1));
+    for (uint64_t received = 0; received < events_total;) {
+        size_t n = batch == 0 ? queue.pop(out[0]) : queue.pop_batch(out.data(), out.size());
+        if (n == 0) std::this_thread::yield();
+        received += n;
+    }
+    producer.join();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+// Overload: a CRITICAL stream plus a LOW trickle arriving faster than one worker drains
+// them (each event costs ~2 us of "processing"); per-level outcome under a scheduler
+void RunOverload(const char* name, const SchedulerConfig& scheduler) {
+    EventQueue queue(scheduler);
+    auto work = [] {
+        auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(2);
+        while (std::chrono::steady_clock::now() < until) {
+            // Busy
+        }
+    };
+    
+    ProcessingEvent event;
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(400);
+    for (uint64_t i = 0; std::chrono::steady_clock::now() < end; ++i) {
+        queue.push(SimpleKeyEvent(1, 'c', true), EventPriority::CRITICAL);
+        if (i % 4 == 0) {
+            queue.push(SimpleKeyEvent(2, 'l', true), EventPriority::LOW);
+        }
+        if (queue.pop(event)) {
+            work();
+        }
+    }
+    
+    auto stats = queue.get_stats();
+    for (size_t level : {3, 0}) {
+        const WaitHistogram& waits = stats.wait_times[level];
+        std::cout << std::setw(10) << name << std::setw(10) << (level == 3 ? "CRITICAL" : "LOW")
+                  << std::setw(10) << waits.total << std::setw(10) << stats.drops_by_priority[level]
+                  << std::setw(10) << waits.percentile_micros(0.5) << std::setw(10) << waits.percentile_micros(0.99)
+                  << std::setw(10) << waits.slo_misses << "\n";
+    }
+}
+
+// A pasted burst of key presses and releases, pushed as fast as the input thread can,
+// drained by one worker spending ~1 us per event
+void RunBurst(const char* name, OverflowPolicy policy) {
+    const int keystrokes = 50000;
+    OverflowConfig overflow;
+    overflow.policy = policy;
+    uint64_t reported = 0;
+    overflow.on_drops = [&reported](const std::array<uint64_t, EVENT_PRIORITY_LEVELS>& dropped) {
+        for (uint64_t count : dropped) reported += count;
+    };
+    EventQueue queue(SchedulerConfig(), overflow);
+    
+    std::atomic<bool> done{false};
+    std::thread worker([&] {
+        ProcessingEvent event;
+        while (!done.load() || queue.total_size() > 0) {
+            if (queue.pop(event)) {
+                auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(1);
+                while (std::chrono::steady_clock::now() < until) {
+                    // Busy
+                }
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+    
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < keystrokes; ++i) {
+        queue.push(SimpleKeyEvent(i, 'p', true));
+        queue.push(SimpleKeyEvent(i, 'p', false));
+    }
+    double push_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    done.store(true);
+    worker.join();
+    queue.shutdown();  // Reports the tail of the burst
+    
+    auto stats = queue.get_stats();
+    std::cout << std::setw(10) << name << std::setw(10) << stats.total_popped << std::setw(10) << stats.total_dropped
+              << std::setw(10) << stats.coalesced << std::setw(10) << stats.total_spilled << std::setw(10) << reported
+              << std::setw(12) << std::fixed << std::setprecision(1) << push_ms << "\n";
+}
+
+} // namespace
+
+void BenchEventQueueOverflow() {
+    std::cout << "\nBurst of 50000 keystrokes (press + release) into one worker\n";
+    std::cout << std::setw(10) << "policy" << std::setw(10) << "handled" << std::setw(10) << "dropped"
+              << std::setw(10) << "folded" << std::setw(10) << "spilled" << std::setw(10) << "reported"
+              << std::setw(12) << "push ms" << "\n";
+    
+    RunBurst("drop", OverflowPolicy::DROP);
+    RunBurst("block", OverflowPolicy::BLOCK);
+    RunBurst("spill", OverflowPolicy::SPILL);
+    RunBurst("coalesce", OverflowPolicy::COALESCE);
+}
+
+void BenchEventQueueScheduling() {
+    std::cout << "\nScheduling under overload (wait in us, log2 bucket upper bounds)\n";
+    std::cout << std::setw(10) << "policy" << std::setw(10) << "level" << std::setw(10) << "served"
+              << std::setw(10) << "dropped" << std::setw(10) << "p50" << std::setw(10) << "p99"
+              << std::setw(10) << "slo miss" << "\n";
+    
+    // SLO misses are only counted where max_wait is set (weighted() with aging)
+    RunOverload("strict", SchedulerConfig::strict());
+    
+    SchedulerConfig weighted = SchedulerConfig::weighted();
+    weighted.max_wait.fill(std::chrono::microseconds::zero());
+    RunOverload("weighted", weighted);
+    RunOverload("aging", SchedulerConfig::weighted());
+}
+
+void BenchEventQueueBatching() {
+    std::cout << "\nBatched push/pop, 1 producer -> 1 consumer\n";
+    std::cout << std::setw(12) << "batch" << std::setw(14) << "Mevents/s" << std::setw(12) << "speedup" << "\n";
+    
+    const uint64_t events = 2000000;
+    double single = 0;
+    for (size_t batch : {0, 1, 8, 64}) {
+        double seconds = RunBatches(batch, events);
+        if (batch == 0) single = seconds;
+        std::cout << std::setw(12) << (batch == 0 ? std::string("push/pop") : std::to_string(batch))
+                  << std::setw(14) << std::fixed << std::setprecision(2) << events / seconds / 1e6
+                  << std::setw(11) << single / seconds << "x\n";
+    }
+}
+
+void BenchEventQueueHandoff() {
+    std::cout << "\nKeystroke handoff to a waiting worker\n";
+    std::cout << std::setw(12) << "wait" << std::setw(12) << "p50 us" << std::setw(12) << "p99 us"
+              << std::setw(16) << "idle cpu us/s" << "\n";
+    
+    RunHandoff("sleep 10ms", SleepPoll);
+    RunHandoff("wait_pop", [](EventQueue& queue, ProcessingEvent& event, std::chrono::nanoseconds timeout) {
+        return queue.wait_pop(event, timeout);
+    });
+}
+
+void BenchEventQueueScaling() {
+    std::cout << "\nEvent queue throughput (" << std::thread::hardware_concurrency() << " cores)\n";
+    std::cout << std::setw(10) << "ring" << std::setw(6) << "prod" << std::setw(6) << "cons"
+              << std::setw(14) << "Mevents/s" << std::setw(10) << "lost" << std::setw(10) << "dup" << "\n";
+    
+    const uint64_t events = 400000;
+    
+    // SPSC is only valid with one thread on each side
+    Report("spsc", 1, 1, events, RunQueue<SpscEventQueue>(1, 1, events));
+    for (size_t threads : {1, 2, 4, 8}) {
+        Report("mpmc", threads, threads, events, RunQueue<EventQueue>(threads, threads, static_cast<int>(events / threads)));
+    }
+}
+
+int main() {
+    // Full rings are retried, not dropped; keep the per-drop warnings out of the timing
+    Logger::Instance().SetLevel(LogLevel::ERROR);
+    BenchEventQueueScaling();
+    BenchEventQueueBatching();
+    BenchEventQueueHandoff();
+    BenchEventQueueScheduling();
+    BenchEventQueueOverflow();
+    return 0;
+}
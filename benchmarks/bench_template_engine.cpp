@@ -0,0 +1,569 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <regex>
+#include <string>
+#include <vector>
+#include <thread>
+#include <functional>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <unordered_set>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <nlohmann/json.hpp>
+#include "core/template_engine.hpp"
+#include "core/advanced_template_engine.hpp"
+#include "core/template_store.hpp"
+#include "core/trigger_matcher.hpp"
+#include "utils/config_manager.hpp"
+#include "utils/logger.hpp"
+#include "utils/time_formatter.hpp"
+#include "utils/fast_random.hpp"
+
+using namespace crossexpand;
+
+// Heap allocations made by this process, for per-expansion allocation counts
+static std::atomic<uint64_t> g_allocations{0};
+
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+// GCC cannot see that operator new above is malloc-backed
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+#pragma GCC diagnostic pop
+
+namespace {
+
+// Pre-tokenization implementation of TemplateEngine::ExpandVariables, kept as the baseline
+std::string LegacyExpandVariables(const std::string& text, const Context& context) {
+    std::string result = text;
+    
+    std::regex var_regex(R"(\{([^}]+)\})");
+    std::smatch match;
+    
+    while (std::regex_search(result, match, var_regex)) {
+        auto it = context.find(match[1].str());
+        std::string replacement = it != context.end() ? it->second : "";
+        result = std::regex_replace(result, var_regex, replacement, std::regex_constants::format_first_only);
+    }
+    
+    return result;
+}
+
+std::string MakeTemplate(size_t paragraphs) {
+    std::string text;
+    for (size_t i = 0; i < paragraphs; ++i) {
+        text += "Dear {name},\nThank you for contacting {company} support regarding ticket {ticket}. ";
+        text += "Our team in {city} will get back to you within {sla} business days.\n";
+    }
+    text += "Best regards,\n{name}\n{title}\n{company}\n";
+    return text;
+}
+
+template<typename Fn>
+double TimePerCallMicros(int iterations, Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        fn();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::micro>(elapsed).count() / iterations;
+}
+
+} // namespace
+
+void BenchBasicExpansion() {
+    std::cout << "TemplateEngine::Expand (segments) vs legacy regex path\n";
+    std::cout << std::setw(12) << "bytes" << std::setw(16) << "legacy us"
+              << std::setw(16) << "segments us" << std::setw(12) << "speedup" << "\n";
+    
+    Context context{
+        {"name", "Alice Example"}, {"company", "Tech Company Inc."}, {"ticket", "#48213"},
+        {"city", "Anytown"}, {"sla", "2"}, {"title", "Support Engineer"}
+    };
+    
+    for (size_t paragraphs : {1, 8, 32, 128}) {
+        std::string text = MakeTemplate(paragraphs);
+        
+        TemplateEngine engine;
+        engine.AddTemplate("/bench", Template(text));
+        
+        if (engine.Expand("/bench", context) != LegacyExpandVariables(text, context)) {
+            std::cerr << "Mismatch between legacy and segment expansion\n";
+            return;
+        }
+        
+        int iterations = paragraphs >= 32 ? 20 : 500;
+        double legacy = TimePerCallMicros(iterations, [&]() {
+            volatile size_t n = LegacyExpandVariables(text, context).size();
+            (void)n;
+        });
+        double segments = TimePerCallMicros(iterations * 20, [&]() {
+            volatile size_t n = engine.Expand("/bench", context).size();
+            (void)n;
+        });
+        
+        std::cout << std::setw(12) << text.size() << std::setw(16) << std::fixed << std::setprecision(2) << legacy
+                  << std::setw(16) << segments << std::setw(11) << std::setprecision(1) << legacy / segments << "x\n";
+    }
+}
+
+void BenchContextExpansion() {
+    std::cout << "\nexpand_advanced(Context) allocations\n";
+    std::cout << std::setw(22) << "template" << std::setw(14) << "allocs/call" << std::setw(14) << "ns/call" << "\n";
+    
+    AdvancedTemplateEngine engine;
+    engine.SetVariable("company", "Tech Company Inc.");
+    engine.add_advanced_template("/greeting", "Hi {{name}}, thanks for contacting {{company}} about {{ticket}}.");
+    engine.add_advanced_template("/loop", "{%for item in items%}- {{upper(item)}}\n{%endfor%}{%if vip%}VIP{%endif%}");
+    engine.add_advanced_template("/stamp", "{{name}} at {{current_time}}");
+    Context context = {{"name", "Alice"}, {"ticket", "#48213"}, {"items", "a\nb\nc"}, {"vip", "true"}};
+    
+    const int iterations = 100000;
+    for (const char* shortcut : {"/greeting", "/loop", "/stamp"}) {
+        engine.expand_advanced(shortcut, context);  // Warm per-thread state
+        uint64_t before = g_allocations.load();
+        double micros = TimePerCallMicros(iterations, [&] {
+            volatile size_t n = engine.expand_advanced(shortcut, context).size();
+            (void)n;
+        });
+        double allocations = static_cast<double>(g_allocations.load() - before) / iterations;
+        std::cout << std::setw(22) << shortcut << std::setw(14) << std::fixed << std::setprecision(2) << allocations
+                  << std::setw(14) << std::setprecision(1) << micros * 1000 << "\n";
+    }
+}
+
+void BenchTriggerMatching() {
+    std::cout << "\nPer-keystroke trigger detection: suffix probing vs TriggerAutomaton\n";
+    std::cout << std::setw(12) << "shortcuts" << std::setw(16) << "probe ns/key"
+              << std::setw(18) << "automaton ns/key" << std::setw(14) << "states" << "\n";
+    
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    
+    std::string keystrokes;
+    for (int i = 0; i < 1 << 20; ++i) {
+        keystrokes += (i % 7 == 0) ? ' ' : static_cast<char>(letter(rng));
+    }
+    
+    for (size_t count : {100, 1000, 10000, 50000}) {
+        std::vector<std::string> shortcuts;
+        std::unordered_set<std::string> lookup;
+        size_t max_length = 0;
+        for (size_t i = 0; i < count; ++i) {
+            std::string shortcut = "/";
+            size_t length = 3 + i % 6;
+            for (size_t j = 0; j < length; ++j) {
+                shortcut += static_cast<char>(letter(rng));
+            }
+            max_length = std::max(max_length, shortcut.size());
+            lookup.insert(shortcut);
+            shortcuts.push_back(shortcut);
+        }
+        
+        // Baseline: rolling typed sequence, probe every suffix against the shortcut set
+        size_t probe_matches = 0;
+        auto start = std::chrono::steady_clock::now();
+        std::string sequence;
+        for (char c : keystrokes) {
+            sequence += c;
+            if (sequence.size() > max_length) {
+                sequence.erase(0, sequence.size() - max_length);
+            }
+            for (size_t len = 1; len <= sequence.size(); ++len) {
+                if (lookup.count(sequence.substr(sequence.size() - len))) {
+                    probe_matches++;
+                    break;
+                }
+            }
+        }
+        double probe_ns = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count() / keystrokes.size();
+        
+        auto automaton = TriggerAutomaton::build(shortcuts);
+        size_t automaton_matches = 0;
+        uint32_t state = TriggerAutomaton::ROOT;
+        start = std::chrono::steady_clock::now();
+        for (char c : keystrokes) {
+            state = automaton->step(state, c);
+            if (automaton->match(state)) {
+                automaton_matches++;
+            }
+        }
+        double automaton_ns = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count() / keystrokes.size();
+        
+        std::cout << std::setw(12) << count << std::setw(16) << std::fixed << std::setprecision(1) << probe_ns
+                  << std::setw(18) << automaton_ns << std::setw(14) << automaton->state_count()
+                  << (probe_matches == automaton_matches ? "" : "  (match count differs)") << "\n";
+    }
+}
+
+void BenchLoopExpansion() {
+    std::cout << "\nAdvancedTemplate {%for%} over 10k items\n";
+    std::cout << std::setw(12) << "source" << std::setw(16) << "ns/iteration" << std::setw(16) << "output bytes" << "\n";
+    
+    constexpr int ROWS = 10000;
+    std::string rows;
+    for (int i = 0; i < ROWS; ++i) {
+        rows += "row-" + std::to_string(i) + "\n";
+    }
+    
+    // Provider cursor formats each item on demand, so no list is ever materialized
+    struct RowCursor : ListCursor {
+        int index = 0;
+        std::string current;
+        bool next(std::string_view& item) override {
+            if (index == ROWS) return false;
+            current = "row-" + std::to_string(index++);
+            item = current;
+            return true;
+        }
+    };
+    
+    AdvancedTemplateEngine engine;
+    engine.register_list_provider("generated", [](const Context&) { return std::make_unique<RowCursor>(); });
+    engine.add_advanced_template("/context", "{%for r in rows%}<li>{{r}}</li>\n{%endfor%}");
+    engine.add_advanced_template("/provider", "{%for r in generated%}<li>{{r}}</li>\n{%endfor%}");
+    
+    Context context{{"rows", rows}};
+    for (const char* shortcut : {"/context", "/provider"}) {
+        size_t bytes = 0;
+        double micros = TimePerCallMicros(20, [&]() { bytes = engine.expand_advanced(shortcut, context).size(); });
+        std::cout << std::setw(12) << shortcut + 1 << std::setw(16) << std::fixed << std::setprecision(1)
+                  << micros * 1000.0 / ROWS << std::setw(16) << bytes << "\n";
+    }
+    
+    // Streaming: the first chunk is available long before the full expansion completes
+    using Clock = std::chrono::steady_clock;
+    double first_us = 0, total_us = 0;
+    constexpr int RUNS = 20;
+    for (int run = 0; run < RUNS; ++run) {
+        auto start = Clock::now();
+        bool first = true;
+        engine.expand_advanced_streaming("/context", context, [&](std::string_view) {
+            if (first) {
+                first = false;
+                first_us += std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+            }
+            return true;
+        });
+        total_us += std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    }
+    std::cout << "  streaming: first chunk " << std::setprecision(1) << first_us / RUNS << " us, total "
+              << total_us / RUNS << " us\n";
+}
+
+void BenchAdvancedCompile() {
+    std::cout << "\nAdvancedTemplate compile throughput\n";
+    std::cout << std::setw(22) << "workload" << std::setw(14) << "templates" << std::setw(14) << "MB/s" << "\n";
+    
+    auto report = [](const char* name, const std::vector<std::pair<std::string, std::string>>& sources) {
+        size_t bytes = 0;
+        for (const auto& entry : sources) bytes += entry.second.size();
+        
+        AdvancedTemplateEngine engine;
+        auto start = std::chrono::steady_clock::now();
+        size_t added = engine.add_advanced_templates(sources);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << std::setw(22) << name << std::setw(14) << added << std::setw(14) << std::fixed
+                  << std::setprecision(1) << bytes / seconds / 1e6 << "\n";
+    };
+    
+    // Startup-style bulk load: many mid-sized templates with variables, conditions and loops
+    std::vector<std::pair<std::string, std::string>> bulk;
+    for (int i = 0; i < 2000; ++i) {
+        std::string source = MakeTemplate(4);
+        source += "{%if vip and tier == 'gold'%}Priority line {{phone}}{%endif%}\n";
+        source += "{%for item in items%}- {{upper(item)}}\n{%endfor%}";
+        bulk.emplace_back("/t" + std::to_string(i), source);
+    }
+    report("bulk 2000", bulk);
+    
+    // Deep nesting used to copy and rescan every conditional body
+    std::string nested;
+    for (int depth = 0; depth < 500; ++depth) nested += "{%if flag and count > 1%}text ";
+    for (int depth = 0; depth < 500; ++depth) nested += "{%endif%}";
+    report("nested if x500", {{"/nested", nested}});
+}
+
+void BenchDateFormatting() {
+    std::cout << "\nDate/time formatting\n";
+    std::cout << std::setw(22) << "path" << std::setw(14) << "ns/call" << "\n";
+    
+    const int iterations = 200000;
+    auto report = [](const char* name, double micros) {
+        std::cout << std::setw(22) << name << std::setw(14) << std::fixed << std::setprecision(1) << micros * 1000
+                  << "\n";
+    };
+    
+    // Previous implementation of SystemVariables::get_current_date
+    report("put_time", TimePerCallMicros(iterations, [] {
+        auto time_t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        std::ostringstream oss;
+        oss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
+        return oss.str();
+    }));
+    
+    TimeFormatter formatter("%Y-%m-%d %H:%M:%S");
+    std::tm tm{};
+    std::time_t now = std::time(nullptr);
+    localtime_r(&now, &tm);
+    std::string out;
+    report("TimeFormatter", TimePerCallMicros(iterations, [&] {
+        out.clear();
+        formatter.format_to(out, tm);
+    }));
+    report("current_datetime", TimePerCallMicros(iterations, [] { SystemVariables::get_current_datetime(); }));
+    
+    AdvancedTemplateEngine engine;
+    engine.add_advanced_template("/stamp", "Logged {{date()}} {{time()}} ({{date('%A %e %B')}}) by {{name}}");
+    Context context = {{"name", "Ann"}};
+    report("date template", TimePerCallMicros(iterations / 4, [&] { engine.expand_advanced("/stamp", context); }));
+}
+
+void BenchRandomFunctions() {
+    std::cout << "\nRandom numbers and UUIDs\n";
+    std::cout << std::setw(22) << "path" << std::setw(14) << "ns/call" << "\n";
+    
+    const int iterations = 500000;
+    auto report = [](const char* name, double micros) {
+        std::cout << std::setw(22) << name << std::setw(14) << std::fixed << std::setprecision(1) << micros * 1000
+                  << "\n";
+    };
+    
+    // Previous get_random_number: shared mt19937 and a distribution per call
+    std::mt19937 gen(std::random_device{}());
+    volatile int sink = 0;
+    report("mt19937 + dist", TimePerCallMicros(iterations, [&] {
+        std::uniform_int_distribution<> dis(0, 100);
+        sink = dis(gen);
+    }));
+    report("xoshiro uniform", TimePerCallMicros(iterations, [&] { sink = static_cast<int>(ThreadRandom::uniform(0, 100)); }));
+    report("random_number", TimePerCallMicros(iterations, [] { SystemVariables::get_random_number(); }));
+    
+    char uuid[36];
+    report("uuid_v4", TimePerCallMicros(iterations, [&] { ThreadRandom::uuid_v4(uuid); }));
+    report("random_uuid", TimePerCallMicros(iterations, [] { SystemVariables::get_random_uuid(); }));
+}
+
+void BenchParallelCompile() {
+    std::cout << "\nParallel bulk compile (20000 templates, " << std::thread::hardware_concurrency() << " cores)\n";
+    std::cout << std::setw(22) << "threads" << std::setw(14) << "ms" << std::setw(14) << "speedup"
+              << std::setw(14) << "avg us" << "\n";
+    
+    std::vector<std::pair<std::string, std::string>> sources;
+    for (int i = 0; i < 20000; ++i) {
+        std::string source = MakeTemplate(4);
+        source += "{%if vip and tier == 'gold'%}Priority line {{phone}}{%endif%}\n";
+        source += "{%for item in items%}- {{upper(item)}}\n{%endfor%}";
+        sources.emplace_back("/t" + std::to_string(i), source);
+    }
+    
+    double serial_ms = 0;
+    for (size_t threads : {1, 2, 4, 8}) {
+        AdvancedTemplateEngine engine;
+        engine.add_advanced_templates(sources, threads);
+        auto stats = engine.get_compilation_stats();
+        double ms = stats.last_batch_time.count() / 1000.0;
+        if (threads == 1) serial_ms = ms;
+        std::cout << std::setw(22) << threads << std::setw(14) << std::fixed << std::setprecision(1) << ms
+                  << std::setw(14) << std::setprecision(2) << serial_ms / ms << std::setw(14)
+                  << stats.average_compile_time.count() << "\n";
+    }
+}
+
+void BenchTemplateFootprint() {
+    std::cout << "\nResident template bytes (20000 templates)\n";
+    std::cout << std::setw(22) << "component" << std::setw(14) << "KiB" << std::setw(14) << "per tmpl" << "\n";
+    
+    std::vector<std::pair<std::string, std::string>> sources;
+    size_t text_bytes = 0;
+    for (int i = 0; i < 20000; ++i) {
+        std::string source = MakeTemplate(4);
+        source += "{%if vip and tier == 'gold'%}Priority line {{phone}}{%endif%}\n";
+        source += "{%for item in items%}- {{upper(item)}}\n{%endfor%}";
+        text_bytes += source.size();
+        sources.emplace_back("/t" + std::to_string(i), source);
+    }
+    
+    AdvancedTemplateEngine engine;
+    engine.add_advanced_templates(sources);
+    TemplateFootprint total = engine.get_total_footprint();
+    auto row = [&](const char* name, size_t bytes) {
+        std::cout << std::setw(22) << name << std::setw(14) << bytes / 1024 << std::setw(14)
+                  << bytes / sources.size() << "\n";
+    };
+    row("template text", text_bytes);
+    row("source buffers", total.source_bytes);
+    row("compiled", total.compiled_bytes);
+    row("linked", total.linked_bytes);
+    row("total", total.total());
+}
+
+void BenchColdStart() {
+    std::cout << "\nCold start to first expansion (20000 templates)\n";
+    std::cout << std::setw(22) << "startup" << std::setw(14) << "templates" << std::setw(14) << "ms" << "\n";
+    
+    std::vector<std::pair<std::string, std::string>> sources;
+    for (int i = 0; i < 20000; ++i) {
+        std::string source = MakeTemplate(4);
+        source += "{%if vip and tier == 'gold'%}Priority line {{phone}}{%endif%}\n";
+        source += "{%for item in items%}- {{upper(item)}}\n{%endfor%}";
+        sources.emplace_back("/t" + std::to_string(i), source);
+    }
+    
+    const std::string path = (std::filesystem::temp_directory_path() / "crossexpand_bench.store").string();
+    {
+        AdvancedTemplateEngine engine;
+        engine.add_advanced_templates(sources);
+        engine.save_template_store(path);
+    }
+    
+    Context context = {{"name", "Ann"}, {"items", "a\nb"}};
+    auto report = [&](const char* name, auto&& startup) {
+        auto start = std::chrono::steady_clock::now();
+        AdvancedTemplateEngine engine;
+        size_t added = startup(engine);
+        std::string first = engine.expand_advanced("/t0", context);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << std::setw(22) << name << std::setw(14) << added << std::setw(14) << std::fixed
+                  << std::setprecision(1) << ms << (first.empty() ? " (empty!)" : "") << "\n";
+    };
+    
+    report("compile sources", [&](AdvancedTemplateEngine& engine) { return engine.add_advanced_templates(sources); });
+    report("verified store", [&](AdvancedTemplateEngine& engine) {
+        engine.attach_template_store(path);
+        return engine.add_advanced_templates(sources);
+    });
+    report("store only", [&](AdvancedTemplateEngine& engine) { return engine.load_template_store(path); });
+    std::filesystem::remove(path);
+}
+
+// Run fn in a child process so each loader's peak RSS is measured from a clean start
+void ReportPeakMemory(const char* name, const std::function<size_t()>& fn) {
+    int pipe_fds[2];
+    if (pipe(pipe_fds) != 0) return;
+    
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(pipe_fds[0]);
+        auto start = std::chrono::steady_clock::now();
+        size_t loaded = fn();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        double result[2] = {static_cast<double>(loaded), ms};
+        ssize_t written = write(pipe_fds[1], result, sizeof(result));
+        _exit(written == sizeof(result) ? 0 : 1);
+    }
+    
+    close(pipe_fds[1]);
+    double result[2] = {0, 0};
+    ssize_t got = read(pipe_fds[0], result, sizeof(result));
+    close(pipe_fds[0]);
+    int status = 0;
+    struct rusage usage {};
+    wait4(pid, &status, 0, &usage);
+    if (got != sizeof(result)) return;
+    
+    std::cout << std::setw(22) << name << std::setw(12) << static_cast<size_t>(result[0]) << std::setw(12)
+              << std::fixed << std::setprecision(1) << result[1] << std::setw(14) << usage.ru_maxrss / 1024.0 << "\n";
+}
+
+void BenchConfigLoad() {
+    constexpr size_t TEMPLATES = 100000;
+    std::cout << "Config load (" << TEMPLATES << " templates)\n";
+    std::cout << std::setw(22) << "loader" << std::setw(12) << "templates" << std::setw(12) << "ms"
+              << std::setw(14) << "peak RSS MB" << "\n";
+    
+    const auto dir = std::filesystem::temp_directory_path();
+    const std::string json_path = (dir / "crossexpand_bench_config.json").string();
+    const std::string lines_path = (dir / "crossexpand_bench_templates.ndjson").string();
+    {
+        // Written record by record so the parent never holds the library in memory
+        std::ofstream json(json_path);
+        std::ofstream lines(lines_path);
+        const std::string text = MakeTemplate(2);
+        json << "{\"version\": \"1.0\", \"templates\": {";
+        for (size_t i = 0; i < TEMPLATES; ++i) {
+            nlohmann::json record = {{"text", text}, {"description", "template " + std::to_string(i)}};
+            json << (i ? "," : "") << nlohmann::json("/t" + std::to_string(i)).dump() << ":" << record.dump();
+            record["shortcut"] = "/t" + std::to_string(i);
+            lines << record.dump() << "\n";
+        }
+        json << "}, \"variables\": {\"name\": \"Ann\"}}";
+    }
+    
+    ReportPeakMemory("process baseline", [] { return size_t(0); });
+    ReportPeakMemory("DOM (previous)", [&] {
+        // The old path: parse a document, copy it into a map, then copy the map again
+        std::ifstream file(json_path);
+        nlohmann::json json;
+        file >> json;
+        std::unordered_map<std::string, Template> templates;
+        for (const auto& [shortcut, tmpl_json] : json["templates"].items()) {
+            Template tmpl;
+            tmpl.text = tmpl_json["text"];
+            tmpl.description = tmpl_json["description"];
+            templates[shortcut] = tmpl;
+        }
+        ConfigManager config;
+        config.SetTemplates(templates);
+        return config.GetTemplates().size();
+    });
+    ReportPeakMemory("SAX json", [&] {
+        ConfigManager config;
+        config.LoadConfig(json_path);
+        return config.GetTemplates().size();
+    });
+    ReportPeakMemory("SAX ndjson", [&] {
+        ConfigManager config;
+        config.LoadConfig(lines_path);
+        return config.GetTemplates().size();
+    });
+    ReportPeakMemory("ndjson -> engine", [&] {
+        TemplateEngine engine;
+        ConfigManager().LoadTemplatesInto(lines_path, engine);
+        return engine.GetTemplateCount();
+    });
+    
+    std::filesystem::remove(json_path);
+    std::filesystem::remove(lines_path);
+    std::cout << "\n";
+}
+
+int main() {
+    Logger::Instance().SetLevel(LogLevel::ERROR);
+    // First, so forked loaders start from a small parent heap
+    BenchConfigLoad();
+    BenchBasicExpansion();
+    BenchContextExpansion();
+    BenchTriggerMatching();
+    BenchLoopExpansion();
+    BenchAdvancedCompile();
+    BenchDateFormatting();
+    BenchRandomFunctions();
+    BenchParallelCompile();
+    BenchTemplateFootprint();
+    BenchColdStart();
+    return 0;
+}
@@ -1,74 +1,320 @@
 #pragma once
 
 #include "core/template_engine.hpp"
-#include <regex>
+#include "core/memory_pool.hpp"
+#include "core/snapshot.hpp"
+#include "core/variable_table.hpp"
+#include "utils/performance_monitor.hpp"
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <string_view>
 #include <variant>
 #include <functional>
 
 namespace crossexpand {
 
-// Advanced template node types
-enum class NodeType {
-    LITERAL,
-    VARIABLE,
-    CONDITIONAL,
-    LOOP,
-    FUNCTION_CALL,
-    FORM_INPUT
+class TemplateStore;
+
+// Flat instruction stream produced by AdvancedTemplate::compile() in a single scan of
+// the source; execution walks this array front to back.
+enum class OpCode : uint8_t {
+    EMIT_TEXT,       // Append text[a, a + b)
+    EMIT_VARIABLE,   // Append value of required_variables_[a]
+    CALL_FUNCTION,   // Call calls_[a] through its bound registry slot
+    JUMP_IF_FALSE,   // Evaluate conditions_[a, a + b), jump to target when false
+    LOOP_BEGIN,      // Open loops_[a] and bind its first item, jump to target if the list is empty
+    LOOP_NEXT,       // Bind the next item of loops_[a] and jump to target (body start), else fall through
+    EMIT_LOOP_VARIABLE // Append the current item of loop frame a
+};
+
+struct Instruction {
+    OpCode op;
+    uint32_t a;
+    uint32_t b;
+    uint32_t target;
+};
+
+// System variable resolved on demand, only for templates that reference it
+struct SystemVariableProvider {
+    const char* name;
+    std::string (*resolve)();
+    bool deterministic;  // Same value for the lifetime of the process (safe to memoize)
+};
+
+// Pre-split call arguments; views are valid for the duration of the call
+class FunctionArgs {
+private:
+    const std::string_view* data_;
+    size_t size_;
+
+public:
+    FunctionArgs(const std::string_view* data, size_t size) : data_(data), size_(size) {}
+    
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    std::string_view operator[](size_t index) const { return data_[index]; }
+    const std::string_view* begin() const { return data_; }
+    const std::string_view* end() const { return data_ + size_; }
+};
+
+// Function registry for template functions
+using TemplateFunction = std::function<std::string(const FunctionArgs&, const Context&)>;
+
+// Receives expansion output in order; the view is only valid during the call.
+// Returning false stops the expansion.
+using ExpansionSink = std::function<bool(std::string_view chunk)>;
+
+// Lazily produced list items for {%for x in list%}; item must stay valid until the next call
+class ListCursor {
+public:
+    virtual ~ListCursor() = default;
+    virtual bool next(std::string_view& item) = 0;
+};
+
+using ListProvider = std::function<std::unique_ptr<ListCursor>(const Context&)>;
+
+class FunctionRegistry {
+private:
+    struct FunctionSlot {
+        std::string name;
+        TemplateFunction function; // Empty until registered
+        bool pure = false;         // Result depends only on the arguments
+    };
+    
+    // Slots are never removed or renumbered, so compiled templates can hold indices
+    struct ListSlot {
+        std::string name;
+        ListProvider provider;     // Empty until registered
+    };
+    
+    struct FunctionTable {
+        std::vector<FunctionSlot> slots;
+        std::unordered_map<std::string, size_t> slot_index;
+        std::vector<ListSlot> list_slots;
+        std::unordered_map<std::string, size_t> list_index;
+    };
+    
+    // Calls read the table without locking; registration publishes a new copy
+    SnapshotCell<FunctionTable> table_;
+
+public:
+    FunctionRegistry();
+    
+    // Custom functions are impure unless declared otherwise; impure calls disable result caching
+    void register_function(const std::string& name, TemplateFunction func, bool pure = false);
+    bool has_function(const std::string& name) const;
+    bool is_pure(size_t slot) const;
+    
+    // Stable slot for name, reserved (unbound) if not registered yet
+    size_t resolve_slot(const std::string& name);
+    
+    std::string call_slot(size_t slot, const FunctionArgs& args, const Context& context) const;
+    std::string call_function(const std::string& name, 
+                             const std::vector<std::string>& args, 
+                             const Context& context) const;
+    
+    std::vector<std::string> get_function_names() const;
+    
+    // List providers for loops, bound by slot the same way as functions
+    void register_list_provider(const std::string& name, ListProvider provider);
+    size_t resolve_list_slot(const std::string& name);
+    bool has_list_provider(size_t slot) const;
+    std::unique_ptr<ListCursor> open_list(size_t slot, const Context& context) const;
+
+private:
+    void register_builtin_functions();
 };
 
-struct TemplateNode {
-    NodeType type;
-    std::string content;
-    std::vector<std::shared_ptr<TemplateNode>> children;
-    std::unordered_map<std::string, std::string> attributes;
+// Call site bound at compile time; arguments live in AdvancedTemplate::args_
+struct FunctionCall {
+    uint32_t slot;
+    uint32_t first_arg;
+    uint32_t arg_count;
+    uint32_t name_offset;  // Function name in the text pool, for diagnostics
+    uint32_t name_length;
+};
+
+struct CallArgument {
+    enum class Kind : uint8_t {
+        LITERAL,       // text[offset, offset + length)
+        VARIABLE,      // required_variables_[offset], falls back to the identifier itself
+        LOOP_VARIABLE  // Current item of loop frame offset
+    };
     
-    TemplateNode(NodeType t, const std::string& c = "") 
-        : type(t), content(c) {}
+    Kind kind;
+    uint32_t offset;
+    uint32_t length;
+};
+
+// {%for variable in list%}: list is an enclosing loop's item, a context value (one item
+// per line) or a registered list provider, checked in that order
+struct LoopInfo {
+    uint32_t list_variable;  // required_variables_ index of the list name, unless source_frame is set
+    uint32_t list_slot;      // List provider slot, or UINT32_MAX
+    uint32_t source_frame;   // Enclosing loop frame whose item is the list, or UINT32_MAX
+    uint32_t frame;          // Frame holding this loop's cursor and current item
+};
+
+// {%if%} condition compiled to reverse Polish notation. Operands are views (context
+// values, loop items or text pool literals); comparisons are numeric when both sides
+// parse as numbers, lexicographic otherwise. Results are pushed as "true" / "false".
+struct ConditionOp {
+    enum class Kind : uint8_t {
+        VARIABLE,       // Push required_variables_[a], empty if unset
+        LOOP_VARIABLE,  // Push the current item of loop frame a
+        LITERAL,        // Push text[a, a + b)
+        EQUAL,
+        NOT_EQUAL,
+        LESS,
+        GREATER,
+        AND,
+        OR,
+        NOT
+    };
+    
+    Kind kind;
+    uint32_t a;
+    uint32_t b;
+};
+
+// Compiled program as flat, pointer-free arrays. AdvancedTemplate::image() exports one
+// and load_image() executes one in place, e.g. from a TemplateStore file mapping.
+struct CompiledImage {
+    const Instruction* code = nullptr;
+    uint32_t code_size = 0;
+    const FunctionCall* calls = nullptr;
+    uint32_t call_count = 0;
+    const CallArgument* args = nullptr;
+    uint32_t arg_count = 0;
+    const LoopInfo* loops = nullptr;
+    uint32_t loop_count = 0;
+    const ConditionOp* conditions = nullptr;
+    uint32_t condition_count = 0;
+    const char* text = nullptr;
+    uint32_t text_size = 0;
+    uint32_t loop_depth = 0;
+    std::vector<std::string_view> variables;  // required_variables_ by index
 };
 
-// Advanced template with compiled AST
+// Advanced template compiled to a flat instruction stream
 class AdvancedTemplate {
 private:
-    std::string source_;
-    std::shared_ptr<TemplateNode> root_;
+    // Also the text pool of compiled templates: literals, function names and quoted
+    // arguments are offsets into it. Shared with the basic engine's copy of the template,
+    // or viewed in place in a mapped TemplateStore.
+    SourceBuffer source_;
     std::vector<std::string> required_variables_;
+    std::vector<uint32_t> variable_ids_;  // Symbol ID of each required variable
+    std::vector<const SystemVariableProvider*> system_variables_;
+    std::vector<uint32_t> system_variable_ids_;
+    FunctionRegistry* registry_;
+    VariableSymbols* symbols_;
+    std::unique_ptr<VariableSymbols> own_symbols_;  // Standalone templates only
     bool is_compiled_;
+    std::string compile_error_;  // Empty unless the last compile() failed
+    size_t error_offset_ = 0;
+    std::chrono::microseconds compile_time_{0};
+    std::atomic<bool> cacheable_{false};  // Updated by writers while readers execute
+    
+    // Compiled form: instructions and call tables allocated from arena_ over text_ (the
+    // source), or, for loaded images, partly read in place from memory kept alive by backing_
+    MonotonicArena arena_;
+    std::shared_ptr<const void> backing_;
+    const Instruction* code_ = nullptr;
+    size_t code_size_ = 0;
+    const FunctionCall* calls_ = nullptr;
+    uint32_t call_count_ = 0;
+    const CallArgument* args_ = nullptr;
+    uint32_t arg_count_ = 0;
+    const LoopInfo* loops_ = nullptr;
+    uint32_t loop_count_ = 0;
+    uint32_t loop_depth_ = 0;  // Frames needed at execution
+    const ConditionOp* conditions_ = nullptr;
+    uint32_t condition_count_ = 0;
+    const char* text_ = nullptr;
+    uint32_t text_size_ = 0;
+    size_t literal_bytes_ = 0;
 
 public:
-    AdvancedTemplate(const std::string& source);
+    explicit AdvancedTemplate(const std::string& source, FunctionRegistry* registry = nullptr,
+                              VariableSymbols* symbols = nullptr);
+    // Adopt an existing source buffer instead of copying the text
+    explicit AdvancedTemplate(SourceBuffer source, FunctionRegistry* registry = nullptr,
+                              VariableSymbols* symbols = nullptr);
     ~AdvancedTemplate() = default;
     
     // Compilation
     bool compile();
     bool is_compiled() const { return is_compiled_; }
+    // Failure reason and source offset of the offending tag from the last compile()
+    const std::string& compile_error() const { return compile_error_; }
+    size_t error_offset() const { return error_offset_; }
+    // Wall time of the last compile() or load_image()
+    std::chrono::microseconds compile_time() const { return compile_time_; }
+    
+    // Precompiled form. image() views this template's arrays; load_image() adopts an image
+    // compiled from the same source, executing instructions, arguments, conditions and
+    // text in place while backing stays alive. Function and list slots are rebound
+    // against this template's registry. False if the image is malformed.
+    CompiledImage image() const;
+    bool load_image(const CompiledImage& image, std::shared_ptr<const void> backing);
     
-    // Execution
+    // Execution. Variables are read from slots by symbol ID; the Context overloads bind
+    // the referenced names into a SlotContext first.
     std::string execute(const Context& context) const;
+    void execute_into(std::string& output, const Context& context) const;
+    void execute_into(std::string& output, const SlotContext& slots) const;
+    // Hand output to sink in chunks of at least chunk_size bytes (the last may be shorter;
+    // one instruction's output is never split). False if the sink stopped or execution failed.
+    bool execute_streaming(const SlotContext& slots, const ExpansionSink& sink, size_t chunk_size) const;
+    // Copy the values of the variables this template reads from context into slots
+    void bind_context(const Context& context, SlotContext& slots) const;
+    // Same, taking each value from the first layer of chain that has it
+    void bind_context(const ContextChain& chain, SlotContext& slots) const;
+    // Store freshly resolved values of the system variables this template references,
+    // except those the caller or a global variable already set (providers are the last layer)
+    void bind_system_variables(SlotContext& slots) const;
     
     // Metadata
     const std::vector<std::string>& get_required_variables() const;
-    std::string get_source() const { return source_; }
+    const std::vector<uint32_t>& get_variable_ids() const { return variable_ids_; }
+    const std::vector<const SystemVariableProvider*>& get_system_variables() const { return system_variables_; }
+    const std::vector<uint32_t>& get_system_variable_ids() const { return system_variable_ids_; }
+    std::string_view get_source() const { return source_.view(); }
+    const SourceBuffer& get_source_buffer() const { return source_; }
+    size_t instruction_count() const { return code_size_; }
+    size_t compiled_size_bytes() const { return arena_.bytes_used(); }
+    // Source buffer plus everything compile() allocated; image data read in place from a
+    // store is not counted
+    TemplateFootprint footprint() const;
+    
+    // Output is a pure function of the input variables: no volatile system variables,
+    // only pure bound functions. Recomputed when the function registry changes.
+    bool is_cacheable() const { return cacheable_.load(std::memory_order_acquire); }
+    void update_cacheability();
     
     // Validation
     bool validate() const;
     std::vector<std::string> get_validation_errors() const;
 
 private:
-    std::shared_ptr<TemplateNode> parse(const std::string& text, size_t& pos);
-    std::shared_ptr<TemplateNode> parse_conditional(const std::string& text, size_t& pos);
-    std::shared_ptr<TemplateNode> parse_loop(const std::string& text, size_t& pos);
-    std::shared_ptr<TemplateNode> parse_variable(const std::string& text, size_t& pos);
-    std::shared_ptr<TemplateNode> parse_function(const std::string& text, size_t& pos);
-    std::shared_ptr<TemplateNode> parse_form(const std::string& text, size_t& pos);
-    
-    std::string execute_node(const TemplateNode& node, const Context& context) const;
-    std::string execute_conditional(const TemplateNode& node, const Context& context) const;
-    std::string execute_loop(const TemplateNode& node, const Context& context) const;
-    std::string execute_function(const TemplateNode& node, const Context& context) const;
-    
-    bool evaluate_condition(const std::string& condition, const Context& context) const;
-    void extract_variables(const TemplateNode& node);
+    struct ProgramBuilder;
+    void scan(ProgramBuilder& builder);
+    void scan_control(std::string_view tag, size_t offset, ProgramBuilder& builder);
+    void emit_variable(std::string_view name, ProgramBuilder& builder);
+    void emit_function_call(std::string_view call, ProgramBuilder& builder);
+    void emit_condition(std::string_view condition, ProgramBuilder& builder);
+    struct LoopFrame;
+    bool run(std::string& output, const SlotContext& slots, const ExpansionSink* sink, size_t chunk_size) const;
+    void execute_function(const FunctionCall& call, const SlotContext& slots, const LoopFrame* frames,
+                          std::string& output) const;
+    
+    bool evaluate_condition(const ConditionOp* ops, size_t count, const SlotContext& slots,
+                            const LoopFrame* frames) const;
+    uint32_t variable_index(const std::string& name);
+    bool check_image(const CompiledImage& image) const;
+    void finish_compile(std::chrono::steady_clock::time_point start);
 };
 
 // System variable providers
@@ -83,38 +329,86 @@ public:
     static std::string get_random_uuid();
     static std::string get_random_number(int min = 0, int max = 100);
     
-    // Register all system variables in context
+    // Provider table lookup; nullptr if name is not a system variable
+    static const SystemVariableProvider* find_provider(std::string_view name);
+    static const std::vector<SystemVariableProvider>& providers();
+    // Value of a deterministic provider, resolved once per process; bound by view
+    static std::string_view memoized(const SystemVariableProvider& provider);
+    
+    // Register all system variables in context (eager; prefer per-template providers)
     static void populate_context(Context& context);
 };
 
-// Function registry for template functions
-using TemplateFunction = std::function<std::string(const std::vector<std::string>&, const Context&)>;
-
-class FunctionRegistry {
+// Bounded LRU of expansion results. Entries are tagged with the engine epoch they were
+// produced under; a newer epoch drops the whole cache. Capacity 0 disables caching.
+class ExpansionCache {
 private:
-    std::unordered_map<std::string, TemplateFunction> functions_;
+    struct Entry {
+        std::string key;
+        std::string result;
+    };
+    
+    mutable std::mutex mutex_;
+    std::list<Entry> lru_;  // Most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    std::atomic<size_t> capacity_{0};
+    uint64_t epoch_ = 0;
+    CounterMetric& hits_;
+    CounterMetric& misses_;
 
 public:
-    FunctionRegistry();
+    ExpansionCache();
     
-    void register_function(const std::string& name, TemplateFunction func);
-    bool has_function(const std::string& name) const;
-    std::string call_function(const std::string& name, 
-                             const std::vector<std::string>& args, 
-                             const Context& context) const;
+    bool enabled() const { return capacity_.load(std::memory_order_relaxed) > 0; }
+    void set_capacity(size_t capacity);
     
-    std::vector<std::string> get_function_names() const;
-
-private:
-    void register_builtin_functions();
+    bool lookup(const std::string& key, uint64_t epoch, std::string& result);
+    void insert(const std::string& key, uint64_t epoch, const std::string& result);
+    void clear();
+    
+    size_t size() const;
+    size_t capacity() const { return capacity_.load(std::memory_order_relaxed); }
 };
 
 // Enhanced template engine with advanced features
 class AdvancedTemplateEngine : public TemplateEngine {
 private:
-    std::unordered_map<std::string, std::unique_ptr<AdvancedTemplate>> compiled_templates_;
+    using AdvancedTemplateMap = std::unordered_map<std::string, std::shared_ptr<AdvancedTemplate>>;
+    
+    // Expansion reads snapshots without locking; advanced_mutex_ only serializes writers
+    VariableSymbols symbols_;
+    SnapshotCell<AdvancedTemplateMap> compiled_templates_;
     std::unique_ptr<FunctionRegistry> function_registry_;
-    mutable std::shared_mutex advanced_mutex_;
+    mutable ExpansionCache expansion_cache_;
+    std::mutex advanced_mutex_;
+    std::atomic<uint64_t> functions_generation_{0};
+    
+    uint64_t cache_epoch() const {
+        return GetGeneration() + GetVariablesGeneration() + functions_generation_.load(std::memory_order_acquire);
+    }
+    
+    TimerMetric& first_chunk_timer_;
+    TimerMetric& stream_total_timer_;
+    
+    std::shared_ptr<const TemplateStore> template_store_;  // Guarded by advanced_mutex_
+    CounterMetric& store_hits_;
+    CounterMetric& store_misses_;
+    
+    using CompiledList = std::vector<std::pair<std::string, std::shared_ptr<AdvancedTemplate>>>;
+    CompiledList compile_sources(const std::vector<std::pair<std::string, std::string>>& sources, size_t threads);
+    bool load_stored(const std::shared_ptr<const TemplateStore>& store, const std::string& shortcut,
+                     const std::string& source, AdvancedTemplate& tmpl) const;
+    // Publishes to both engines; returns how many the basic engine accepted
+    size_t publish_templates(const CompiledList& compiled);
+    void restore_rejected(const CompiledList& compiled, const std::vector<std::shared_ptr<AdvancedTemplate>>& previous,
+                          const std::vector<size_t>& rejected);
+    std::string cache_key(const std::string& shortcut, const AdvancedTemplate& tmpl, const SlotContext& slots) const;
+    std::string expand_compiled(const std::string& shortcut, const AdvancedTemplate& tmpl, const SlotContext& slots,
+                                bool use_cache, uint64_t epoch) const;
+    bool stream_compiled(const std::string& shortcut, const AdvancedTemplate& tmpl, const SlotContext& slots,
+                         const ExpansionSink& sink, size_t chunk_size, bool use_cache, uint64_t epoch) const;
+    void bind_layers(const AdvancedTemplate& tmpl, const ContextChain& chain, const Context& globals,
+                     SlotContext& slots) const;
 
 public:
     AdvancedTemplateEngine();
@@ -122,11 +416,57 @@ public:
     
     // Advanced template management
     bool add_advanced_template(const std::string& shortcut, const std::string& source);
+    // Compiles every source on up to threads workers (0 = one per core; small batches stay
+    // on the calling thread) without holding any engine lock, then publishes the successful
+    // ones as one snapshot; returns that count. A template whose {/includes} would form a
+    // cycle is rejected by both engines and the previous definition stays.
+    size_t add_advanced_templates(const std::vector<std::pair<std::string, std::string>>& sources,
+                                  size_t threads = 0);
+    // Removes the template from both engines and bumps the generation, which also retires
+    // its cached expansions. Hides TemplateEngine::RemoveTemplate, which alone would leave
+    // the compiled template expanding.
+    bool RemoveTemplate(const std::string& shortcut);
+    // Precompiled template store (see TemplateStore). While a store is attached,
+    // add_advanced_templates() adopts stored images whose source hash matches and compiles
+    // only the rest ("template_store_hits"/"template_store_misses" counters).
+    // load_template_store() attaches the store and publishes every template in it, so no
+    // source has to be parsed or compiled at startup.
+    bool attach_template_store(const std::string& path);
+    size_t load_template_store(const std::string& path);
+    bool save_template_store(const std::string& path) const;
+    
+    // Recompile from source and republish; false if the template is missing or failed
     bool compile_template(const std::string& shortcut);
-    bool compile_all_templates();
+    bool compile_all_templates(size_t threads = 0);
     
-    // Enhanced expansion with system variables
+    // Enhanced expansion. Variables resolve from context, then the global variables
+    // (SetVariable), then system providers; nothing is merged or copied, and binding reuses
+    // a per-thread slot array.
     std::string expand_advanced(const std::string& shortcut, const Context& context = {}) const;
+    // Same with caller-assembled layers (e.g. per-request values over per-user defaults);
+    // global variables are searched after them, even when the chain is full
+    std::string expand_advanced(const std::string& shortcut, const ContextChain& chain) const;
+    // Hash-free expansion: slots are indexed by variable_id()
+    std::string expand_advanced(const std::string& shortcut, const SlotContext& slots) const;
+    
+    // Streaming expansion: sink receives output chunks while the template is still running,
+    // so injection can start before expansion ends. Time to first chunk and total time are
+    // recorded in the "expansion_first_chunk" and "expansion_stream_total" timers.
+    static constexpr size_t DEFAULT_STREAM_CHUNK = 256;
+    bool expand_advanced_streaming(const std::string& shortcut, const Context& context, const ExpansionSink& sink,
+                                   size_t chunk_size = DEFAULT_STREAM_CHUNK) const;
+    bool expand_advanced_streaming(const std::string& shortcut, const SlotContext& slots, const ExpansionSink& sink,
+                                   size_t chunk_size = DEFAULT_STREAM_CHUNK) const;
+    
+    // Variable symbol table shared by all templates of this engine
+    uint32_t variable_id(const std::string& name) { return symbols_.intern(name); }
+    SlotContext make_slot_context() const { return SlotContext(symbols_.size()); }
+    
+    // Opt-in memoization of deterministic expansions (hits/misses reported as
+    // "expansion_cache_hits"/"expansion_cache_misses" performance counters)
+    void enable_expansion_cache(size_t max_entries = 1024);
+    void disable_expansion_cache();
+    size_t expansion_cache_size() const;
     
     // Template analysis
     std::vector<std::string> get_required_variables(const std::string& shortcut) const;
@@ -134,19 +474,44 @@ public:
     std::vector<std::string> get_validation_errors(const std::string& shortcut) const;
     
     // Function management
-    void register_custom_function(const std::string& name, TemplateFunction func);
+    void register_custom_function(const std::string& name, TemplateFunction func, bool pure = false);
+    void register_list_provider(const std::string& name, ListProvider provider);
     std::vector<std::string> get_available_functions() const;
     
     // Performance
+    struct CompileFailure {
+        std::string shortcut;
+        std::string message;
+        size_t offset;  // Source offset of the offending tag
+    };
+    
+    // Cumulative over every compile since construction. Template times are measured per
+    // template on the thread that compiled it; batch time is wall time of the last batch.
     struct CompilationStats {
-        size_t total_templates;
-        size_t compiled_templates;
-        size_t failed_compilations;
-        std::chrono::milliseconds total_compile_time;
-        std::chrono::milliseconds average_compile_time;
+        size_t total_templates = 0;  // Compile attempts
+        size_t compiled_templates = 0;
+        size_t failed_compilations = 0;
+        std::chrono::microseconds total_compile_time{0};
+        std::chrono::microseconds average_compile_time{0};
+        std::chrono::microseconds max_compile_time{0};
+        std::string slowest_template;
+        std::chrono::microseconds last_batch_time{0};
+        size_t last_batch_threads = 0;
+        std::vector<CompileFailure> recent_failures;  // Oldest first, at most MAX_RECORDED_FAILURES
     };
+    static constexpr size_t MAX_RECORDED_FAILURES = 64;
     
     CompilationStats get_compilation_stats() const;
+    // Compile time of a published template, zero if unknown
+    std::chrono::microseconds get_compile_time(const std::string& shortcut) const;
+    // Bytes held for a template across the advanced and basic engines; both engines
+    // share one source buffer, which is counted once
+    TemplateFootprint get_template_footprint(const std::string& shortcut) const;
+    TemplateFootprint get_total_footprint() const;
+
+private:
+    mutable std::mutex stats_mutex_;
+    CompilationStats stats_;
 };
 
 } // namespace crossexpand
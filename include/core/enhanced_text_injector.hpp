@@ -10,6 +10,8 @@
 #include <thread>
 #include <vector>
 #include <optional>
+#include <functional>
+#include <string_view>
 
 // X11 includes for Linux platform
 #ifdef __linux__
@@ -65,6 +67,11 @@ struct InjectionMetrics {
     std::string error_message;
 };
 
+// Streaming injection: the producer calls the sink once per chunk, in order, and stops
+// when it returns false. Matches AdvancedTemplateEngine's ExpansionSink.
+using ChunkSink = std::function<bool(std::string_view chunk)>;
+using ChunkProducer = std::function<bool(const ChunkSink& sink)>;
+
 // Enhanced text injector with multiple strategies
 class EnhancedTextInjector : public TextInjector {
 private:
@@ -97,6 +104,21 @@ public:
     
     bool inject_with_profile(const std::string& text, const AppProfile& profile);
     
+    // Inject text while the producer emits it. Typing strategies inject each chunk as it
+    // arrives, so typing starts before the full text exists. CLIPBOARD_PASTE collects the
+    // stream and pastes once instead of overwriting the clipboard per chunk. ADAPTIVE
+    // fast-types chunks while the text is within ADAPTIVE_PASTE_THRESHOLD and pastes the
+    // remainder once it grows past it. Time to the first injected character and total time
+    // go to the "injection_first_char" / "injection_stream_total" timers.
+    bool inject_stream(const ChunkProducer& produce, InjectionStrategy strategy = InjectionStrategy::ADAPTIVE);
+    
+    // ADAPTIVE pastes text (or the rest of a stream) past this length instead of typing it
+    static constexpr size_t ADAPTIVE_PASTE_THRESHOLD = 500;
+    
+    // Replace the backend behind one strategy (custom backends, tests). The injector is
+    // used as is, not initialized; false for strategies without a backend of their own.
+    bool set_strategy_injector(InjectionStrategy strategy, std::unique_ptr<TextInjector> injector);
+    
     // Application profiling
     void add_app_profile(const AppProfile& profile);
     AppProfile get_app_profile(const std::string& app_name) const;
@@ -126,6 +148,7 @@ public:
 
 private:
     InjectionStrategy choose_optimal_strategy(const std::string& text) const;
+    bool inject_with_strategy(const std::string& text, InjectionStrategy strategy);
     bool inject_fast_typing(const std::string& text);
     bool inject_natural_typing(const std::string& text);
     bool inject_clipboard_paste(const std::string& text);
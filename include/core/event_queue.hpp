@@ -4,6 +4,12 @@
 #include <memory>
 #include <chrono>
 #include <array>
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
 
 namespace crossexpand {
 
@@ -27,9 +33,12 @@ enum class EventPriority {
     CRITICAL = 3
 };
 
+constexpr size_t EVENT_PRIORITY_LEVELS = 4;
+
 struct ProcessingEvent {
     SimpleKeyEvent key_event;  // Use SimpleKeyEvent instead of forward-declared KeyEvent
     EventPriority priority;
+    uint32_t dropped_before = 0;  // Events of this level lost just before this one
     std::chrono::steady_clock::time_point timestamp;
     uint64_t sequence_id;
     
@@ -40,7 +49,8 @@ struct ProcessingEvent {
           sequence_id(0) {}
 };
 
-// Lock-free SPSC (Single Producer Single Consumer) queue
+// Lock-free SPSC (Single Producer Single Consumer) queue. Only safe with exactly one
+// pushing and one popping thread; use MpmcQueue otherwise. Stamps work as in MpmcQueue.
 template<typename T, size_t Capacity>
 class LockFreeQueue {
 private:
@@ -48,6 +58,7 @@ private:
     
     struct alignas(64) Slot {
         std::atomic<bool> ready{false};
+        std::atomic<int64_t> stamp{0};
         T data;
     };
     
@@ -63,7 +74,7 @@ public:
     LockFreeQueue(const LockFreeQueue&) = delete;
     LockFreeQueue& operator=(const LockFreeQueue&) = delete;
     
-    bool try_push(const T& item) {
+    bool try_push(const T& item, int64_t stamp = 0) {
         const size_t head = head_.load(std::memory_order_relaxed);
         const size_t next_head = (head + 1) & (Capacity - 1);
         
@@ -72,6 +83,7 @@ public:
         }
         
         slots_[head].data = item;
+        slots_[head].stamp.store(stamp, std::memory_order_relaxed);
         slots_[head].ready.store(true, std::memory_order_release);
         head_.store(next_head, std::memory_order_release);
         return true;
@@ -90,6 +102,49 @@ public:
         return true;
     }
     
+    // Fill up to count free slots in order, fill(slot_item, index) writing each one and
+    // returning its stamp; returns how many were filled
+    template<typename Fill>
+    size_t try_push_bulk(size_t count, Fill fill) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        const size_t used = (head - tail_.load(std::memory_order_acquire)) & (Capacity - 1);
+        const size_t n = std::min(count, Capacity - 1 - used);
+        
+        for (size_t i = 0; i < n; ++i) {
+            Slot& slot = slots_[(head + i) & (Capacity - 1)];
+            slot.stamp.store(fill(slot.data, i), std::memory_order_relaxed);
+            slot.ready.store(true, std::memory_order_release);
+        }
+        head_.store((head + n) & (Capacity - 1), std::memory_order_release);
+        return n;
+    }
+    
+    // Move up to max items into out; returns how many
+    size_t try_pop_bulk(T* out, size_t max) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t n = 0;
+        while (n < max) {
+            Slot& slot = slots_[(tail + n) & (Capacity - 1)];
+            if (!slot.ready.load(std::memory_order_acquire)) {
+                break;
+            }
+            out[n++] = std::move(slot.data);
+            slot.ready.store(false, std::memory_order_release);
+        }
+        tail_.store((tail + n) & (Capacity - 1), std::memory_order_release);
+        return n;
+    }
+    
+    // Stamp of the oldest item, without popping it; false when empty
+    bool front_stamp(int64_t& stamp) const {
+        const Slot& slot = slots_[tail_.load(std::memory_order_relaxed)];
+        if (!slot.ready.load(std::memory_order_acquire)) {
+            return false;
+        }
+        stamp = slot.stamp.load(std::memory_order_relaxed);
+        return true;
+    }
+    
     size_t size() const {
         const size_t head = head_.load(std::memory_order_acquire);
         const size_t tail = tail_.load(std::memory_order_acquire);
@@ -109,33 +164,376 @@ public:
     }
 };
 
+// Bounded lock-free MPMC queue (Vyukov). Each slot carries a sequence number that says
+// whose turn it is: equal to the position when a producer may fill it, position + 1 when
+// a consumer may take it. Producers and consumers each claim positions with one CAS on
+// their own counter, so any number of threads can push and pop concurrently. Items also
+// carry an int64 stamp that front_stamp() reads without popping (EventQueue stores the
+// event timestamp there for aging).
+template<typename T, size_t Capacity>
+class MpmcQueue {
+private:
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be power of 2");
+    
+    struct alignas(64) Slot {
+        std::atomic<size_t> sequence;
+        std::atomic<int64_t> stamp{0};
+        T data;
+    };
+    
+    alignas(64) std::atomic<size_t> enqueue_pos_{0};
+    alignas(64) std::atomic<size_t> dequeue_pos_{0};
+    std::array<Slot, Capacity> slots_;
+    
+    // Consecutive slots from pos whose sequence is position + turn (0: free, 1: published)
+    size_t run_length(size_t pos, size_t limit, size_t turn) const {
+        size_t n = 0;
+        while (n < limit &&
+               slots_[(pos + n) & (Capacity - 1)].sequence.load(std::memory_order_acquire) == pos + n + turn) {
+            n++;
+        }
+        return n;
+    }
+
+public:
+    MpmcQueue() {
+        for (size_t i = 0; i < Capacity; ++i) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    ~MpmcQueue() = default;
+    
+    // Non-copyable, non-movable
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+    
+    bool try_push(const T& item, int64_t stamp = 0) {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot = &slots_[pos & (Capacity - 1)];
+            const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // Queue is full: the slot still holds the previous lap's item
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed); // Another producer won
+            }
+        }
+        
+        slot->data = item;
+        slot->stamp.store(stamp, std::memory_order_relaxed);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+    
+    bool try_pop(T& item) {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot = &slots_[pos & (Capacity - 1)];
+            const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // Queue is empty
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        
+        item = std::move(slot->data);
+        slot->sequence.store(pos + Capacity, std::memory_order_release); // Free for the next lap
+        return true;
+    }
+    
+    // Claims the longest run of free slots (up to count) with one CAS on enqueue_pos_, then
+    // fills and publishes them in order (fill returns each item's stamp); returns how many
+    // were claimed (0 when full)
+    template<typename Fill>
+    size_t try_push_bulk(size_t count, Fill fill) {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        size_t claimed = 0;
+        while (count > 0) {
+            claimed = run_length(pos, count, 0);
+            if (claimed == 0) {
+                const size_t sequence = slots_[pos & (Capacity - 1)].sequence.load(std::memory_order_acquire);
+                if (static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos) < 0) {
+                    return 0; // Queue is full
+                }
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (enqueue_pos_.compare_exchange_weak(pos, pos + claimed, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        
+        for (size_t i = 0; i < claimed; ++i) {
+            Slot& slot = slots_[(pos + i) & (Capacity - 1)];
+            slot.stamp.store(fill(slot.data, i), std::memory_order_relaxed);
+            slot.sequence.store(pos + i + 1, std::memory_order_release);
+        }
+        return claimed;
+    }
+    
+    // Claims the longest run of published slots (up to max) with one CAS on dequeue_pos_
+    // and moves them into out; returns how many (0 when empty)
+    size_t try_pop_bulk(T* out, size_t max) {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        size_t claimed = 0;
+        while (max > 0) {
+            claimed = run_length(pos, max, 1);
+            if (claimed == 0) {
+                const size_t sequence = slots_[pos & (Capacity - 1)].sequence.load(std::memory_order_acquire);
+                if (static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1) < 0) {
+                    return 0; // Queue is empty
+                }
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (dequeue_pos_.compare_exchange_weak(pos, pos + claimed, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        
+        for (size_t i = 0; i < claimed; ++i) {
+            Slot& slot = slots_[(pos + i) & (Capacity - 1)];
+            out[i] = std::move(slot.data);
+            slot.sequence.store(pos + i + Capacity, std::memory_order_release);
+        }
+        return claimed;
+    }
+    
+    // Stamp of the item at the front, without popping it; false when empty. Another
+    // consumer may take that item meanwhile, so the answer is a hint, not a reservation.
+    bool front_stamp(int64_t& stamp) const {
+        const size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        const Slot& slot = slots_[pos & (Capacity - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != pos + 1) {
+            return false;
+        }
+        stamp = slot.stamp.load(std::memory_order_relaxed);
+        return true;
+    }
+    
+    // Approximate while other threads are pushing or popping
+    size_t size() const {
+        const size_t dequeued = dequeue_pos_.load(std::memory_order_acquire);
+        const size_t enqueued = enqueue_pos_.load(std::memory_order_acquire);
+        return enqueued > dequeued ? std::min(enqueued - dequeued, Capacity) : 0;
+    }
+    
+    bool empty() const {
+        return size() == 0;
+    }
+    
+    bool full() const {
+        return size() == Capacity;
+    }
+    
+    size_t capacity() const {
+        return Capacity;
+    }
+};
+
+// Ring policies for BasicEventQueue. SpscRing is cheaper but requires one pushing and
+// one popping thread; MpmcRing is safe with any number of each.
+struct SpscRing {
+    template<typename T, size_t Capacity>
+    using Ring = LockFreeQueue<T, Capacity>;
+};
+
+struct MpmcRing {
+    template<typename T, size_t Capacity>
+    using Ring = MpmcQueue<T, Capacity>;
+};
+
+// How pop() picks the priority level to serve next. By default strictly by priority: the
+// highest non-empty level always goes first. weighted() opts into a weighted round robin
+// (a turn that finds its level empty goes to the highest non-empty one) where a level
+// whose oldest event has waited past its max_wait is served first (checked every few
+// pops); when several have, the one furthest past its limit relative to it wins, except
+// that an overdue CRITICAL event always goes first.
+struct SchedulerConfig {
+    // Turns per round, indexed by EventPriority (LOW first); at most MAX_WEIGHT each.
+    // All zero: strict priority.
+    std::array<uint32_t, EVENT_PRIORITY_LEVELS> weights{};
+    // Aging limit per level, measured from ProcessingEvent::timestamp; zero disables it
+    std::array<std::chrono::microseconds, EVENT_PRIORITY_LEVELS> max_wait{};
+    
+    static constexpr uint32_t MAX_WEIGHT = 64;
+    
+    // Drain CRITICAL before HIGH before NORMAL before LOW, never aging (the default)
+    static SchedulerConfig strict();
+    // Weights 1/2/4/8 with max_wait 250/100/50/10 ms, LOW to CRITICAL
+    static SchedulerConfig weighted();
+};
+
+// Distribution of time from ProcessingEvent::timestamp to pop for one priority level
+struct WaitHistogram {
+    static constexpr size_t BUCKETS = 24;  // Bucket 0: under 1 us; bucket i: [2^(i-1), 2^i) us; last open
+    
+    std::array<uint64_t, BUCKETS> counts{};
+    uint64_t total = 0;
+    uint64_t slo_misses = 0;  // Popped after their level's max_wait
+    uint64_t max_micros = 0;
+    
+    // Upper bound of the bucket holding quantile p (0..1), in microseconds
+    uint64_t percentile_micros(double p) const;
+};
+
+// What push does when the ring for an event's level is full
+enum class OverflowPolicy {
+    DROP,      // Lose the event
+    SPILL,     // Append it to a growable per-level buffer drained after the ring
+    BLOCK,     // Wait up to block_timeout for room, then drop
+    COALESCE   // Like SPILL, but a release whose press is still spilled is folded into it
+};
+
+struct OverflowConfig {
+    OverflowPolicy policy = OverflowPolicy::SPILL;
+    size_t spill_limit = 65536;  // Events per level; past it events are dropped
+    std::chrono::microseconds block_timeout{2000};
+    
+    // Backpressure: on_watermark(level, true) when a level's depth (ring plus spill)
+    // reaches high_watermark of the ring capacity, (level, false) once it is back down
+    // to low_watermark. Runs on the pushing or popping thread; keep it short.
+    double high_watermark = 0.75;
+    double low_watermark = 0.25;
+    std::function<void(EventPriority, bool)> on_watermark;
+    
+    // Drops are logged, and passed here as per-level counts since the last report, at
+    // most once per interval. Drops still unreported once the interval has passed go out
+    // with the next push or pop, or at shutdown(). Each level's next queued event also
+    // carries the count in ProcessingEvent::dropped_before.
+    std::chrono::milliseconds drop_report_interval{1000};
+    std::function<void(const std::array<uint64_t, EVENT_PRIORITY_LEVELS>&)> on_drops;
+};
+
 // Multi-priority event queue with statistics
-class EventQueue {
+template<typename RingPolicy>
+class BasicEventQueue {
 private:
     static constexpr size_t QUEUE_SIZE = 4096;
-    static constexpr size_t NUM_PRIORITIES = 4;
+    static constexpr size_t NUM_PRIORITIES = EVENT_PRIORITY_LEVELS;
     
-    std::array<LockFreeQueue<ProcessingEvent, QUEUE_SIZE>, NUM_PRIORITIES> queues_;
+    using Ring = typename RingPolicy::template Ring<ProcessingEvent, QUEUE_SIZE>;
+    std::array<Ring, NUM_PRIORITIES> queues_;
     
     // Statistics
     alignas(64) std::atomic<uint64_t> total_pushed_{0};
     alignas(64) std::atomic<uint64_t> total_popped_{0};
     alignas(64) std::atomic<uint64_t> drops_by_priority_[NUM_PRIORITIES];
     alignas(64) std::atomic<uint64_t> sequence_counter_{0};
+    alignas(64) std::atomic<uint64_t> parks_{0};
+    alignas(64) std::atomic<uint64_t> wakeups_{0};
+    
+    // Parking for wait_pop: consumers sleep on a futex over wake_epoch_, which producers
+    // bump only while waiters_ is non-zero, so pushes with nobody parked make no syscall
+    alignas(64) std::atomic<uint32_t> wake_epoch_{0};
+    alignas(64) std::atomic<uint32_t> waiters_{0};
+    std::atomic<bool> shutdown_{false};
     
     std::chrono::steady_clock::time_point start_time_;
+    
+    // Scheduling: schedule_ lists the level for each turn of one round
+    SchedulerConfig scheduler_;
+    std::array<uint8_t, NUM_PRIORITIES * SchedulerConfig::MAX_WEIGHT> schedule_{};
+    size_t schedule_length_ = 0;  // 0: strict priority
+    std::array<int64_t, NUM_PRIORITIES> max_wait_ns_{};
+    bool aging_ = false;
+    static constexpr uint64_t AGING_CHECK_INTERVAL = 4;  // Pops between looks at the ring fronts
+    alignas(64) std::atomic<uint64_t> turn_{0};
+    
+    struct alignas(64) WaitCounters {
+        std::atomic<uint64_t> counts[WaitHistogram::BUCKETS];
+        std::atomic<uint64_t> slo_misses;
+        std::atomic<uint64_t> max_micros;
+    };
+    std::array<WaitCounters, NUM_PRIORITIES> wait_counters_;
+    
+    // Overflow: while a level has spilled events, pushes to it append to the spill too
+    // and consumers take from the spill once the ring is empty, so each level stays FIFO
+    OverflowConfig overflow_config_;
+    struct alignas(64) Overflow {
+        std::mutex mutex;
+        std::deque<ProcessingEvent> spill;
+        std::unordered_map<int, uint32_t> open_presses;  // COALESCE: spilled presses per keycode awaiting release
+        std::atomic<size_t> spilled{0};        // spill.size(), readable without the lock
+        std::atomic<int64_t> front_stamp{0};   // Stamp of spill.front(), for aging
+        std::atomic<uint32_t> pending_drops{0};
+        std::atomic<uint64_t> unreported_drops{0};
+        std::atomic<bool> congested{false};
+    };
+    std::array<Overflow, NUM_PRIORITIES> overflow_;
+    alignas(64) std::atomic<int64_t> last_drop_report_{0};
+    std::atomic<bool> drops_unreported_{false};
+    std::atomic<uint64_t> total_spilled_{0};
+    std::atomic<uint64_t> coalesced_{0};
+    std::atomic<uint64_t> blocked_{0};
+    
+    size_t overflow_events(size_t level, const ProcessingEvent* events, size_t count, uint64_t first_id,
+                           size_t& coalesced);
+    size_t take_spilled(size_t level, ProcessingEvent* out, size_t max);
+    size_t take(size_t level, ProcessingEvent* out, size_t max);
+    void record_drops(size_t level, size_t count);
+    void report_drops(bool force);
+    void signal_pushed(size_t queued);
+    void update_congestion(size_t level, bool pushing);
+    size_t depth(size_t level) const;
+    
+    void wake_waiters(int count);
+    size_t next_level(int64_t now);
+    void record_wait(size_t level, const ProcessingEvent& event, int64_t now);
+    void clear_wait_counters();
 
 public:
-    EventQueue();
-    ~EventQueue() = default;
+    explicit BasicEventQueue(const SchedulerConfig& scheduler = SchedulerConfig(),
+                             const OverflowConfig& overflow = OverflowConfig());
+    ~BasicEventQueue() = default;
+    
+    // Not synchronized with push()/pop(): configure before producers and consumers start
+    void set_scheduler(const SchedulerConfig& scheduler);
+    const SchedulerConfig& get_scheduler() const { return scheduler_; }
+    void set_overflow(const OverflowConfig& overflow) { overflow_config_ = overflow; }
+    const OverflowConfig& get_overflow() const { return overflow_config_; }
     
-    // Push event with priority
+    // Push event with priority; false if it was dropped under the overflow policy
     bool push(const ProcessingEvent& event);
     bool push(const SimpleKeyEvent& key_event, EventPriority priority = EventPriority::NORMAL);
     
-    // Pop highest priority event
+    // Pop the next event as chosen by the scheduler
     bool pop(ProcessingEvent& event);
     
+    // Bulk versions for bursts (paste, replay): runs of same-priority events are claimed
+    // with one ring operation, and sequence ids and stats are updated once per batch.
+    // push_batch accepts a prefix of events and returns its length; the rest were dropped
+    // under the overflow policy, like a failed push(), and can be retried.
+    size_t push_batch(const ProcessingEvent* events, size_t count);
+    // Up to max events into out, the scheduler's level first, then from the highest level
+    // down while there is room; returns how many
+    size_t pop_batch(ProcessingEvent* out, size_t max);
+    
+    // Pop, waiting up to timeout for an event: spins briefly, then parks on a futex until
+    // a producer pushes. False on timeout, or once the queue is shut down and empty.
+    bool wait_pop(ProcessingEvent& event, std::chrono::nanoseconds timeout);
+    
+    // Events a producer can push at priority before this level overflows its ring
+    size_t credits(EventPriority priority) const;
+    
+    // Wake every waiter now; later wait_pop calls drain what is left without blocking.
+    // Drops not yet reported are reported now, whatever the interval.
+    void shutdown();
+    bool is_shutdown() const { return shutdown_.load(std::memory_order_acquire); }
+    
     // Statistics
     struct Stats {
         uint64_t total_pushed;
@@ -143,6 +541,13 @@ public:
         uint64_t total_dropped;
         std::array<uint64_t, NUM_PRIORITIES> drops_by_priority;
         std::array<size_t, NUM_PRIORITIES> current_sizes;
+        uint64_t parks;    // wait_pop calls that went to sleep
+        uint64_t wakeups;  // Pushes that had to wake a parked consumer
+        std::array<WaitHistogram, NUM_PRIORITIES> wait_times;
+        std::array<size_t, NUM_PRIORITIES> spilled;  // Currently held outside the rings
+        uint64_t total_spilled;
+        uint64_t coalesced;  // Key releases folded into their spilled press under COALESCE
+        uint64_t blocked;    // Pushes that had to wait for room under BLOCK
         double uptime_seconds;
         double events_per_second;
     };
@@ -156,4 +561,12 @@ public:
     double utilization() const;
 };
 
+// Input thread, web API and several workers share the queue, so MPMC is the default.
+// Instantiated for both policies in event_queue.cpp.
+using EventQueue = BasicEventQueue<MpmcRing>;
+using SpscEventQueue = BasicEventQueue<SpscRing>;
+
+extern template class BasicEventQueue<SpscRing>;
+extern template class BasicEventQueue<MpmcRing>;
+
 } // namespace crossexpand
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "core/advanced_template_engine.hpp"
+#include "core/event_queue.hpp"
+#include "core/trigger_matcher.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace crossexpand {
+
+// Keystroke -> trigger match -> expansion, for one consumer of the event queue. Key
+// presses advance a cursor over the shared TriggerMatcher; a completed shortcut is
+// expanded and handed to the sink together with the number of typed characters to erase.
+// Not thread-safe: each consumer thread owns its expander (the matcher may be shared).
+class KeystrokeExpander {
+public:
+    // Erase trigger_length typed characters, then insert expansion; false on failure
+    using InjectionSink = std::function<bool(size_t trigger_length, const std::string& expansion)>;
+    
+    // Without a matcher, one is built over the engine's shortcuts
+    KeystrokeExpander(std::shared_ptr<AdvancedTemplateEngine> engine, InjectionSink inject,
+                      std::shared_ptr<TriggerMatcher> matcher = nullptr);
+    
+    // True when the event completed a shortcut that was expanded and injected
+    bool process_event(const ProcessingEvent& event);
+    
+    // Consumer loop: parks in wait_pop between events and returns once should_stop() is
+    // true or the queue has been shut down and drained. poll bounds how long a stop
+    // request without a queue shutdown goes unnoticed. on_processed, if set, gets the
+    // processing time of every event.
+    using ProcessedCallback = std::function<void(std::chrono::steady_clock::duration)>;
+    void run(EventQueue& queue, const std::function<bool()>& should_stop,
+             const ProcessedCallback& on_processed = nullptr,
+             std::chrono::milliseconds poll = std::chrono::milliseconds(100));
+    
+    uint64_t get_expansions_performed() const { return expansions_performed_.load(); }
+    uint64_t get_template_lookups() const { return template_lookups_.load(); }
+
+private:
+    std::shared_ptr<AdvancedTemplateEngine> template_engine_;
+    InjectionSink inject_;
+    
+    // Trigger detection: shared automaton, per-consumer cursor
+    std::shared_ptr<TriggerMatcher> trigger_matcher_;
+    TriggerMatcher::Cursor trigger_cursor_;
+    uint64_t trigger_generation_ = 0;
+    
+    std::atomic<uint64_t> expansions_performed_{0};
+    std::atomic<uint64_t> template_lookups_{0};
+    
+    bool expand_and_inject(const std::string& shortcut, size_t trigger_length);
+};
+
+} // namespace crossexpand
@@ -6,6 +6,8 @@
 #include <mutex>
 #include <chrono>
 #include <cstddef>
+#include <cstring>
+#include <type_traits>
 #include <new>
 #include <string>
 #include <string_view>
@@ -289,6 +291,50 @@ public:
     }
 };
 
+// Monotonic (bump) arena for data that lives exactly as long as its owner,
+// e.g. the instruction stream of a compiled template. Individual frees are not supported.
+class MonotonicArena {
+private:
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char* cursor_;
+    size_t remaining_;
+    size_t block_size_;
+    size_t bytes_used_;
+    size_t bytes_reserved_;
+
+public:
+    explicit MonotonicArena(size_t block_size = 1024);
+    ~MonotonicArena() = default;
+    
+    // Non-copyable, non-movable (handed-out pointers must stay valid)
+    MonotonicArena(const MonotonicArena&) = delete;
+    MonotonicArena& operator=(const MonotonicArena&) = delete;
+    
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+    
+    // Copy trivially copyable data into the arena
+    template<typename T>
+    T* copy_array(const T* data, size_t count) {
+        static_assert(std::is_trivially_copyable<T>::value, "Arena arrays must be trivially copyable");
+        if (count == 0) return nullptr;
+        T* ptr = static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+        std::memcpy(ptr, data, sizeof(T) * count);
+        return ptr;
+    }
+    
+    std::string_view copy_string(std::string_view str);
+    
+    // Make sure the current block has size bytes free, opening one of exactly that size
+    // if not; owners that know their total up front avoid a half-empty default block
+    void reserve(size_t size);
+    
+    // Drop all blocks; previously returned pointers become invalid
+    void reset();
+    
+    size_t bytes_used() const { return bytes_used_; }
+    size_t bytes_reserved() const { return bytes_reserved_; }
+};
+
 // String interning pool for common strings
 class StringInternPool {
 private:
@@ -4,6 +4,7 @@
 #include "core/advanced_template_engine.hpp"
 #include "core/enhanced_text_injector.hpp"
 #include "core/input_manager.hpp"  // Add this include
+#include "core/keystroke_expander.hpp"
 #include "utils/logger.hpp"
 #include <thread>
 #include <atomic>
@@ -83,29 +84,22 @@ private:
     std::shared_ptr<AdvancedTemplateEngine> template_engine_;
     std::shared_ptr<EnhancedTextInjector> text_injector_;
     
-    // State management
-    std::string current_sequence_;
-    std::mutex sequence_mutex_;
-    
-    // Processing statistics
-    std::atomic<uint64_t> expansions_performed_{0};
-    std::atomic<uint64_t> template_lookups_{0};
+    // Trigger matching and expansion, with injection through text_injector_
+    KeystrokeExpander expander_;
 
 public:
     EventProcessorWorker(std::shared_ptr<EventQueue> queue,
                         std::shared_ptr<AdvancedTemplateEngine> engine,
                         std::shared_ptr<EnhancedTextInjector> injector,
-                        int worker_id);
+                        int worker_id,
+                        std::shared_ptr<TriggerMatcher> matcher = nullptr);
 
 protected:
     void run() override;
-    bool process_event(const ProcessingEvent& event);
-    bool check_for_template_trigger();
-    bool expand_and_inject_template(const std::string& shortcut);
     
 public:
-    uint64_t get_expansions_performed() const { return expansions_performed_.load(); }
-    uint64_t get_template_lookups() const { return template_lookups_.load(); }
+    uint64_t get_expansions_performed() const { return expander_.get_expansions_performed(); }
+    uint64_t get_template_lookups() const { return expander_.get_template_lookups(); }
 };
 
 // Health monitoring worker
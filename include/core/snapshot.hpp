@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace crossexpand {
+
+// Epoch-based reclamation for read-mostly data. Readers publish the epoch they entered
+// in a per-thread slot; an object retired at epoch E is freed once every active reader
+// entered after E. Entering and leaving never block, allocate or touch shared cache
+// lines other than the reader's own slot.
+class EpochDomain {
+public:
+    static constexpr size_t MAX_READERS = 256;
+    
+    static EpochDomain& global();
+    
+    EpochDomain() = default;
+    ~EpochDomain();
+    
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+    
+    // Re-entrant: nested enter/exit pairs on one thread only touch a counter
+    void enter();
+    void exit();
+    
+    // Queue ptr for deletion once no reader can still observe it
+    void retire(void* ptr, void (*deleter)(void*));
+    
+    // Free retired objects that are no longer reachable; returns how many were freed
+    size_t reclaim();
+    
+    size_t pending() const;
+
+private:
+    struct alignas(64) ReaderSlot {
+        std::atomic<uint64_t> epoch{0};  // 0 = not reading
+        std::atomic<bool> claimed{false};
+    };
+    
+    struct Retired {
+        void* ptr;
+        void (*deleter)(void*);
+        uint64_t epoch;
+    };
+    
+    struct ThreadRecord;
+    friend struct ThreadRecord;
+    
+    std::atomic<uint64_t> global_epoch_{1};
+    ReaderSlot slots_[MAX_READERS];
+    mutable std::mutex retire_mutex_;
+    std::vector<Retired> retired_;
+    
+    static ThreadRecord& local_record();
+    ReaderSlot* claim_slot();
+    uint64_t min_active_epoch() const;
+};
+
+// RAII reader section on the global domain
+class EpochGuard {
+public:
+    EpochGuard() { EpochDomain::global().enter(); }
+    ~EpochGuard() { EpochDomain::global().exit(); }
+    
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+};
+
+// Immutable value published through an atomically swapped pointer (RCU). Readers are
+// wait-free; writers copy the current value, modify the copy and publish it, so a batch
+// of changes made in one update() costs one copy and one swap.
+template<typename T>
+class SnapshotCell {
+private:
+    std::atomic<T*> current_;
+    std::mutex write_mutex_;  // Serializes writers only
+
+public:
+    class ReadGuard {
+    private:
+        EpochGuard guard_;  // Must be entered before current_ is loaded
+        const T* ptr_;
+    
+    public:
+        explicit ReadGuard(const std::atomic<T*>& cell) : ptr_(cell.load(std::memory_order_seq_cst)) {}
+        
+        const T& operator*() const { return *ptr_; }
+        const T* operator->() const { return ptr_; }
+        const T* get() const { return ptr_; }
+    };
+    
+    explicit SnapshotCell(std::unique_ptr<T> initial = std::make_unique<T>())
+        : current_(initial.release()) {}
+    
+    // Owners guarantee no readers remain when the cell is destroyed
+    ~SnapshotCell() { delete current_.load(); }
+    
+    SnapshotCell(const SnapshotCell&) = delete;
+    SnapshotCell& operator=(const SnapshotCell&) = delete;
+    
+    ReadGuard read() const { return ReadGuard(current_); }
+    
+    // Apply mutate(T&) to a copy of the current value and publish it if mutate returns true
+    template<typename Fn>
+    bool update(Fn&& mutate) {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        auto next = std::make_unique<T>(*current_.load(std::memory_order_relaxed));
+        if (!mutate(*next)) {
+            return false;
+        }
+        publish(std::move(next));
+        return true;
+    }
+    
+    // Replace the value outright
+    void reset(std::unique_ptr<T> next) {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        publish(std::move(next));
+    }
+
+private:
+    void publish(std::unique_ptr<T> next) {
+        T* old = current_.exchange(next.release(), std::memory_order_seq_cst);
+        EpochDomain::global().retire(old, [](void* ptr) { delete static_cast<T*>(ptr); });
+    }
+};
+
+} // namespace crossexpand
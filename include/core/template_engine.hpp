@@ -1,11 +1,17 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 #include <memory>
-#include <shared_mutex>
+#include <mutex>
 #include <unordered_set>
+#include <cstdint>
+#include <atomic>
+#include <functional>
+#include <optional>
+#include "core/snapshot.hpp"
 
 namespace crossexpand {
 
@@ -22,13 +28,78 @@ struct Template {
         : text(t), variables(vars) {}
 };
 
+// Literal, {variable} or {/shortcut} include span of a template's text, produced once by AddTemplate
+struct TemplateSegment {
+    enum class Kind : uint8_t {
+        LITERAL,
+        VARIABLE,
+        INCLUDE    // Name starts with '/': expands the referenced template in place
+    };
+    
+    Kind kind;
+    uint32_t offset;  // Start in Template::text (name for VARIABLE/INCLUDE, without braces)
+    uint32_t length;
+};
+
+// Template text plus whatever keeps it alive: a string of its own, or memory shared with
+// other templates such as a mapped TemplateStore. Copies share the text, never duplicate it.
+class SourceBuffer {
+public:
+    SourceBuffer() = default;
+    SourceBuffer(std::shared_ptr<const std::string> text) {
+        if (text) {
+            text_ = *text;
+            owned_bytes_ = text->capacity();
+            owner_ = std::move(text);
+        }
+    }
+    SourceBuffer(std::string_view text, std::shared_ptr<const void> owner)
+        : owner_(std::move(owner)), text_(text) {}
+    
+    std::string_view view() const { return text_; }
+    const char* data() const { return text_.data(); }
+    size_t size() const { return text_.size(); }
+    // Heap bytes held for this text alone; zero for a view into shared memory
+    size_t owned_bytes() const { return owned_bytes_; }
+    // True when both refer to the same bytes, e.g. one buffer shared by two engines
+    bool shares(const SourceBuffer& other) const {
+        return owner_ && owner_ == other.owner_ && text_.data() == other.text_.data();
+    }
+
+private:
+    std::shared_ptr<const void> owner_;
+    std::string_view text_{""};
+    size_t owned_bytes_ = 0;
+};
+
+// Resident bytes held for templates. Source buffers are shared between engines, so
+// totals count each buffer once.
+struct TemplateFootprint {
+    size_t source_bytes = 0;    // Template text as written
+    size_t compiled_bytes = 0;  // Segment tables, instruction streams and call tables
+    size_t linked_bytes = 0;    // Include-expanded text (basic engine, templates with includes)
+    
+    size_t total() const { return source_bytes + compiled_bytes + linked_bytes; }
+    TemplateFootprint& operator+=(const TemplateFootprint& other) {
+        source_bytes += other.source_bytes;
+        compiled_bytes += other.compiled_bytes;
+        linked_bytes += other.linked_bytes;
+        return *this;
+    }
+};
+
 class TemplateEngine {
 public:
     TemplateEngine();
     ~TemplateEngine() = default;
     
-    // Template management
-    void AddTemplate(const std::string& shortcut, const Template& tmpl);
+    // Template management. Templates whose includes would form a cycle are rejected.
+    bool AddTemplate(const std::string& shortcut, const Template& tmpl);
+    // Publishes all templates as one snapshot (preferred for config loads); returns how many were added
+    size_t AddTemplates(const std::vector<std::pair<std::string, Template>>& templates);
+    // Same, taking ownership of the text instead of copying it (bulk loaders). Templates
+    // without includes are tokenized on first expansion, so unused ones cost only their text.
+    size_t AddTemplates(std::vector<std::pair<std::string, Template>>&& templates);
     bool RemoveTemplate(const std::string& shortcut);
     bool HasTemplate(const std::string& shortcut) const;
     
@@ -37,19 +108,104 @@ public:
     
     // Variable management
     void SetVariable(const std::string& name, const std::string& value);
+    void SetVariables(const std::unordered_map<std::string, std::string>& variables);
     std::string GetVariable(const std::string& name) const;
     
     // Statistics
     size_t GetTemplateCount() const;
+    std::vector<std::string> GetShortcuts() const;
+    // Shortcuts that include this one, directly or transitively
+    std::vector<std::string> GetDependents(const std::string& shortcut) const;
+    // Bytes held for one template (all zero if unknown) and for the whole set
+    TemplateFootprint GetTemplateFootprint(const std::string& shortcut) const;
+    TemplateFootprint GetTotalFootprint() const;
+    
+    // Bumped whenever the template set changes (used to rebuild trigger matchers)
+    uint64_t GetGeneration() const { return generation_.load(std::memory_order_acquire); }
+    // Bumped whenever a global variable changes (used to invalidate cached expansions)
+    uint64_t GetVariablesGeneration() const { return variables_generation_.load(std::memory_order_acquire); }
     void ClearCache();
+    
+    // Split text into literal/variable spans (exposed for benchmarks and tests)
+    static std::vector<TemplateSegment> Tokenize(std::string_view text);
+
+protected:
+    // Publish templates whose text is already owned elsewhere (AdvancedTemplate sources):
+    // the buffer is shared, not copied. These are mostly expanded by the derived engine, so
+    // a text that cannot include anything is only tokenized here on its first expansion.
+    // Indices of sources rejected for an include cycle are appended to rejected.
+    size_t AddTemplateSources(std::vector<std::pair<std::string, SourceBuffer>> sources,
+                              std::vector<size_t>* rejected = nullptr);
+    // Source buffer of shortcut, empty if absent
+    SourceBuffer GetTemplateSource(const std::string& shortcut) const;
+    // Current global variables; values stay valid while the guard is alive
+    SnapshotCell<Context>::ReadGuard ReadGlobalVariables() const { return global_variables_.read(); }
+    // For derived engines whose own template set changed without a change here
+    void BumpGeneration() { generation_.fetch_add(1, std::memory_order_release); }
+    // Expand with caller values from lookup instead of one Context (layered callers);
+    // global variables are still searched after it
+    using VariableLookup = std::function<std::optional<std::string_view>(const std::string&)>;
+    std::string ExpandWithLookup(const std::string& shortcut, const VariableLookup& lookup) const;
 
 private:
-    mutable std::shared_mutex cache_mutex_;
-    std::unordered_map<std::string, Template> templates_;
-    std::unordered_map<std::string, std::string> global_variables_;
+    struct CompiledTemplate {
+        SourceBuffer source;                    // May be shared with other engines
+        // As written, including INCLUDE spans. Deferred templates (no "{/" in the text, so
+        // no includes) fill it, and the counts below, on first use; always read it through
+        // expansion_segments().
+        mutable std::vector<TemplateSegment> segments;
+        std::vector<std::string> includes;      // Distinct shortcuts referenced by {/name}
+        bool deferred = false;
+        mutable std::once_flag tokenized;
+        
+        // Includes inlined when the template (or anything it includes) is added or removed;
+        // unresolved includes become literal text. Only populated when includes is non-empty.
+        std::string linked_text;
+        std::vector<TemplateSegment> linked_segments;
+        mutable size_t literal_bytes = 0;
+        mutable size_t variable_count = 0;
+        
+        CompiledTemplate() = default;
+        // Relink copies templates with includes, which are never deferred
+        CompiledTemplate(const CompiledTemplate& other);
+        
+        std::string_view text() const { return includes.empty() ? source.view() : std::string_view(linked_text); }
+        TemplateFootprint footprint() const;
+        const std::vector<TemplateSegment>& expansion_segments() const;
+    };
+    
+    // Templates plus the reverse include graph, published together as one snapshot
+    struct TemplateSet {
+        std::unordered_map<std::string, std::shared_ptr<const CompiledTemplate>> templates;
+        std::unordered_map<std::string, std::vector<std::string>> dependents;  // Target may not exist yet
+    };
+    
+    using VariableMap = std::unordered_map<std::string, std::string>;
+    
+    // Readers never lock: lookups go through immutable snapshots, writers publish new ones
+    SnapshotCell<TemplateSet> templates_;
+    SnapshotCell<VariableMap> global_variables_;
+    std::atomic<uint64_t> generation_{0};
+    std::atomic<uint64_t> variables_generation_{0};
+    
+    static std::shared_ptr<CompiledTemplate> Compile(SourceBuffer source, bool defer = false);
+    static void CountSegments(const CompiledTemplate& compiled);
+    size_t Publish(std::vector<std::pair<std::string, std::shared_ptr<CompiledTemplate>>>& compiled,
+                   std::vector<size_t>* rejected = nullptr);
+    template<typename Lookup>
+    std::string ExpandVariables(const CompiledTemplate& compiled, const Lookup& lookup,
+                                const VariableMap& globals) const;
+    template<typename Lookup>
+    std::string ExpandShortcut(const std::string& shortcut, const Lookup& lookup) const;
     
-    std::string ExpandVariables(const std::string& text, const Context& context) const;
-    bool DetectCycle(const std::string& text, std::unordered_set<std::string>& visited) const;
+    // Include graph maintenance (writer side only)
+    static bool CreatesCycle(const TemplateSet& set, const std::string& shortcut, const CompiledTemplate& compiled);
+    static bool InsertTemplate(TemplateSet& set, const std::string& shortcut, std::shared_ptr<CompiledTemplate> compiled);
+    static void Link(CompiledTemplate& compiled, const TemplateSet& set);
+    static std::unordered_set<std::string> CollectDependents(const TemplateSet& set, const std::string& shortcut);
+    static void RelinkDependents(TemplateSet& set, const std::string& shortcut);
+    static void Relink(TemplateSet& set, const std::string& shortcut,
+                       const std::unordered_set<std::string>& affected, std::unordered_set<std::string>& done);
 };
 
 } // namespace crossexpand
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "core/advanced_template_engine.hpp"
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace crossexpand {
+
+struct StoreSpan;
+struct StoreRecord;
+
+// Precompiled templates in a binary file that is mmap()ed and executed in place.
+// The file holds a header, a record table sorted by shortcut and 8-byte aligned
+// sections: an interned string pool (shortcuts, sources, variable names) and each
+// template's compiled arrays and text pool. All references are file offsets, so
+// opening the store only validates bounds; nothing is parsed or copied.
+class TemplateStore {
+public:
+    ~TemplateStore();
+    
+    TemplateStore(const TemplateStore&) = delete;
+    TemplateStore& operator=(const TemplateStore&) = delete;
+    
+    // Map path read-only; nullptr if it is missing, truncated or written by an
+    // incompatible build
+    static std::shared_ptr<const TemplateStore> open(const std::string& path);
+    
+    // Write compiled templates to path, replacing any previous store atomically
+    static bool write(const std::string& path,
+                      const std::vector<std::pair<std::string, const AdvancedTemplate*>>& templates);
+    
+    // FNV-1a 64 of the template source, kept per record for a quick staleness check;
+    // the engine only reuses an image whose stored source matches byte for byte
+    static uint64_t hash_source(std::string_view source);
+    
+    size_t size() const { return record_count_; }
+    size_t mapped_bytes() const { return size_; }
+    
+    // Binary search over the sorted record table
+    std::optional<size_t> find(std::string_view shortcut) const;
+    
+    std::string_view shortcut(size_t index) const;
+    std::string_view source(size_t index) const;
+    uint64_t source_hash(size_t index) const;
+    // Views into the mapping; valid while this store is alive
+    CompiledImage image(size_t index) const;
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    const StoreRecord* records_ = nullptr;
+    size_t record_count_ = 0;
+    
+    TemplateStore() = default;
+    bool validate();
+    bool span_fits(const StoreSpan& span, size_t element_size) const;
+    std::string_view string(const StoreSpan& span) const;
+};
+
+} // namespace crossexpand
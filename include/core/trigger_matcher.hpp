@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace crossexpand {
+
+// Immutable Aho-Corasick automaton over a set of shortcuts. Missing transitions are
+// resolved through the failure links at build time, so every keystroke is one table
+// lookup regardless of how many shortcuts exist.
+class TriggerAutomaton {
+private:
+    std::array<uint16_t, 256> byte_class_{};   // 0 = byte used by no shortcut
+    size_t alphabet_size_ = 1;
+    std::vector<uint32_t> transitions_;        // state * alphabet_size_ + class
+    std::vector<int32_t> output_;              // Longest shortcut ending in state, -1 if none
+    std::vector<std::string> shortcuts_;
+    uint64_t generation_ = 0;
+
+public:
+    static std::shared_ptr<const TriggerAutomaton> build(std::vector<std::string> shortcuts,
+                                                         uint64_t generation = 0);
+    
+    static constexpr uint32_t ROOT = 0;
+    
+    uint32_t step(uint32_t state, char c) const {
+        return transitions_[state * alphabet_size_ + byte_class_[static_cast<unsigned char>(c)]];
+    }
+    
+    // Shortcut completed by entering state, or nullptr
+    const std::string* match(uint32_t state) const {
+        int32_t index = output_[state];
+        return index < 0 ? nullptr : &shortcuts_[index];
+    }
+    
+    size_t state_count() const { return output_.size(); }
+    size_t shortcut_count() const { return shortcuts_.size(); }
+    size_t memory_bytes() const;
+    uint64_t generation() const { return generation_; }
+};
+
+// Owns the current automaton and rebuilds it on a background thread when the
+// template set changes. Readers keep a Cursor and resync with one atomic load.
+class TriggerMatcher {
+public:
+    using ShortcutSource = std::function<std::vector<std::string>()>;
+    
+    // Per-consumer matching state over the keystroke stream
+    class Cursor {
+    private:
+        std::shared_ptr<const TriggerAutomaton> automaton_;
+        uint64_t version_ = 0;
+        uint32_t state_ = TriggerAutomaton::ROOT;
+        
+        friend class TriggerMatcher;
+
+    public:
+        // Feed one character; returns the completed shortcut (valid until the next sync)
+        const std::string* advance(char c) {
+            if (!automaton_) return nullptr;
+            state_ = automaton_->step(state_, c);
+            return automaton_->match(state_);
+        }
+        
+        void reset() { state_ = TriggerAutomaton::ROOT; }
+    };
+
+private:
+    ShortcutSource source_;
+    std::shared_ptr<const TriggerAutomaton> current_;
+    std::atomic<uint64_t> version_{0};
+    
+    // Background rebuild
+    std::thread builder_;
+    std::mutex builder_mutex_;
+    std::condition_variable builder_cv_;
+    uint64_t requested_generation_ = 0;
+    bool rebuild_pending_ = false;
+    bool stop_ = false;
+
+public:
+    explicit TriggerMatcher(ShortcutSource source);
+    ~TriggerMatcher();
+    
+    TriggerMatcher(const TriggerMatcher&) = delete;
+    TriggerMatcher& operator=(const TriggerMatcher&) = delete;
+    
+    // Schedule an asynchronous rebuild for the given template generation
+    void request_rebuild(uint64_t generation);
+    
+    // Build and publish synchronously (startup, tests)
+    void rebuild_now(uint64_t generation = 0);
+    
+    // Pick up a newly published automaton; resets the cursor when it changes
+    void sync(Cursor& cursor) const;
+    
+    std::shared_ptr<const TriggerAutomaton> snapshot() const;
+    uint64_t generation() const;
+
+private:
+    void publish(std::shared_ptr<const TriggerAutomaton> automaton);
+    void builder_loop();
+};
+
+} // namespace crossexpand
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "core/snapshot.hpp"
+#include "core/template_engine.hpp"
+
+namespace crossexpand {
+
+// Engine-wide interner that gives every variable name a dense ID at compile time.
+// IDs are never reused, so one SlotContext can feed every template of an engine.
+class VariableSymbols {
+public:
+    static constexpr uint32_t INVALID_ID = UINT32_MAX;
+    
+    // Find-or-add; only called while compiling
+    uint32_t intern(const std::string& name);
+    // INVALID_ID if the name has never been interned
+    uint32_t find(const std::string& name) const;
+    std::string name(uint32_t id) const;
+    
+    size_t size() const { return size_.load(std::memory_order_acquire); }
+
+private:
+    struct Table {
+        std::unordered_map<std::string, uint32_t> ids;
+        std::vector<std::string> names;
+    };
+    
+    SnapshotCell<Table> table_;
+    std::atomic<size_t> size_{0};
+};
+
+// Variable values indexed by VariableSymbols ID. Values are views, so the caller keeps
+// the referenced strings alive for the expansion; set_owned() stores its own copy.
+// Reading a slot is an array index: no hashing, no string copies.
+class SlotContext {
+private:
+    std::vector<std::optional<std::string_view>> values_;
+    std::vector<std::shared_ptr<const std::string>> owned_;  // Shared so copies stay valid
+    const Context* context_ = nullptr;
+
+public:
+    SlotContext() = default;
+    explicit SlotContext(size_t slot_count, const Context* context = nullptr)
+        : values_(slot_count), context_(context) {}
+    
+    void resize(size_t slot_count) { values_.resize(slot_count); }
+    size_t size() const { return values_.size(); }
+    
+    void set(uint32_t id, std::string_view value);
+    void set_owned(uint32_t id, std::string value);
+    void unset(uint32_t id);
+    void clear();
+    // Unset only ids and drop owned values; cheaper than clear() for a reused array
+    void reset(const std::vector<uint32_t>& ids);
+    
+    std::optional<std::string_view> get(uint32_t id) const {
+        return id < values_.size() ? values_[id] : std::nullopt;
+    }
+    
+    // Map handed to template functions and list providers; empty unless the slots were
+    // bound from a Context by the compatibility path
+    const Context& context() const;
+    void set_context(const Context* context) { context_ = context; }
+};
+
+// Variable maps searched in order without merging or copying them: typically the
+// caller's values, then the engine's global variables. System providers are the last
+// layer, resolved by the template that references them. Layers must outlive the chain.
+class ContextChain {
+public:
+    static constexpr size_t MAX_LAYERS = 4;
+    
+    ContextChain() = default;
+    // Layers in search order; null entries are skipped
+    explicit ContextChain(std::initializer_list<const Context*> layers);
+    
+    // Add a layer searched after the existing ones; false if the chain is full
+    bool push(const Context& layer);
+    // Copy with layer searched after all others, held in a slot reserved past MAX_LAYERS
+    // so that even a full chain takes it (the engine's global variables)
+    ContextChain with_fallback(const Context& layer) const;
+    size_t size() const { return size_; }
+    
+    // Value from the first layer that has name
+    std::optional<std::string_view> find(const std::string& name) const;
+    // First layer (the caller's values); handed to template functions
+    const Context& front() const;
+
+private:
+    const Context* layers_[MAX_LAYERS + 1] = {};
+    size_t size_ = 0;
+};
+
+} // namespace crossexpand
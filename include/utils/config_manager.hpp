@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <string>
 #include <nlohmann/json.hpp>
 #include "core/template_engine.hpp"
@@ -17,16 +18,33 @@ struct AppSettings {
 
 class ConfigManager {
 public:
+    // Receives each template as soon as the parser has read it; return false to stop
+    using TemplateSink = std::function<bool(std::string shortcut, Template tmpl)>;
+    
     ConfigManager();
     ~ConfigManager() = default;
     
-    // Configuration loading/saving
+    // Configuration loading/saving. Files are parsed with a streaming SAX handler, so no
+    // JSON document is built. Paths ending in .ndjson or .jsonl hold one template per line,
+    // {"shortcut": ..., "text": ..., "description": ..., "variables": [...]}; later lines
+    // replace earlier ones, so libraries can be extended by appending.
     bool LoadConfig(const std::string& config_path = "");
     bool SaveConfig(const std::string& config_path = "");
     
+    // Stream only the templates of a config or template file to sink
+    bool LoadTemplates(const std::string& path, const TemplateSink& sink);
+    // Stream templates straight into engine, publishing a snapshot every LOAD_BATCH
+    // templates so a large library is never held whole; returns how many were added. A
+    // file that fails part-way keeps the batches published before the error.
+    size_t LoadTemplatesInto(const std::string& path, TemplateEngine& engine);
+    static constexpr size_t LOAD_BATCH = 4096;
+    
+    static bool IsTemplateLinesFile(const std::string& path);
+    
     // Template access
     const std::unordered_map<std::string, Template>& GetTemplates() const;
     void SetTemplates(const std::unordered_map<std::string, Template>& templates);
+    void SetTemplates(std::unordered_map<std::string, Template>&& templates);
     
     // Variables access
     const std::unordered_map<std::string, std::string>& GetVariables() const;
@@ -38,6 +56,8 @@ public:
     
     // Default config path
     std::string GetDefaultConfigPath() const;
+    // Precompiled template store kept next to the config file
+    std::string GetTemplateStorePath() const;
 
 private:
     std::unordered_map<std::string, Template> templates_;
@@ -46,7 +66,7 @@ private:
     
     void CreateDefaultConfig();
     nlohmann::json SerializeToJson() const;
-    bool DeserializeFromJson(const nlohmann::json& json);
+    bool SaveTemplateLines(const std::string& path) const;
 };
 
 } // namespace crossexpand
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace crossexpand {
+
+// xoshiro256** (Blackman/Vigna): 32 bytes of state, a few cycles per draw. Not
+// cryptographic; use ThreadRandom::uuid_v4() where unpredictability matters.
+class Xoshiro256 {
+public:
+    // State expanded from seed with splitmix64, so any seed (including 0) is valid
+    explicit Xoshiro256(uint64_t seed);
+    Xoshiro256(uint64_t s0, uint64_t s1, uint64_t s2, uint64_t s3);
+    
+    uint64_t next();
+    // Uniform in [min, max] without modulo bias; bounds may come in either order
+    int64_t uniform(int64_t min, int64_t max);
+
+private:
+    uint64_t state_[4];
+};
+
+// Per-thread randomness for template functions. Nothing is shared between threads:
+// each thread's generator is seeded by one getrandom() call on first use, and UUIDs
+// draw kernel entropy from a per-thread buffer refilled ENTROPY_BUFFER bytes at a time.
+class ThreadRandom {
+public:
+    static Xoshiro256& generator();
+    static int64_t uniform(int64_t min, int64_t max) { return generator().uniform(min, max); }
+    
+    // RFC 4122 version 4 UUID in lowercase 8-4-4-4-12 form
+    static std::string uuid_v4();
+    // Same, written to out (36 characters, not terminated)
+    static void uuid_v4(char* out);
+    
+    static constexpr size_t ENTROPY_BUFFER = 4096;  // 256 UUIDs per refill
+};
+
+} // namespace crossexpand
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace crossexpand {
+
+// strftime-style format parsed once into literal spans and fields. Numeric fields and
+// day/month names (C locale, the only one this process uses) are written directly into
+// the output; anything else (%Z, %z, %c, flags, E/O modifiers, ...) goes to strftime
+// one conversion at a time.
+class TimeFormatter {
+public:
+    explicit TimeFormatter(std::string_view format);
+    
+    void format_to(std::string& out, const std::tm& tm) const;
+    std::string format(const std::tm& tm) const;
+    
+    const std::string& pattern() const { return pattern_; }
+
+private:
+    enum class Field : uint8_t {
+        LITERAL,       // Span copied as is
+        YEAR,          // %Y
+        YEAR_SHORT,    // %y
+        CENTURY,       // %C
+        MONTH,         // %m
+        DAY,           // %d
+        DAY_SPACE,     // %e
+        DAY_OF_YEAR,   // %j
+        HOUR,          // %H
+        HOUR_12,       // %I
+        MINUTE,        // %M
+        SECOND,        // %S
+        AM_PM,         // %p
+        WEEKDAY,       // %w (Sunday = 0)
+        WEEKDAY_ISO,   // %u (Monday = 1)
+        WEEKDAY_SHORT, // %a
+        WEEKDAY_LONG,  // %A
+        MONTH_SHORT,   // %b, %h
+        MONTH_LONG,    // %B
+        STRFTIME       // Single conversion passed to strftime
+    };
+    
+    struct Step {
+        Field field;
+        uint32_t offset;  // Span of expanded_ (LITERAL and STRFTIME only)
+        uint32_t length;
+    };
+    
+    std::string pattern_;
+    std::string expanded_;  // Pattern with %F, %T, %R and %D spelled out; steps index it
+    std::vector<Step> steps_;
+    
+    void add_literal(size_t offset, size_t length);
+};
+
+// Formats "now" for date/time variables and log timestamps. Each thread keeps the
+// broken-down local time of the current second and, per format (compiled on first use),
+// the string produced for that second, so repeated calls within a second only compare
+// and copy. Thread-safe: all state is thread-local and localtime_r is used.
+class LocalClock {
+public:
+    // Current local time
+    static std::string format_now(std::string_view format);
+    // Local time at second (callers that already read the clock)
+    static std::string format(std::time_t second, std::string_view format);
+    
+    // Broken-down local time at second; cached until a different second is asked for
+    static const std::tm& local_time(std::time_t second);
+    
+    static constexpr size_t MAX_CACHED_FORMATS = 16;  // Per thread
+};
+
+} // namespace crossexpand
@@ -1,235 +1,1069 @@
 #include "core/advanced_template_engine.hpp"
+#include "core/template_store.hpp"
 #include "utils/logger.hpp"
+#include "utils/time_formatter.hpp"
+#include "utils/fast_random.hpp"
 #include <chrono>
 #include <random>
 #include <sstream>
 #include <iomanip>
+#include <cctype>
+#include <charconv>
+#include <limits>
+#include <cstring>
+#include <cassert>
 #include <unistd.h>
 #include <pwd.h>
-#include <uuid/uuid.h>
+#include <thread>
 
 namespace crossexpand {
 
+namespace {
+
+constexpr uint32_t UNBOUND_SLOT = std::numeric_limits<uint32_t>::max();
+
+// Sources a compile worker claims at a time; smaller batches stay on the calling thread
+constexpr size_t COMPILE_GRAIN = 32;
+
+std::string_view trim(std::string_view text) {
+    size_t start = 0;
+    size_t end = text.size();
+    while (start < end && std::isspace(static_cast<unsigned char>(text[start]))) start++;
+    while (end > start && std::isspace(static_cast<unsigned char>(text[end - 1]))) end--;
+    return text.substr(start, end - start);
+}
+
+bool is_identifier(std::string_view text) {
+    if (text.empty() || !(std::isalpha(static_cast<unsigned char>(text[0])) || text[0] == '_')) {
+        return false;
+    }
+    return std::all_of(text.begin(), text.end(), [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    });
+}
+
+int parse_int(std::string_view text, int fallback) {
+    int value = fallback;
+    text = trim(text);
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() ? value : fallback;
+}
+
+// Feed an already complete expansion to a sink in chunk_size slices
+bool emit_chunks(std::string_view text, const ExpansionSink& sink, size_t chunk_size) {
+    chunk_size = std::max<size_t>(chunk_size, 1);
+    for (size_t offset = 0; offset < text.size(); offset += chunk_size) {
+        if (!sink(text.substr(offset, chunk_size))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Pop the next whitespace-separated word off the front of text
+std::string_view next_word(std::string_view& text) {
+    text = trim(text);
+    size_t end = 0;
+    while (end < text.size() && !std::isspace(static_cast<unsigned char>(text[end]))) end++;
+    std::string_view word = text.substr(0, end);
+    text = trim(text.substr(end));
+    return word;
+}
+
+// Operand stack bound for compiled conditions
+constexpr size_t MAX_CONDITION_DEPTH = 16;
+
+bool is_word_char(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+bool is_truthy(std::string_view value) {
+    return !value.empty() && value != "0" && value != "false";
+}
+
+std::string_view boolean_text(bool value) {
+    return value ? std::string_view("true") : std::string_view("false");
+}
+
+bool parse_number(std::string_view text, double& value) {
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return !text.empty() && result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+// Numeric comparison when both sides are numbers, byte-wise otherwise
+int compare_values(std::string_view lhs, std::string_view rhs) {
+    double a = 0, b = 0;
+    if (parse_number(lhs, a) && parse_number(rhs, b)) {
+        return a < b ? -1 : (a > b ? 1 : 0);
+    }
+    return lhs.compare(rhs);
+}
+
+// Compilation failure with the source offset of the offending tag
+struct CompileError : std::runtime_error {
+    size_t offset;
+    
+    CompileError(const std::string& message, size_t offset)
+        : std::runtime_error(message + " at offset " + std::to_string(offset)), offset(offset) {}
+};
+
+// Slot array for one Context expansion. Each thread reuses one array, so binding
+// allocates nothing once it has grown to the engine's symbol count; an expansion that
+// starts inside another (a function expanding a template) gets its own.
+class SlotLease {
+public:
+    SlotLease(size_t slot_count, const std::vector<uint32_t>& ids) : ids_(ids) {
+        Scratch& scratch = thread_scratch();
+        if (scratch.in_use) {
+            own_.emplace(slot_count);
+            slots_ = &*own_;
+            return;
+        }
+        scratch.in_use = true;
+        slots_ = &scratch.slots;
+        if (slots_->size() < slot_count) {
+            slots_->resize(slot_count);
+        }
+    }
+    
+    ~SlotLease() {
+        if (!own_) {
+            slots_->reset(ids_);  // Only the slots this template could have bound
+            thread_scratch().in_use = false;
+        }
+    }
+    
+    SlotLease(const SlotLease&) = delete;
+    SlotLease& operator=(const SlotLease&) = delete;
+    
+    SlotContext& slots() { return *slots_; }
+
+private:
+    struct Scratch {
+        SlotContext slots;
+        bool in_use = false;
+    };
+    
+    static Scratch& thread_scratch() {
+        thread_local Scratch scratch;
+        return scratch;
+    }
+    
+    const std::vector<uint32_t>& ids_;
+    std::optional<SlotContext> own_;
+    SlotContext* slots_ = nullptr;
+};
+
+} // namespace
+
+// Compile-time accumulator for the instruction stream. The text pool is the source
+// itself: every literal, name and argument is a view into it, stored as an offset.
+struct AdvancedTemplate::ProgramBuilder {
+    std::string_view source;
+    std::vector<Instruction> code;
+    std::vector<FunctionCall> calls;
+    std::vector<CallArgument> args;
+    std::vector<LoopInfo> loops;
+    std::vector<ConditionOp> conditions;
+    std::vector<std::string> loop_scope; // Loop variable per frame, innermost last
+    
+    // Open {%if%} / {%for%} block awaiting its end tag
+    struct Block {
+        bool is_loop;
+        size_t begin;         // JUMP_IF_FALSE or LOOP_BEGIN instruction to patch
+        uint32_t loop_index;
+        uint32_t body;        // First body instruction (loops)
+        size_t source_offset; // Opening tag, for error messages
+    };
+    std::vector<Block> blocks;
+    uint32_t max_loop_depth = 0;
+    size_t last_label = 0; // Highest instruction index used as a jump target
+    
+    // Frame of the innermost enclosing loop binding name, or UINT32_MAX
+    uint32_t loop_frame(std::string_view name) const {
+        for (size_t i = loop_scope.size(); i > 0; --i) {
+            if (loop_scope[i - 1] == name) {
+                return static_cast<uint32_t>(i - 1);
+            }
+        }
+        return UNBOUND_SLOT;
+    }
+    
+    uint32_t add_text(std::string_view str) const {
+        assert(str.data() >= source.data() && str.data() + str.size() <= source.data() + source.size());
+        return static_cast<uint32_t>(str.data() - source.data());
+    }
+    
+    void emit_text(std::string_view str) {
+        if (str.empty()) return;
+        
+        // Merge with the previous literal when they are adjacent in the source and no jump
+        // lands between them
+        uint32_t offset = add_text(str);
+        if (!code.empty() && last_label < code.size() && code.back().op == OpCode::EMIT_TEXT &&
+            code.back().a + code.back().b == offset) {
+            code.back().b += static_cast<uint32_t>(str.size());
+            return;
+        }
+        
+        code.push_back({OpCode::EMIT_TEXT, offset, static_cast<uint32_t>(str.size()), 0});
+    }
+    
+    // Upper bound of the arena space compile() copies the program into, alignment included
+    size_t arena_bytes() const {
+        return code.size() * sizeof(Instruction) + alignof(Instruction) +
+               calls.size() * sizeof(FunctionCall) + alignof(FunctionCall) +
+               args.size() * sizeof(CallArgument) + alignof(CallArgument) +
+               loops.size() * sizeof(LoopInfo) + alignof(LoopInfo) +
+               conditions.size() * sizeof(ConditionOp) + alignof(ConditionOp);
+    }
+    
+    uint32_t label() {
+        last_label = code.size();
+        return static_cast<uint32_t>(code.size());
+    }
+};
+
+// Execution state of one active loop. Items are views into the context value, the
+// enclosing loop's item or the provider's cursor, so iterating never copies.
+struct AdvancedTemplate::LoopFrame {
+    std::string_view item;
+    const char* next = nullptr;  // Remaining newline-separated items
+    const char* end = nullptr;
+    std::unique_ptr<ListCursor> cursor;
+    
+    void open_lines(std::string_view list) {
+        next = list.data();
+        end = list.data() + list.size();
+    }
+    
+    bool advance() {
+        if (cursor) {
+            return cursor->next(item);
+        }
+        if (next >= end) {
+            return false;
+        }
+        
+        const char* newline = static_cast<const char*>(std::memchr(next, '\n', end - next));
+        const char* stop = newline ? newline : end;
+        item = std::string_view(next, stop - next);
+        if (!item.empty() && item.back() == '\r') {
+            item.remove_suffix(1);
+        }
+        next = newline ? newline + 1 : end;
+        return true;
+    }
+    
+    void close() {
+        cursor.reset();
+        next = end = nullptr;
+    }
+};
+
 // AdvancedTemplate Implementation
-AdvancedTemplate::AdvancedTemplate(const std::string& source) 
-    : source_(source), is_compiled_(false) {
-    LOG_DEBUG("Created advanced template with {} characters", source.length());
+AdvancedTemplate::AdvancedTemplate(const std::string& source, FunctionRegistry* registry, VariableSymbols* symbols)
+    : AdvancedTemplate(SourceBuffer(std::make_shared<const std::string>(source)), registry, symbols) {
+}
+
+AdvancedTemplate::AdvancedTemplate(SourceBuffer source, FunctionRegistry* registry, VariableSymbols* symbols)
+    : source_(std::move(source)), registry_(registry), symbols_(symbols), is_compiled_(false) {
+    if (!symbols_) {
+        own_symbols_ = std::make_unique<VariableSymbols>();
+        symbols_ = own_symbols_.get();
+    }
+    LOG_DEBUG("Created advanced template with {} characters", source_.size());
 }
 
 bool AdvancedTemplate::compile() {
+    const auto start = std::chrono::steady_clock::now();
+    compile_error_.clear();
+    error_offset_ = 0;
     try {
-        size_t pos = 0;
-        root_ = parse(source_, pos);
-        extract_variables(*root_);
-        is_compiled_ = true;
-        LOG_DEBUG("Successfully compiled template");
+        required_variables_.clear();
+        variable_ids_.clear();
+        system_variables_.clear();
+        system_variable_ids_.clear();
+        
+        // One forward pass emits the instruction array; text stays in the source
+        ProgramBuilder builder;
+        builder.source = source_.view();
+        scan(builder);
+        
+        arena_.reset();
+        backing_.reset();
+        arena_.reserve(builder.arena_bytes());
+        text_ = source_.data();
+        text_size_ = static_cast<uint32_t>(source_.size());
+        code_ = arena_.copy_array(builder.code.data(), builder.code.size());
+        code_size_ = builder.code.size();
+        calls_ = arena_.copy_array(builder.calls.data(), builder.calls.size());
+        call_count_ = static_cast<uint32_t>(builder.calls.size());
+        args_ = arena_.copy_array(builder.args.data(), builder.args.size());
+        arg_count_ = static_cast<uint32_t>(builder.args.size());
+        loops_ = arena_.copy_array(builder.loops.data(), builder.loops.size());
+        loop_count_ = static_cast<uint32_t>(builder.loops.size());
+        loop_depth_ = builder.max_loop_depth;
+        conditions_ = arena_.copy_array(builder.conditions.data(), builder.conditions.size());
+        condition_count_ = static_cast<uint32_t>(builder.conditions.size());
+        
+        finish_compile(start);
+        LOG_DEBUG("Successfully compiled template ({} instructions)", code_size_);
         return true;
     } catch (const std::exception& e) {
+        auto* error = dynamic_cast<const CompileError*>(&e);
+        compile_error_ = e.what();
+        error_offset_ = error ? error->offset : 0;
+        compile_time_ = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
         LOG_ERROR("Template compilation failed: {}", e.what());
         is_compiled_ = false;
         return false;
     }
 }
 
+TemplateFootprint AdvancedTemplate::footprint() const {
+    TemplateFootprint bytes;
+    bytes.source_bytes = source_.owned_bytes();
+    bytes.compiled_bytes = arena_.bytes_reserved() +
+                           required_variables_.capacity() * sizeof(std::string) +
+                           (variable_ids_.capacity() + system_variable_ids_.capacity()) * sizeof(uint32_t) +
+                           system_variables_.capacity() * sizeof(const SystemVariableProvider*);
+    for (const auto& name : required_variables_) {
+        bytes.compiled_bytes += name.capacity();
+    }
+    return bytes;
+}
+
+void AdvancedTemplate::finish_compile(std::chrono::steady_clock::time_point start) {
+    literal_bytes_ = 0;
+    for (size_t i = 0; i < code_size_; ++i) {
+        if (code_[i].op == OpCode::EMIT_TEXT) {
+            literal_bytes_ += code_[i].b;
+        }
+    }
+    
+    is_compiled_ = true;
+    update_cacheability();
+    compile_time_ = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+}
+
+CompiledImage AdvancedTemplate::image() const {
+    CompiledImage image;
+    image.code = code_;
+    image.code_size = static_cast<uint32_t>(code_size_);
+    image.calls = calls_;
+    image.call_count = call_count_;
+    image.args = args_;
+    image.arg_count = arg_count_;
+    image.loops = loops_;
+    image.loop_count = loop_count_;
+    image.conditions = conditions_;
+    image.condition_count = condition_count_;
+    image.text = text_;
+    image.text_size = text_size_;
+    image.loop_depth = loop_depth_;
+    image.variables.assign(required_variables_.begin(), required_variables_.end());
+    return image;
+}
+
+bool AdvancedTemplate::check_image(const CompiledImage& image) const {
+    // Images may come from disk: every index must stay inside its table before we run it
+    auto in_text = [&](uint64_t offset, uint64_t length) { return offset + length <= image.text_size; };
+    const uint64_t variable_count = image.variables.size();
+    auto stack_fits = [&](uint32_t first, uint32_t count) {
+        size_t depth = 0;
+        for (uint32_t i = first; i < first + count; ++i) {
+            ConditionOp::Kind kind = image.conditions[i].kind;
+            size_t pops = kind <= ConditionOp::Kind::LITERAL ? 0 : kind == ConditionOp::Kind::NOT ? 1 : 2;
+            if (depth < pops || (pops == 0 && depth == MAX_CONDITION_DEPTH)) return false;
+            depth = pops == 0 ? depth + 1 : depth - pops + 1;
+        }
+        return true;
+    };
+    
+    for (uint32_t i = 0; i < image.code_size; ++i) {
+        const Instruction& ins = image.code[i];
+        bool ok = ins.target <= image.code_size;
+        switch (ins.op) {
+            case OpCode::EMIT_TEXT: ok = ok && in_text(ins.a, ins.b); break;
+            case OpCode::EMIT_VARIABLE: ok = ok && ins.a < variable_count; break;
+            case OpCode::CALL_FUNCTION: ok = ok && ins.a < image.call_count; break;
+            case OpCode::JUMP_IF_FALSE:
+                ok = ok && uint64_t(ins.a) + ins.b <= image.condition_count && stack_fits(ins.a, ins.b);
+                break;
+            case OpCode::LOOP_BEGIN:
+            case OpCode::LOOP_NEXT: ok = ok && ins.a < image.loop_count; break;
+            case OpCode::EMIT_LOOP_VARIABLE: ok = ok && ins.a < image.loop_depth; break;
+            default: ok = false; break;
+        }
+        if (!ok) return false;
+    }
+    
+    for (uint32_t i = 0; i < image.call_count; ++i) {
+        const FunctionCall& call = image.calls[i];
+        if (uint64_t(call.first_arg) + call.arg_count > image.arg_count || !in_text(call.name_offset, call.name_length)) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < image.arg_count; ++i) {
+        const CallArgument& arg = image.args[i];
+        bool ok = arg.kind == CallArgument::Kind::LITERAL ? in_text(arg.offset, arg.length)
+            : arg.kind == CallArgument::Kind::VARIABLE ? arg.offset < variable_count
+            : arg.kind == CallArgument::Kind::LOOP_VARIABLE && arg.offset < image.loop_depth;
+        if (!ok) return false;
+    }
+    for (uint32_t i = 0; i < image.loop_count; ++i) {
+        const LoopInfo& loop = image.loops[i];
+        bool ok = loop.frame < image.loop_depth && (loop.source_frame == UNBOUND_SLOT
+            ? loop.list_variable < variable_count : loop.source_frame < loop.frame);
+        if (!ok) return false;
+    }
+    for (uint32_t i = 0; i < image.condition_count; ++i) {
+        const ConditionOp& op = image.conditions[i];
+        bool ok = op.kind == ConditionOp::Kind::VARIABLE ? op.a < variable_count
+            : op.kind == ConditionOp::Kind::LOOP_VARIABLE ? op.a < image.loop_depth
+            : op.kind == ConditionOp::Kind::LITERAL ? in_text(op.a, op.b)
+            : op.kind <= ConditionOp::Kind::NOT;
+        if (!ok) return false;
+    }
+    return true;
+}
+
+bool AdvancedTemplate::load_image(const CompiledImage& image, std::shared_ptr<const void> backing) {
+    const auto start = std::chrono::steady_clock::now();
+    compile_error_.clear();
+    error_offset_ = 0;
+    if (!check_image(image)) {
+        LOG_ERROR("Rejected malformed precompiled template image");
+        is_compiled_ = false;
+        return false;
+    }
+    
+    required_variables_.clear();
+    variable_ids_.clear();
+    system_variables_.clear();
+    system_variable_ids_.clear();
+    required_variables_.reserve(image.variables.size());
+    variable_ids_.reserve(image.variables.size());
+    for (std::string_view name : image.variables) {
+        variable_index(std::string(name));
+    }
+    if (required_variables_.size() != image.variables.size()) {
+        LOG_ERROR("Rejected precompiled template image with duplicate variables");
+        is_compiled_ = false;
+        return false;
+    }
+    
+    arena_.reset();
+    backing_ = std::move(backing);
+    code_ = image.code;
+    code_size_ = image.code_size;
+    args_ = image.args;
+    arg_count_ = image.arg_count;
+    conditions_ = image.conditions;
+    condition_count_ = image.condition_count;
+    text_ = image.text;
+    text_size_ = image.text_size;
+    loop_depth_ = image.loop_depth;
+    
+    // Registry slots are per engine, so call and loop tables are copied and rebound by name
+    FunctionCall* calls = arena_.copy_array(image.calls, image.call_count);
+    for (uint32_t i = 0; i < image.call_count; ++i) {
+        std::string name(text_ + calls[i].name_offset, calls[i].name_length);
+        calls[i].slot = registry_ ? static_cast<uint32_t>(registry_->resolve_slot(name)) : UNBOUND_SLOT;
+    }
+    calls_ = calls;
+    call_count_ = image.call_count;
+    
+    LoopInfo* loops = arena_.copy_array(image.loops, image.loop_count);
+    for (uint32_t i = 0; i < image.loop_count; ++i) {
+        loops[i].list_slot = registry_ && loops[i].source_frame == UNBOUND_SLOT
+            ? static_cast<uint32_t>(registry_->resolve_list_slot(required_variables_[loops[i].list_variable]))
+            : UNBOUND_SLOT;
+    }
+    loops_ = loops;
+    loop_count_ = image.loop_count;
+    
+    finish_compile(start);
+    return true;
+}
+
 std::string AdvancedTemplate::execute(const Context& context) const {
+    std::string result;
+    execute_into(result, context);
+    return result;
+}
+
+void AdvancedTemplate::execute_into(std::string& output, const Context& context) const {
+    SlotContext slots(symbols_->size(), &context);
+    bind_context(context, slots);
+    execute_into(output, slots);
+}
+
+void AdvancedTemplate::bind_context(const Context& context, SlotContext& slots) const {
+    bind_context(ContextChain{&context}, slots);
+}
+
+void AdvancedTemplate::bind_context(const ContextChain& chain, SlotContext& slots) const {
+    for (size_t i = 0; i < required_variables_.size(); ++i) {
+        if (auto value = chain.find(required_variables_[i])) {
+            slots.set(variable_ids_[i], *value);
+        }
+    }
+}
+
+void AdvancedTemplate::bind_system_variables(SlotContext& slots) const {
+    // Resolve only the system variables this template references and nobody has set;
+    // deterministic ones (username, hostname) are viewed, not resolved and copied again
+    for (size_t i = 0; i < system_variables_.size(); ++i) {
+        if (slots.get(system_variable_ids_[i])) {
+            continue;
+        }
+        const SystemVariableProvider& provider = *system_variables_[i];
+        if (provider.deterministic) {
+            slots.set(system_variable_ids_[i], SystemVariables::memoized(provider));
+        } else {
+            slots.set_owned(system_variable_ids_[i], provider.resolve());
+        }
+    }
+}
+
+void AdvancedTemplate::execute_into(std::string& output, const SlotContext& slots) const {
+    output.reserve(output.size() + literal_bytes_ + required_variables_.size() * 16);
+    run(output, slots, nullptr, 0);
+}
+
+bool AdvancedTemplate::execute_streaming(const SlotContext& slots, const ExpansionSink& sink, size_t chunk_size) const {
+    // Instructions append to a buffer that is handed to the sink whenever it reaches
+    // chunk_size, so the first chunk leaves before the rest has been produced
+    chunk_size = std::max<size_t>(chunk_size, 1);
+    std::string buffer;
+    buffer.reserve(chunk_size + 64);
+    return run(buffer, slots, &sink, chunk_size);
+}
+
+bool AdvancedTemplate::run(std::string& output, const SlotContext& slots, const ExpansionSink* sink,
+                           size_t chunk_size) const {
     if (!is_compiled_) {
         LOG_ERROR("Cannot execute uncompiled template");
-        return "";
+        return false;
+    }
+    
+    const size_t start_size = output.size();
+    
+    // Loop frames live on the stack unless loops nest unusually deep
+    constexpr size_t INLINE_FRAMES = 4;
+    LoopFrame inline_frames[INLINE_FRAMES];
+    std::vector<LoopFrame> overflow_frames;
+    LoopFrame* frames = inline_frames;
+    if (loop_depth_ > INLINE_FRAMES) {
+        overflow_frames.resize(loop_depth_);
+        frames = overflow_frames.data();
     }
     
     try {
-        return execute_node(*root_, context);
+        size_t pc = 0;
+        while (pc < code_size_) {
+            if (sink && output.size() >= chunk_size) {
+                if (!(*sink)(output)) {
+                    return false;
+                }
+                output.clear();
+            }
+            
+            const Instruction& ins = code_[pc];
+            switch (ins.op) {
+                case OpCode::EMIT_TEXT:
+                    output.append(text_ + ins.a, ins.b);
+                    break;
+                
+                case OpCode::EMIT_VARIABLE: {
+                    const std::string& name = required_variables_[ins.a];
+                    if (auto value = slots.get(variable_ids_[ins.a])) {
+                        output += *value;
+                    } else {
+                        output += '{';
+                        output += name;
+                        output += '}'; // Keep original if not found
+                    }
+                    break;
+                }
+                
+                case OpCode::CALL_FUNCTION:
+                    execute_function(calls_[ins.a], slots, frames, output);
+                    break;
+                
+                case OpCode::JUMP_IF_FALSE:
+                    if (!evaluate_condition(conditions_ + ins.a, ins.b, slots, frames)) {
+                        pc = ins.target;
+                        continue;
+                    }
+                    break;
+                
+                case OpCode::LOOP_BEGIN: {
+                    const LoopInfo& loop = loops_[ins.a];
+                    LoopFrame& frame = frames[loop.frame];
+                    if (loop.source_frame != UNBOUND_SLOT) {
+                        frame.open_lines(frames[loop.source_frame].item);
+                    } else {
+                        // A context value shadows a registered list provider of the same name
+                        if (auto value = slots.get(variable_ids_[loop.list_variable])) {
+                            frame.open_lines(*value);
+                        } else if (registry_ && loop.list_slot != UNBOUND_SLOT) {
+                            frame.cursor = registry_->open_list(loop.list_slot, slots.context());
+                        }
+                    }
+                    
+                    if (!frame.advance()) {
+                        frame.close();
+                        pc = ins.target;
+                        continue;
+                    }
+                    break;
+                }
+                
+                case OpCode::LOOP_NEXT: {
+                    LoopFrame& frame = frames[loops_[ins.a].frame];
+                    if (frame.advance()) {
+                        pc = ins.target;
+                        continue;
+                    }
+                    frame.close();
+                    break;
+                }
+                
+                case OpCode::EMIT_LOOP_VARIABLE:
+                    output += frames[ins.a].item;
+                    break;
+            }
+            
+            ++pc;
+        }
+        
+        if (sink && !output.empty()) {
+            bool accepted = (*sink)(output);
+            output.clear();
+            return accepted;
+        }
+        return true;
     } catch (const std::exception& e) {
         LOG_ERROR("Template execution failed: {}", e.what());
-        return "";
+        // Chunks already handed to a sink cannot be recalled
+        output.resize(sink ? 0 : start_size);
+        return false;
     }
 }
 
-std::shared_ptr<TemplateNode> AdvancedTemplate::parse(const std::string& text, size_t& pos) {
-    auto root = std::make_shared<TemplateNode>(NodeType::LITERAL);
-    std::string current_literal;
+void AdvancedTemplate::scan(ProgramBuilder& builder) {
+    const std::string_view text = source_.view();
+    const char* const begin = text.data();
+    size_t literal_start = 0;
+    size_t pos = 0;
     
-    while (pos < text.length()) {
-        if (text.substr(pos, 2) == "{%") {
-            // Control structure
-            if (!current_literal.empty()) {
-                auto literal_node = std::make_shared<TemplateNode>(NodeType::LITERAL, current_literal);
-                root->children.push_back(literal_node);
-                current_literal.clear();
-            }
-            
-            // Find the matching %}
-            size_t end_pos = text.find("%}", pos + 2);
-            if (end_pos == std::string::npos) {
-                throw std::runtime_error("Unclosed control structure");
-            }
-            
-            std::string control = text.substr(pos + 2, end_pos - pos - 2);
-            pos = end_pos + 2;
-            
-            if (control.substr(0, 2) == "if") {
-                root->children.push_back(parse_conditional(text, pos));
-            } else if (control.substr(0, 3) == "for") {
-                root->children.push_back(parse_loop(text, pos));
-            }
-        } else if (text.substr(pos, 2) == "{{") {
-            // Variable or function
-            if (!current_literal.empty()) {
-                auto literal_node = std::make_shared<TemplateNode>(NodeType::LITERAL, current_literal);
-                root->children.push_back(literal_node);
-                current_literal.clear();
-            }
-            
-            size_t end_pos = text.find("}}", pos + 2);
-            if (end_pos == std::string::npos) {
-                throw std::runtime_error("Unclosed variable");
-            }
-            
-            std::string var_content = text.substr(pos + 2, end_pos - pos - 2);
-            pos = end_pos + 2;
-            
-            if (var_content.find('(') != std::string::npos) {
-                // Function call
-                auto func_node = std::make_shared<TemplateNode>(NodeType::FUNCTION_CALL, var_content);
-                root->children.push_back(func_node);
-            } else {
-                // Simple variable
-                auto var_node = std::make_shared<TemplateNode>(NodeType::VARIABLE, var_content);
-                root->children.push_back(var_node);
-            }
+    while (pos < text.size()) {
+        // Jump straight to the next '{'; everything before it is literal text
+        const void* hit = std::memchr(begin + pos, '{', text.size() - pos);
+        if (!hit) break;
+        size_t open = static_cast<const char*>(hit) - begin;
+        if (open + 1 >= text.size() || (text[open + 1] != '{' && text[open + 1] != '%')) {
+            pos = open + 1;
+            continue;
+        }
+        
+        const bool is_control = text[open + 1] == '%';
+        size_t close = text.find(is_control ? "%}" : "}}", open + 2);
+        if (close == std::string_view::npos) {
+            throw CompileError(is_control ? "Unclosed control structure" : "Unclosed variable", open);
+        }
+        
+        builder.emit_text(text.substr(literal_start, open - literal_start));
+        std::string_view tag = trim(text.substr(open + 2, close - open - 2));
+        if (is_control) {
+            scan_control(tag, open, builder);
+        } else if (tag.find('(') != std::string_view::npos) {
+            emit_function_call(tag, builder);
         } else {
-            current_literal += text[pos];
-            pos++;
+            emit_variable(tag, builder);
         }
+        pos = literal_start = close + 2;
     }
+    builder.emit_text(text.substr(literal_start));
     
-    if (!current_literal.empty()) {
-        auto literal_node = std::make_shared<TemplateNode>(NodeType::LITERAL, current_literal);
-        root->children.push_back(literal_node);
+    if (!builder.blocks.empty()) {
+        const auto& block = builder.blocks.back();
+        throw CompileError(block.is_loop ? "Unclosed loop" : "Unclosed conditional", block.source_offset);
     }
-    
-    return root;
 }
 
-std::shared_ptr<TemplateNode> AdvancedTemplate::parse_conditional(const std::string& text, size_t& pos) {
-    // Find the condition in the opening tag
-    size_t if_start = text.rfind("{%", pos);
-    size_t if_end = text.find("%}", if_start);
-    std::string if_tag = text.substr(if_start + 2, if_end - if_start - 2);
+void AdvancedTemplate::scan_control(std::string_view tag, size_t offset, ProgramBuilder& builder) {
+    auto fail = [&](const char* reason) {
+        throw CompileError(std::string(reason) + " '{%" + std::string(tag) + "%}'", offset);
+    };
     
-    auto cond_node = std::make_shared<TemplateNode>(NodeType::CONDITIONAL);
+    std::string_view rest = tag;
+    std::string_view keyword = next_word(rest);
     
-    // Extract condition (after "if ")
-    if (if_tag.length() > 3) {
-        cond_node->attributes["condition"] = if_tag.substr(3);
+    if (keyword == "if" || (keyword.size() > 2 && keyword.compare(0, 3, "if(") == 0)) {
+        // An empty or malformed condition throws, failing the whole template
+        uint32_t first = static_cast<uint32_t>(builder.conditions.size());
+        emit_condition(tag.substr(2), builder);
+        uint32_t count = static_cast<uint32_t>(builder.conditions.size()) - first;
+        builder.blocks.push_back({false, builder.code.size(), 0, 0, offset});
+        builder.code.push_back({OpCode::JUMP_IF_FALSE, first, count, 0});
+    } else if (keyword == "for") {
+        std::string_view variable = next_word(rest);
+        std::string_view in = next_word(rest);
+        std::string_view list = next_word(rest);
+        if (in != "in" || !is_identifier(variable) || !is_identifier(list) || !trim(rest).empty()) {
+            fail("Malformed loop");
+        }
+        
+        LoopInfo loop;
+        loop.source_frame = builder.loop_frame(list);
+        loop.list_variable = loop.source_frame == UNBOUND_SLOT ? variable_index(std::string(list)) : UNBOUND_SLOT;
+        loop.list_slot = registry_ && loop.source_frame == UNBOUND_SLOT
+            ? static_cast<uint32_t>(registry_->resolve_list_slot(std::string(list))) : UNBOUND_SLOT;
+        loop.frame = static_cast<uint32_t>(builder.loop_scope.size());
+        
+        uint32_t loop_index = static_cast<uint32_t>(builder.loops.size());
+        builder.loops.push_back(loop);
+        size_t begin_index = builder.code.size();
+        builder.code.push_back({OpCode::LOOP_BEGIN, loop_index, 0, 0});
+        builder.blocks.push_back({true, begin_index, loop_index, builder.label(), offset});
+        
+        builder.loop_scope.emplace_back(variable);
+        builder.max_loop_depth = std::max(builder.max_loop_depth, static_cast<uint32_t>(builder.loop_scope.size()));
+    } else if (keyword == "endif" || keyword == "endfor") {
+        const bool is_loop = keyword == "endfor";
+        if (builder.blocks.empty() || builder.blocks.back().is_loop != is_loop || !rest.empty()) {
+            fail("Unexpected");
+        }
+        
+        ProgramBuilder::Block block = builder.blocks.back();
+        builder.blocks.pop_back();
+        if (is_loop) {
+            builder.loop_scope.pop_back();
+            builder.code.push_back({OpCode::LOOP_NEXT, block.loop_index, 0, block.body});
+        }
+        builder.code[block.begin].target = builder.label();
+    } else {
+        fail("Unknown control tag");
+    }
+}
+
+void AdvancedTemplate::emit_variable(std::string_view name, ProgramBuilder& builder) {
+    uint32_t frame = builder.loop_frame(name);
+    if (frame != UNBOUND_SLOT) {
+        builder.code.push_back({OpCode::EMIT_LOOP_VARIABLE, frame, 0, 0});
+    } else {
+        builder.code.push_back({OpCode::EMIT_VARIABLE, variable_index(std::string(name)), 0, 0});
+    }
+}
+
+void AdvancedTemplate::emit_function_call(std::string_view call, ProgramBuilder& builder) {
+    // call is "name(arg, 'literal', ...)"; split once here so execution only indexes
+    std::string_view text(call);
+    size_t open = text.find('(');
+    size_t close = text.rfind(')');
+    std::string_view name = trim(text.substr(0, open));
+    std::string_view arg_text;
+    if (open != std::string_view::npos) {
+        arg_text = text.substr(open + 1, close != std::string_view::npos && close > open ? close - open - 1 : std::string_view::npos);
     }
     
-    // Parse the content until {% endif %}
-    std::string content;
-    int depth = 1;
+    FunctionCall fc;
+    fc.slot = registry_ ? static_cast<uint32_t>(registry_->resolve_slot(std::string(name))) : UNBOUND_SLOT;
+    fc.first_arg = static_cast<uint32_t>(builder.args.size());
+    fc.arg_count = 0;
+    fc.name_offset = builder.add_text(name);
+    fc.name_length = static_cast<uint32_t>(name.size());
     
-    while (pos < text.length() && depth > 0) {
-        if (text.substr(pos, 2) == "{%") {
-            size_t tag_end = text.find("%}", pos + 2);
-            if (tag_end != std::string::npos) {
-                std::string tag = text.substr(pos + 2, tag_end - pos - 2);
-                
-                if (tag.substr(0, 2) == "if") {
-                    depth++;
-                } else if (tag == "endif") {
-                    depth--;
-                    if (depth == 0) {
-                        pos = tag_end + 2;
-                        break;
-                    }
-                }
+    auto add_argument = [&](std::string_view raw) {
+        std::string_view arg = trim(raw);
+        if (arg.size() >= 2 && (arg.front() == '"' || arg.front() == '\'') && arg.back() == arg.front()) {
+            arg = arg.substr(1, arg.size() - 2);
+        } else if (is_identifier(arg)) {
+            uint32_t frame = builder.loop_frame(arg);
+            if (frame != UNBOUND_SLOT) {
+                builder.args.push_back({CallArgument::Kind::LOOP_VARIABLE, frame, 0});
+            } else {
+                builder.args.push_back({CallArgument::Kind::VARIABLE, variable_index(std::string(arg)), 0});
             }
+            fc.arg_count++;
+            return;
         }
-        
-        if (depth > 0) {
-            content += text[pos];
-            pos++;
+        builder.args.push_back({CallArgument::Kind::LITERAL, builder.add_text(arg), static_cast<uint32_t>(arg.size())});
+        fc.arg_count++;
+    };
+    
+    if (!trim(arg_text).empty()) {
+        char quote = 0;
+        size_t start = 0;
+        for (size_t i = 0; i < arg_text.size(); ++i) {
+            char c = arg_text[i];
+            if (quote) {
+                if (c == quote) quote = 0;
+            } else if (c == '"' || c == '\'') {
+                quote = c;
+            } else if (c == ',') {
+                add_argument(arg_text.substr(start, i - start));
+                start = i + 1;
+            }
         }
+        add_argument(arg_text.substr(start));
     }
     
-    // Parse the content as child nodes
-    size_t content_pos = 0;
-    cond_node->children.push_back(parse(content, content_pos));
+    builder.code.push_back({OpCode::CALL_FUNCTION, static_cast<uint32_t>(builder.calls.size()), 0, 0});
+    builder.calls.push_back(fc);
+}
+
+void AdvancedTemplate::execute_function(const FunctionCall& call, const SlotContext& slots, const LoopFrame* frames,
+                                        std::string& output) const {
+    constexpr size_t INLINE_ARGS = 8;
+    std::string_view inline_args[INLINE_ARGS];
+    std::vector<std::string_view> overflow_args;
+    std::string_view* argv = inline_args;
+    if (call.arg_count > INLINE_ARGS) {
+        overflow_args.resize(call.arg_count);
+        argv = overflow_args.data();
+    }
+    
+    for (uint32_t i = 0; i < call.arg_count; ++i) {
+        const CallArgument& arg = args_[call.first_arg + i];
+        if (arg.kind == CallArgument::Kind::VARIABLE) {
+            auto value = slots.get(variable_ids_[arg.offset]);
+            argv[i] = value ? *value : std::string_view(required_variables_[arg.offset]);
+        } else if (arg.kind == CallArgument::Kind::LOOP_VARIABLE) {
+            argv[i] = frames[arg.offset].item;
+        } else {
+            argv[i] = std::string_view(text_ + arg.offset, arg.length);
+        }
+    }
+    
+    if (!registry_ || call.slot == UNBOUND_SLOT) {
+        output += "[UNKNOWN_FUNCTION:";
+        output.append(text_ + call.name_offset, call.name_length);
+        output += ']';
+        return;
+    }
+    
+    output += registry_->call_slot(call.slot, FunctionArgs(argv, call.arg_count), slots.context());
+}
+
+bool AdvancedTemplate::evaluate_condition(const ConditionOp* ops, size_t count, const SlotContext& slots,
+                                          const LoopFrame* frames) const {
+    // emit_condition bounds the stack depth, so evaluation never allocates
+    std::string_view stack[MAX_CONDITION_DEPTH];
+    size_t depth = 0;
+    
+    for (size_t i = 0; i < count; ++i) {
+        const ConditionOp& op = ops[i];
+        switch (op.kind) {
+            case ConditionOp::Kind::VARIABLE: {
+                stack[depth++] = slots.get(variable_ids_[op.a]).value_or(std::string_view());
+                break;
+            }
+            case ConditionOp::Kind::LOOP_VARIABLE:
+                stack[depth++] = frames[op.a].item;
+                break;
+            case ConditionOp::Kind::LITERAL:
+                stack[depth++] = std::string_view(text_ + op.a, op.b);
+                break;
+            case ConditionOp::Kind::NOT:
+                stack[depth - 1] = boolean_text(!is_truthy(stack[depth - 1]));
+                break;
+            default: {
+                std::string_view rhs = stack[--depth];
+                std::string_view lhs = stack[depth - 1];
+                bool result = false;
+                switch (op.kind) {
+                    case ConditionOp::Kind::EQUAL: result = compare_values(lhs, rhs) == 0; break;
+                    case ConditionOp::Kind::NOT_EQUAL: result = compare_values(lhs, rhs) != 0; break;
+                    case ConditionOp::Kind::LESS: result = compare_values(lhs, rhs) < 0; break;
+                    case ConditionOp::Kind::GREATER: result = compare_values(lhs, rhs) > 0; break;
+                    case ConditionOp::Kind::AND: result = is_truthy(lhs) && is_truthy(rhs); break;
+                    case ConditionOp::Kind::OR: result = is_truthy(lhs) || is_truthy(rhs); break;
+                    default: break;
+                }
+                stack[depth - 1] = boolean_text(result);
+                break;
+            }
+        }
+    }
     
-    return cond_node;
+    return depth == 1 && is_truthy(stack[0]);
 }
 
-std::string AdvancedTemplate::execute_node(const TemplateNode& node, const Context& context) const {
-    switch (node.type) {
-        case NodeType::LITERAL:
-            return node.content;
+void AdvancedTemplate::emit_condition(std::string_view condition, ProgramBuilder& builder) {
+    // Recursive descent over: or := and ("or" and)*, and := not ("and" not)*,
+    // not := "not" not | cmp, cmp := primary (("==" | "!=" | "<" | ">") primary)?,
+    // primary := identifier | number | 'string' | "string" | true | false | "(" or ")"
+    struct Compiler {
+        AdvancedTemplate& self;
+        ProgramBuilder& builder;
+        std::string_view text;
+        size_t pos = 0;
+        size_t depth = 0;
+        
+        std::string_view peek() {
+            while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) pos++;
+            if (pos >= text.size()) return {};
             
-        case NodeType::VARIABLE: {
-            auto it = context.find(node.content);
-            if (it != context.end()) {
-                return it->second;
+            char c = text[pos];
+            size_t end = pos + 1;
+            if (is_word_char(c) || (c == '-' && end < text.size() && std::isdigit(static_cast<unsigned char>(text[end])))) {
+                while (end < text.size() && (is_word_char(text[end]) || text[end] == '.')) end++;
+            } else if (c == '\'' || c == '"') {
+                end = text.find(c, pos + 1);
+                if (end == std::string_view::npos) fail("unterminated string");
+                end++;
+            } else if ((c == '=' || c == '!') && end < text.size() && text[end] == '=') {
+                end++;
             }
-            return "{" + node.content + "}"; // Keep original if not found
+            return text.substr(pos, end - pos);
+        }
+        
+        std::string_view take() {
+            std::string_view token = peek();
+            pos += token.size();
+            return token;
         }
         
-        case NodeType::CONDITIONAL:
-            return execute_conditional(node, context);
+        [[noreturn]] void fail(const char* reason) {
+            // text views the template source, so the error points into it
+            throw CompileError("Invalid condition '" + std::string(text) + "': " + reason,
+                               static_cast<size_t>(text.data() - self.source_.data()) + pos);
+        }
+        
+        void push(ConditionOp op) {
+            if (++depth > MAX_CONDITION_DEPTH) fail("too deeply nested");
+            builder.conditions.push_back(op);
+        }
+        
+        void apply(ConditionOp::Kind kind) {
+            depth--;
+            builder.conditions.push_back({kind, 0, 0});
+        }
+        
+        void parse_or() {
+            parse_and();
+            while (peek() == "or") {
+                take();
+                parse_and();
+                apply(ConditionOp::Kind::OR);
+            }
+        }
+        
+        void parse_and() {
+            parse_not();
+            while (peek() == "and") {
+                take();
+                parse_not();
+                apply(ConditionOp::Kind::AND);
+            }
+        }
+        
+        void parse_not() {
+            if (peek() == "not") {
+                take();
+                parse_not();
+                builder.conditions.push_back({ConditionOp::Kind::NOT, 0, 0});
+                return;
+            }
+            parse_comparison();
+        }
+        
+        void parse_comparison() {
+            parse_primary();
+            std::string_view op = peek();
+            ConditionOp::Kind kind;
+            if (op == "==") kind = ConditionOp::Kind::EQUAL;
+            else if (op == "!=") kind = ConditionOp::Kind::NOT_EQUAL;
+            else if (op == "<") kind = ConditionOp::Kind::LESS;
+            else if (op == ">") kind = ConditionOp::Kind::GREATER;
+            else return;
             
-        case NodeType::FUNCTION_CALL:
-            return execute_function(node, context);
+            take();
+            parse_primary();
+            apply(kind);
+        }
+        
+        void parse_primary() {
+            std::string_view token = take();
+            if (token.empty()) fail("unexpected end");
             
-        default: {
-            std::string result;
-            for (const auto& child : node.children) {
-                result += execute_node(*child, context);
+            if (token == "(") {
+                parse_or();
+                if (take() != ")") fail("missing ')'");
+            } else if (token.front() == '\'' || token.front() == '"') {
+                token = token.substr(1, token.size() - 2);
+                push({ConditionOp::Kind::LITERAL, builder.add_text(token), static_cast<uint32_t>(token.size())});
+            } else if (token == "true" || token == "false" ||
+                       std::isdigit(static_cast<unsigned char>(token.front())) || token.front() == '-') {
+                push({ConditionOp::Kind::LITERAL, builder.add_text(token), static_cast<uint32_t>(token.size())});
+            } else if (is_identifier(token)) {
+                uint32_t frame = builder.loop_frame(token);
+                if (frame != UNBOUND_SLOT) {
+                    push({ConditionOp::Kind::LOOP_VARIABLE, frame, 0});
+                } else {
+                    push({ConditionOp::Kind::VARIABLE, self.variable_index(std::string(token)), 0});
+                }
+            } else {
+                fail("unexpected token");
             }
-            return result;
         }
+    };
+    
+    Compiler compiler{*this, builder, trim(condition)};
+    compiler.parse_or();
+    if (!compiler.peek().empty()) {
+        compiler.fail("unexpected trailing input");
     }
 }
 
-std::string AdvancedTemplate::execute_conditional(const TemplateNode& node, const Context& context) const {
-    auto cond_it = node.attributes.find("condition");
-    if (cond_it == node.attributes.end()) {
-        return "";
+uint32_t AdvancedTemplate::variable_index(const std::string& name) {
+    auto it = std::find(required_variables_.begin(), required_variables_.end(), name);
+    if (it != required_variables_.end()) {
+        return static_cast<uint32_t>(it - required_variables_.begin());
     }
     
-    bool condition_result = evaluate_condition(cond_it->second, context);
-    
-    if (condition_result && !node.children.empty()) {
-        return execute_node(*node.children[0], context);
+    uint32_t id = symbols_->intern(name);
+    if (const SystemVariableProvider* provider = SystemVariables::find_provider(name)) {
+        system_variables_.push_back(provider);
+        system_variable_ids_.push_back(id);
     }
     
-    return "";
+    required_variables_.push_back(name);
+    variable_ids_.push_back(id);
+    return static_cast<uint32_t>(required_variables_.size() - 1);
 }
 
-bool AdvancedTemplate::evaluate_condition(const std::string& condition, const Context& context) const {
-    // Simple condition evaluation - can be enhanced
-    std::regex var_regex(R"(\b(\w+)\b)");
-    std::smatch match;
-    
-    if (std::regex_search(condition, match, var_regex)) {
-        std::string var_name = match[1].str();
-        auto it = context.find(var_name);
-        if (it != context.end()) {
-            const std::string& value = it->second;
-            return !value.empty() && value != "0" && value != "false";
+void AdvancedTemplate::update_cacheability() {
+    bool cacheable = is_compiled_;
+    for (const auto* provider : system_variables_) {
+        cacheable = cacheable && provider->deterministic;
+    }
+    for (size_t i = 0; i < code_size_ && cacheable; ++i) {
+        if (code_[i].op == OpCode::CALL_FUNCTION) {
+            cacheable = registry_ && registry_->is_pure(calls_[code_[i].a].slot);
+        } else if (code_[i].op == OpCode::LOOP_BEGIN) {
+            // Provider-backed lists read external data the cache key cannot see
+            uint32_t slot = loops_[code_[i].a].list_slot;
+            cacheable = !(registry_ && registry_->has_list_provider(slot));
         }
     }
-    
-    return false;
+    cacheable_.store(cacheable, std::memory_order_release);
 }
 
-void AdvancedTemplate::extract_variables(const TemplateNode& node) {
-    if (node.type == NodeType::VARIABLE) {
-        if (std::find(required_variables_.begin(), required_variables_.end(), node.content) == required_variables_.end()) {
-            required_variables_.push_back(node.content);
-        }
-    }
-    
-    for (const auto& child : node.children) {
-        extract_variables(*child);
+bool AdvancedTemplate::validate() const {
+    return is_compiled_;
+}
+
+std::vector<std::string> AdvancedTemplate::get_validation_errors() const {
+    if (compile_error_.empty()) {
+        return {};
     }
+    return {compile_error_};
 }
 
 const std::vector<std::string>& AdvancedTemplate::get_required_variables() const {
@@ -238,19 +1072,11 @@ const std::vector<std::string>& AdvancedTemplate::get_required_variables() const
 
 // SystemVariables Implementation
 std::string SystemVariables::get_current_date(const std::string& format) {
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    std::ostringstream oss;
-    oss << std::put_time(std::localtime(&time_t), format.c_str());
-    return oss.str();
+    return LocalClock::format_now(format);
 }
 
 std::string SystemVariables::get_current_time(const std::string& format) {
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    std::ostringstream oss;
-    oss << std::put_time(std::localtime(&time_t), format.c_str());
-    return oss.str();
+    return LocalClock::format_now(format);
 }
 
 std::string SystemVariables::get_username() {
@@ -271,28 +1097,55 @@ std::string SystemVariables::get_hostname() {
 }
 
 std::string SystemVariables::get_random_uuid() {
-    uuid_t uuid;
-    char uuid_str[37];
-    uuid_generate(uuid);
-    uuid_unparse_lower(uuid, uuid_str);
-    return std::string(uuid_str);
+    return ThreadRandom::uuid_v4();
 }
 
 std::string SystemVariables::get_random_number(int min, int max) {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(min, max);
-    return std::to_string(dis(gen));
+    return std::to_string(ThreadRandom::uniform(min, max));
+}
+
+std::string SystemVariables::get_current_datetime(const std::string& format) {
+    return get_current_date(format);
+}
+
+const std::vector<SystemVariableProvider>& SystemVariables::providers() {
+    static const std::vector<SystemVariableProvider> table = {
+        {"current_date", []() { return get_current_date(); }, false},
+        {"current_time", []() { return get_current_time(); }, false},
+        {"current_datetime", []() { return get_current_datetime(); }, false},
+        {"username", []() { return get_username(); }, true},
+        {"hostname", []() { return get_hostname(); }, true},
+        {"random_uuid", []() { return get_random_uuid(); }, false},
+        {"random_number", []() { return get_random_number(); }, false},
+    };
+    return table;
+}
+
+const SystemVariableProvider* SystemVariables::find_provider(std::string_view name) {
+    for (const auto& provider : providers()) {
+        if (name == provider.name) {
+            return &provider;
+        }
+    }
+    return nullptr;
+}
+
+std::string_view SystemVariables::memoized(const SystemVariableProvider& provider) {
+    // Indexed like providers(); non-deterministic entries stay empty
+    static const std::vector<std::string> values = [] {
+        std::vector<std::string> resolved;
+        for (const auto& entry : providers()) {
+            resolved.push_back(entry.deterministic ? entry.resolve() : std::string());
+        }
+        return resolved;
+    }();
+    return values[&provider - providers().data()];
 }
 
 void SystemVariables::populate_context(Context& context) {
-    context["current_date"] = get_current_date();
-    context["current_time"] = get_current_time();
-    context["current_datetime"] = get_current_date() + " " + get_current_time();
-    context["username"] = get_username();
-    context["hostname"] = get_hostname();
-    context["random_uuid"] = get_random_uuid();
-    context["random_number"] = get_random_number();
+    for (const auto& provider : providers()) {
+        context[provider.name] = provider.resolve();
+    }
 }
 
 // FunctionRegistry Implementation
@@ -301,141 +1154,726 @@ FunctionRegistry::FunctionRegistry() {
     LOG_DEBUG("FunctionRegistry initialized with built-in functions");
 }
 
-void FunctionRegistry::register_function(const std::string& name, TemplateFunction func) {
-    functions_[name] = func;
+void FunctionRegistry::register_function(const std::string& name, TemplateFunction func, bool pure) {
+    table_.update([&](FunctionTable& table) {
+        auto [it, inserted] = table.slot_index.emplace(name, table.slots.size());
+        if (inserted) {
+            table.slots.push_back({name, nullptr});
+        }
+        table.slots[it->second].function = std::move(func);
+        table.slots[it->second].pure = pure;
+        return true;
+    });
     LOG_DEBUG("Registered template function: {}", name);
 }
 
+size_t FunctionRegistry::resolve_slot(const std::string& name) {
+    {
+        auto table = table_.read();
+        auto it = table->slot_index.find(name);
+        if (it != table->slot_index.end()) {
+            return it->second;
+        }
+    }
+    
+    // Reserve an unbound slot; re-check under the writer lock in case of a race
+    size_t slot = 0;
+    table_.update([&](FunctionTable& table) {
+        auto [it, inserted] = table.slot_index.emplace(name, table.slots.size());
+        if (inserted) {
+            table.slots.push_back({name, nullptr});
+        }
+        slot = it->second;
+        return inserted;
+    });
+    return slot;
+}
+
 void FunctionRegistry::register_builtin_functions() {
     // Date/time functions
-    register_function("date", [](const std::vector<std::string>& args, const Context&) {
-        std::string format = args.empty() ? "%Y-%m-%d" : args[0];
+    register_function("date", [](const FunctionArgs& args, const Context&) {
+        std::string format = args.empty() ? "%Y-%m-%d" : std::string(args[0]);
         return SystemVariables::get_current_date(format);
     });
     
-    register_function("time", [](const std::vector<std::string>& args, const Context&) {
-        std::string format = args.empty() ? "%H:%M:%S" : args[0];
+    register_function("time", [](const FunctionArgs& args, const Context&) {
+        std::string format = args.empty() ? "%H:%M:%S" : std::string(args[0]);
         return SystemVariables::get_current_time(format);
     });
     
+    register_function("user", [](const FunctionArgs&, const Context&) {
+        return SystemVariables::get_username();
+    }, true);
+    
     // String functions
-    register_function("upper", [](const std::vector<std::string>& args, const Context&) {
+    register_function("upper", [](const FunctionArgs& args, const Context&) {
         if (args.empty()) return std::string("");
-        std::string result = args[0];
+        std::string result(args[0]);
         std::transform(result.begin(), result.end(), result.begin(), ::toupper);
         return result;
-    });
+    }, true);
     
-    register_function("lower", [](const std::vector<std::string>& args, const Context&) {
+    register_function("lower", [](const FunctionArgs& args, const Context&) {
         if (args.empty()) return std::string("");
-        std::string result = args[0];
+        std::string result(args[0]);
         std::transform(result.begin(), result.end(), result.begin(), ::tolower);
         return result;
-    });
+    }, true);
     
     // Random functions
-    register_function("random", [](const std::vector<std::string>& args, const Context&) {
+    register_function("random", [](const FunctionArgs& args, const Context&) {
         int min = 0, max = 100;
         if (args.size() >= 2) {
-            min = std::stoi(args[0]);
-            max = std::stoi(args[1]);
+            min = parse_int(args[0], min);
+            max = parse_int(args[1], max);
         }
         return SystemVariables::get_random_number(min, max);
     });
     
-    register_function("uuid", [](const std::vector<std::string>&, const Context&) {
+    register_function("uuid", [](const FunctionArgs&, const Context&) {
         return SystemVariables::get_random_uuid();
     });
 }
 
 bool FunctionRegistry::has_function(const std::string& name) const {
-    return functions_.find(name) != functions_.end();
+    auto table = table_.read();
+    auto it = table->slot_index.find(name);
+    return it != table->slot_index.end() && table->slots[it->second].function;
+}
+
+bool FunctionRegistry::is_pure(size_t slot) const {
+    auto table = table_.read();
+    return slot < table->slots.size() && table->slots[slot].function && table->slots[slot].pure;
+}
+
+std::string FunctionRegistry::call_slot(size_t slot, const FunctionArgs& args, const Context& context) const {
+    auto table = table_.read();
+    if (slot < table->slots.size() && table->slots[slot].function) {
+        return table->slots[slot].function(args, context);
+    }
+    return "[UNKNOWN_FUNCTION:" + (slot < table->slots.size() ? table->slots[slot].name : std::string()) + "]";
 }
 
 std::string FunctionRegistry::call_function(const std::string& name, 
                                            const std::vector<std::string>& args, 
                                            const Context& context) const {
-    auto it = functions_.find(name);
-    if (it != functions_.end()) {
-        return it->second(args, context);
+    size_t slot = 0;
+    {
+        auto table = table_.read();
+        auto it = table->slot_index.find(name);
+        if (it == table->slot_index.end()) {
+            return "[UNKNOWN_FUNCTION:" + name + "]";
+        }
+        slot = it->second;
     }
-    return "[UNKNOWN_FUNCTION:" + name + "]";
+    
+    std::vector<std::string_view> views(args.begin(), args.end());
+    return call_slot(slot, FunctionArgs(views.data(), views.size()), context);
+}
+
+void FunctionRegistry::register_list_provider(const std::string& name, ListProvider provider) {
+    table_.update([&](FunctionTable& table) {
+        auto [it, inserted] = table.list_index.emplace(name, table.list_slots.size());
+        if (inserted) {
+            table.list_slots.push_back({name, nullptr});
+        }
+        table.list_slots[it->second].provider = std::move(provider);
+        return true;
+    });
+    LOG_DEBUG("Registered list provider: {}", name);
+}
+
+size_t FunctionRegistry::resolve_list_slot(const std::string& name) {
+    {
+        auto table = table_.read();
+        auto it = table->list_index.find(name);
+        if (it != table->list_index.end()) {
+            return it->second;
+        }
+    }
+    
+    size_t slot = 0;
+    table_.update([&](FunctionTable& table) {
+        auto [it, inserted] = table.list_index.emplace(name, table.list_slots.size());
+        if (inserted) {
+            table.list_slots.push_back({name, nullptr});
+        }
+        slot = it->second;
+        return inserted;
+    });
+    return slot;
+}
+
+bool FunctionRegistry::has_list_provider(size_t slot) const {
+    auto table = table_.read();
+    return slot < table->list_slots.size() && table->list_slots[slot].provider;
+}
+
+std::unique_ptr<ListCursor> FunctionRegistry::open_list(size_t slot, const Context& context) const {
+    auto table = table_.read();
+    if (slot < table->list_slots.size() && table->list_slots[slot].provider) {
+        return table->list_slots[slot].provider(context);
+    }
+    return nullptr;
 }
 
 std::vector<std::string> FunctionRegistry::get_function_names() const {
+    auto table = table_.read();
     std::vector<std::string> names;
-    names.reserve(functions_.size());
-    for (const auto& pair : functions_) {
-        names.push_back(pair.first);
+    names.reserve(table->slots.size());
+    for (const auto& slot : table->slots) {
+        if (slot.function) {
+            names.push_back(slot.name);
+        }
     }
     return names;
 }
 
+// ExpansionCache Implementation
+ExpansionCache::ExpansionCache()
+    : hits_(performance_monitor().counter("expansion_cache_hits"))
+    , misses_(performance_monitor().counter("expansion_cache_misses")) {
+}
+
+void ExpansionCache::set_capacity(size_t capacity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_.store(capacity, std::memory_order_relaxed);
+    lru_.clear();
+    index_.clear();
+}
+
+bool ExpansionCache::lookup(const std::string& key, uint64_t epoch, std::string& result) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (epoch > epoch_) {
+        // Templates or variables changed since these entries were produced
+        lru_.clear();
+        index_.clear();
+        epoch_ = epoch;
+    }
+    
+    auto it = index_.find(key);
+    if (it == index_.end() || epoch != epoch_) {
+        misses_.increment();
+        return false;
+    }
+    
+    lru_.splice(lru_.begin(), lru_, it->second);
+    result = it->second->result;
+    hits_.increment();
+    return true;
+}
+
+void ExpansionCache::insert(const std::string& key, uint64_t epoch, const std::string& result) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (epoch != epoch_ || !enabled()) {
+        return; // Produced under a stale epoch
+    }
+    
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        it->second->result = result;
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return;
+    }
+    
+    lru_.push_front({key, result});
+    index_.emplace(key, lru_.begin());
+    while (lru_.size() > capacity_.load(std::memory_order_relaxed)) {
+        index_.erase(lru_.back().key);
+        lru_.pop_back();
+    }
+}
+
+void ExpansionCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    lru_.clear();
+    index_.clear();
+}
+
+size_t ExpansionCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lru_.size();
+}
+
 // AdvancedTemplateEngine Implementation
 AdvancedTemplateEngine::AdvancedTemplateEngine() 
-    : function_registry_(std::make_unique<FunctionRegistry>()) {
+    : function_registry_(std::make_unique<FunctionRegistry>())
+    , first_chunk_timer_(performance_monitor().timer("expansion_first_chunk"))
+    , stream_total_timer_(performance_monitor().timer("expansion_stream_total"))
+    , store_hits_(performance_monitor().counter("template_store_hits"))
+    , store_misses_(performance_monitor().counter("template_store_misses")) {
     LOG_INFO("AdvancedTemplateEngine initialized");
 }
 
 bool AdvancedTemplateEngine::add_advanced_template(const std::string& shortcut, const std::string& source) {
-    std::lock_guard<std::shared_mutex> lock(advanced_mutex_);
+    return add_advanced_templates({{shortcut, source}}) == 1;
+}
+
+size_t AdvancedTemplateEngine::add_advanced_templates(const std::vector<std::pair<std::string, std::string>>& sources,
+                                                      size_t threads) {
+    return publish_templates(compile_sources(sources, threads));
+}
+
+AdvancedTemplateEngine::CompiledList AdvancedTemplateEngine::compile_sources(
+    const std::vector<std::pair<std::string, std::string>>& sources, size_t threads) {
+    std::shared_ptr<const TemplateStore> store;
+    {
+        std::lock_guard<std::mutex> lock(advanced_mutex_);
+        store = template_store_;
+    }
     
-    auto advanced_template = std::make_unique<AdvancedTemplate>(source);
+    // Compile outside every engine lock; readers keep using the current snapshot meanwhile.
+    // Symbols and registry slots are interned through their own snapshot cells.
+    std::vector<std::shared_ptr<AdvancedTemplate>> results(sources.size());
+    auto compile_one = [&](size_t i) {
+        const auto& [shortcut, source] = sources[i];
+        auto advanced_template = std::make_shared<AdvancedTemplate>(source, function_registry_.get(), &symbols_);
+        if (!(store && load_stored(store, shortcut, source, *advanced_template))) {
+            advanced_template->compile();
+        }
+        results[i] = std::move(advanced_template);
+    };
+    
+    const auto start = std::chrono::steady_clock::now();
+    size_t workers = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+    workers = std::min(workers, (sources.size() + COMPILE_GRAIN - 1) / COMPILE_GRAIN);
+    if (workers <= 1) {
+        for (size_t i = 0; i < sources.size(); ++i) {
+            compile_one(i);
+        }
+    } else {
+        // Workers claim COMPILE_GRAIN sources at a time, so uneven templates balance out
+        std::atomic<size_t> next{0};
+        auto work = [&]() {
+            for (size_t begin; (begin = next.fetch_add(COMPILE_GRAIN, std::memory_order_relaxed)) < sources.size();) {
+                size_t end = std::min(begin + COMPILE_GRAIN, sources.size());
+                for (size_t i = begin; i < end; ++i) {
+                    compile_one(i);
+                }
+            }
+        };
+        std::vector<std::thread> pool;
+        pool.reserve(workers - 1);
+        for (size_t i = 1; i < workers; ++i) {
+            pool.emplace_back(work);
+        }
+        work();
+        for (auto& thread : pool) {
+            thread.join();
+        }
+    }
+    const auto batch_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
     
-    if (advanced_template->compile()) {
-        compiled_templates_[shortcut] = std::move(advanced_template);
+    CompiledList compiled;
+    compiled.reserve(sources.size());
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.last_batch_time = batch_time;
+    stats_.last_batch_threads = std::max<size_t>(workers, 1);
+    for (size_t i = 0; i < sources.size(); ++i) {
+        const std::string& shortcut = sources[i].first;
+        AdvancedTemplate& tmpl = *results[i];
+        stats_.total_templates++;
+        stats_.total_compile_time += tmpl.compile_time();
+        if (tmpl.compile_time() > stats_.max_compile_time) {
+            stats_.max_compile_time = tmpl.compile_time();
+            stats_.slowest_template = shortcut;
+        }
         
-        // Also add to base template engine for compatibility
-        Template basic_template(source);
-        TemplateEngine::AddTemplate(shortcut, basic_template);
+        if (tmpl.is_compiled()) {
+            stats_.compiled_templates++;
+            compiled.emplace_back(shortcut, std::move(results[i]));
+            continue;
+        }
         
-        LOG_INFO("Added advanced template: {}", shortcut);
-        return true;
-    } else {
+        stats_.failed_compilations++;
+        if (stats_.recent_failures.size() == MAX_RECORDED_FAILURES) {
+            stats_.recent_failures.erase(stats_.recent_failures.begin());
+        }
+        stats_.recent_failures.push_back({shortcut, tmpl.compile_error(), tmpl.error_offset()});
         LOG_ERROR("Failed to compile advanced template: {}", shortcut);
-        return false;
     }
+    return compiled;
+}
+
+bool AdvancedTemplateEngine::load_stored(const std::shared_ptr<const TemplateStore>& store, const std::string& shortcut,
+                                         const std::string& source, AdvancedTemplate& tmpl) const {
+    // Bytes, not the stored hash: a collision would otherwise run another template's image
+    auto index = store->find(shortcut);
+    if (index && store->source(*index) == source && tmpl.load_image(store->image(*index), store)) {
+        store_hits_.increment();
+        return true;
+    }
+    
+    store_misses_.increment();
+    return false;
+}
+
+size_t AdvancedTemplateEngine::publish_templates(const CompiledList& compiled) {
+    if (compiled.empty()) {
+        return 0;
+    }
+    
+    // The basic engine shares each template's source buffer rather than holding a copy
+    std::vector<std::pair<std::string, SourceBuffer>> basic_templates;
+    basic_templates.reserve(compiled.size());
+    for (const auto& [shortcut, advanced_template] : compiled) {
+        basic_templates.emplace_back(shortcut, advanced_template->get_source_buffer());
+    }
+    
+    std::lock_guard<std::mutex> lock(advanced_mutex_);
+    std::vector<std::shared_ptr<AdvancedTemplate>> previous(compiled.size());
+    compiled_templates_.update([&](AdvancedTemplateMap& templates) {
+        templates.reserve(templates.size() + compiled.size());
+        for (size_t i = 0; i < compiled.size(); ++i) {
+            const auto& [shortcut, advanced_template] = compiled[i];
+            // A function may have been registered since compile()
+            advanced_template->update_cacheability();
+            previous[i] = std::exchange(templates[shortcut], advanced_template);
+        }
+        return true;
+    });
+    
+    // Also add to base template engine for compatibility (bumps the generation)
+    std::vector<size_t> rejected;
+    size_t added = TemplateEngine::AddTemplateSources(std::move(basic_templates), &rejected);
+    if (!rejected.empty()) {
+        restore_rejected(compiled, previous, rejected);
+    }
+    
+    // One line per batch: a store load publishes thousands at once
+    if (compiled.size() == 1 && added == 1) {
+        LOG_INFO("Added advanced template: {}", compiled.front().first);
+    } else if (added > 0) {
+        LOG_INFO("Added {} advanced templates", added);
+    }
+    return added;
+}
+
+void AdvancedTemplateEngine::restore_rejected(const CompiledList& compiled,
+                                              const std::vector<std::shared_ptr<AdvancedTemplate>>& previous,
+                                              const std::vector<size_t>& rejected) {
+    // The basic engine kept its old definition of these shortcuts (an include cycle), so
+    // the advanced map goes back to whatever the batch would have left without them
+    std::vector<bool> accepted(compiled.size(), true);
+    std::unordered_set<std::string> names;
+    for (size_t i : rejected) {
+        accepted[i] = false;
+        names.insert(compiled[i].first);
+    }
+    std::unordered_map<std::string, std::shared_ptr<AdvancedTemplate>> restored;
+    for (size_t i = 0; i < compiled.size(); ++i) {
+        const auto& [shortcut, advanced_template] = compiled[i];
+        if (names.count(shortcut) == 0) continue;
+        auto it = restored.try_emplace(shortcut, previous[i]).first;
+        if (accepted[i]) it->second = advanced_template;
+    }
+    
+    compiled_templates_.update([&](AdvancedTemplateMap& templates) {
+        for (auto& [shortcut, advanced_template] : restored) {
+            if (advanced_template) {
+                templates[shortcut] = std::move(advanced_template);
+            } else {
+                templates.erase(shortcut);
+            }
+        }
+        return true;
+    });
+    
+    // Expansions of the rejected templates may have been cached meanwhile
+    BumpGeneration();
+}
+
+bool AdvancedTemplateEngine::RemoveTemplate(const std::string& shortcut) {
+    std::lock_guard<std::mutex> lock(advanced_mutex_);
+    bool removed_compiled = compiled_templates_.update([&](AdvancedTemplateMap& templates) {
+        return templates.erase(shortcut) > 0;
+    });
+    
+    // Bumps the generation after the snapshot is gone, so an expansion of the old
+    // template that is still running caches under a stale epoch
+    bool removed_basic = TemplateEngine::RemoveTemplate(shortcut);
+    if (removed_compiled && !removed_basic) {
+        BumpGeneration();
+    }
+    if (removed_compiled) {
+        LOG_INFO("Removed advanced template: {}", shortcut);
+    }
+    return removed_compiled || removed_basic;
+}
+
+bool AdvancedTemplateEngine::attach_template_store(const std::string& path) {
+    auto store = TemplateStore::open(path);
+    std::lock_guard<std::mutex> lock(advanced_mutex_);
+    template_store_ = store;
+    return store != nullptr;
+}
+
+size_t AdvancedTemplateEngine::load_template_store(const std::string& path) {
+    if (!attach_template_store(path)) {
+        return 0;
+    }
+    
+    std::shared_ptr<const TemplateStore> store;
+    {
+        std::lock_guard<std::mutex> lock(advanced_mutex_);
+        store = template_store_;
+    }
+    
+    CompiledList compiled;
+    compiled.reserve(store->size());
+    for (size_t i = 0; i < store->size(); ++i) {
+        std::string shortcut(store->shortcut(i));
+        // The source stays in the mapping, which the template keeps alive
+        auto advanced_template = std::make_shared<AdvancedTemplate>(SourceBuffer(store->source(i), store),
+                                                                    function_registry_.get(), &symbols_);
+        if (advanced_template->load_image(store->image(i), store)) {
+            store_hits_.increment();
+        } else {
+            // A malformed image still has its source, so fall back to compiling it
+            store_misses_.increment();
+            if (!advanced_template->compile()) {
+                LOG_ERROR("Failed to load stored template: {}", shortcut);
+                continue;
+            }
+        }
+        compiled.emplace_back(std::move(shortcut), std::move(advanced_template));
+    }
+    
+    return publish_templates(compiled);
+}
+
+bool AdvancedTemplateEngine::save_template_store(const std::string& path) const {
+    auto templates = compiled_templates_.read();
+    std::vector<std::pair<std::string, const AdvancedTemplate*>> entries;
+    entries.reserve(templates->size());
+    for (const auto& [shortcut, advanced_template] : *templates) {
+        entries.emplace_back(shortcut, advanced_template.get());
+    }
+    return TemplateStore::write(path, entries);
 }
 
 std::string AdvancedTemplateEngine::expand_advanced(const std::string& shortcut, const Context& context) const {
-    std::shared_lock<std::shared_mutex> lock(advanced_mutex_);
+    return expand_advanced(shortcut, ContextChain{&context});
+}
+
+std::string AdvancedTemplateEngine::expand_advanced(const std::string& shortcut, const ContextChain& chain) const {
+    // Read the epoch before the snapshot so a result computed from a template that is
+    // being replaced is tagged stale rather than cached under the new epoch
+    const bool use_cache = expansion_cache_.enabled();
+    const uint64_t epoch = use_cache ? cache_epoch() : 0;
+    auto templates = compiled_templates_.read();
     
-    auto it = compiled_templates_.find(shortcut);
-    if (it != compiled_templates_.end()) {
-        // Create enhanced context with system variables
-        Context enhanced_context = context;
-        SystemVariables::populate_context(enhanced_context);
-        
-        return it->second->execute(enhanced_context);
+    auto it = templates->find(shortcut);
+    if (it == templates->end()) {
+        // Fallback to basic template engine, still searching every caller layer
+        return TemplateEngine::ExpandWithLookup(shortcut, [&chain](const std::string& name) {
+            return chain.find(name);
+        });
+    }
+    
+    // Compatibility path: look up only the names the template reads, once each. Slots
+    // view the globals snapshot, so the guard outlives the expansion.
+    const AdvancedTemplate& tmpl = *it->second;
+    auto globals = ReadGlobalVariables();
+    SlotLease lease(symbols_.size(), tmpl.get_variable_ids());
+    bind_layers(tmpl, chain, *globals, lease.slots());
+    return expand_compiled(shortcut, tmpl, lease.slots(), use_cache, epoch);
+}
+
+void AdvancedTemplateEngine::bind_layers(const AdvancedTemplate& tmpl, const ContextChain& chain,
+                                         const Context& globals, SlotContext& slots) const {
+    ContextChain layers = chain.with_fallback(globals);
+    slots.set_context(&chain.front());
+    tmpl.bind_context(layers, slots);
+    tmpl.bind_system_variables(slots);
+}
+
+std::string AdvancedTemplateEngine::expand_advanced(const std::string& shortcut, const SlotContext& slots) const {
+    const bool use_cache = expansion_cache_.enabled();
+    const uint64_t epoch = use_cache ? cache_epoch() : 0;
+    auto templates = compiled_templates_.read();
+    
+    auto it = templates->find(shortcut);
+    if (it == templates->end()) {
+        return TemplateEngine::Expand(shortcut, slots.context());
+    }
+    
+    const AdvancedTemplate& tmpl = *it->second;
+    if (tmpl.get_system_variables().empty()) {
+        return expand_compiled(shortcut, tmpl, slots, use_cache, epoch);
     }
     
-    // Fallback to basic template engine
-    return TemplateEngine::Expand(shortcut, context);
+    // Unset system variables are resolved into a copy; the caller's slots stay untouched
+    SlotContext local = slots;
+    tmpl.bind_system_variables(local);
+    return expand_compiled(shortcut, tmpl, local, use_cache, epoch);
+}
+
+std::string AdvancedTemplateEngine::expand_compiled(const std::string& shortcut, const AdvancedTemplate& tmpl,
+                                                    const SlotContext& slots, bool use_cache, uint64_t epoch) const {
+    std::string key = use_cache ? cache_key(shortcut, tmpl, slots) : std::string();
+    if (!key.empty()) {
+        std::string cached;
+        if (expansion_cache_.lookup(key, epoch, cached)) {
+            return cached;
+        }
+    }
+    
+    std::string result;
+    tmpl.execute_into(result, slots);
+    
+    if (!key.empty()) {
+        expansion_cache_.insert(key, epoch, result);
+    }
+    return result;
+}
+
+std::string AdvancedTemplateEngine::cache_key(const std::string& shortcut, const AdvancedTemplate& tmpl,
+                                              const SlotContext& slots) const {
+    if (!tmpl.is_cacheable()) {
+        return std::string();
+    }
+    
+    // Key on the shortcut plus only the slot values the template reads
+    std::string key = shortcut;
+    for (uint32_t id : tmpl.get_variable_ids()) {
+        auto value = slots.get(id);
+        if (!value) {
+            key += '\0';
+        } else {
+            uint32_t length = static_cast<uint32_t>(value->size());
+            key += '\1';
+            key.append(reinterpret_cast<const char*>(&length), sizeof(length));
+            key += *value;
+        }
+    }
+    return key;
+}
+
+bool AdvancedTemplateEngine::expand_advanced_streaming(const std::string& shortcut, const Context& context,
+                                                       const ExpansionSink& sink, size_t chunk_size) const {
+    const bool use_cache = expansion_cache_.enabled();
+    const uint64_t epoch = use_cache ? cache_epoch() : 0;
+    auto templates = compiled_templates_.read();
+    
+    auto it = templates->find(shortcut);
+    if (it == templates->end()) {
+        return emit_chunks(TemplateEngine::Expand(shortcut, context), sink, chunk_size);
+    }
+    
+    const AdvancedTemplate& tmpl = *it->second;
+    auto globals = ReadGlobalVariables();
+    SlotLease lease(symbols_.size(), tmpl.get_variable_ids());
+    bind_layers(tmpl, ContextChain{&context}, *globals, lease.slots());
+    return stream_compiled(shortcut, tmpl, lease.slots(), sink, chunk_size, use_cache, epoch);
+}
+
+bool AdvancedTemplateEngine::expand_advanced_streaming(const std::string& shortcut, const SlotContext& slots,
+                                                       const ExpansionSink& sink, size_t chunk_size) const {
+    const bool use_cache = expansion_cache_.enabled();
+    const uint64_t epoch = use_cache ? cache_epoch() : 0;
+    auto templates = compiled_templates_.read();
+    
+    auto it = templates->find(shortcut);
+    if (it == templates->end()) {
+        return emit_chunks(TemplateEngine::Expand(shortcut, slots.context()), sink, chunk_size);
+    }
+    
+    const AdvancedTemplate& tmpl = *it->second;
+    if (tmpl.get_system_variables().empty()) {
+        return stream_compiled(shortcut, tmpl, slots, sink, chunk_size, use_cache, epoch);
+    }
+    SlotContext local = slots;
+    tmpl.bind_system_variables(local);
+    return stream_compiled(shortcut, tmpl, local, sink, chunk_size, use_cache, epoch);
+}
+
+bool AdvancedTemplateEngine::stream_compiled(const std::string& shortcut, const AdvancedTemplate& tmpl,
+                                             const SlotContext& slots, const ExpansionSink& sink, size_t chunk_size,
+                                             bool use_cache, uint64_t epoch) const {
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    bool first = true;
+    
+    std::string key = use_cache ? cache_key(shortcut, tmpl, slots) : std::string();
+    std::string collected;  // Full output, kept only when it will be cached
+    auto timed_sink = [&](std::string_view chunk) {
+        if (first) {
+            first = false;
+            first_chunk_timer_.record(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start));
+        }
+        if (!key.empty()) {
+            collected += chunk;
+        }
+        return sink(chunk);
+    };
+    
+    bool completed;
+    std::string cached;
+    if (!key.empty() && expansion_cache_.lookup(key, epoch, cached)) {
+        key.clear();
+        completed = emit_chunks(cached, timed_sink, chunk_size);
+    } else {
+        completed = tmpl.execute_streaming(slots, timed_sink, chunk_size);
+        if (completed && !key.empty()) {
+            expansion_cache_.insert(key, epoch, collected);
+        }
+    }
+    
+    stream_total_timer_.record(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start));
+    return completed;
+}
+
+void AdvancedTemplateEngine::enable_expansion_cache(size_t max_entries) {
+    expansion_cache_.set_capacity(std::max<size_t>(max_entries, 1));
+    LOG_INFO("Expansion cache enabled ({} entries)", expansion_cache_.capacity());
+}
+
+void AdvancedTemplateEngine::disable_expansion_cache() {
+    expansion_cache_.set_capacity(0);
+}
+
+size_t AdvancedTemplateEngine::expansion_cache_size() const {
+    return expansion_cache_.size();
 }
 
 bool AdvancedTemplateEngine::compile_template(const std::string& shortcut) {
-    // Simple implementation - templates are automatically compiled when added
-    std::shared_lock<std::shared_mutex> lock(advanced_mutex_);
-    return compiled_templates_.find(shortcut) != compiled_templates_.end();
+    std::string source;
+    {
+        auto templates = compiled_templates_.read();
+        auto it = templates->find(shortcut);
+        if (it == templates->end()) {
+            return false;
+        }
+        source = it->second->get_source();
+    }
+    return add_advanced_templates({{shortcut, source}}, 1) == 1;
 }
 
-bool AdvancedTemplateEngine::compile_all_templates() {
-    // All templates are automatically compiled when added
-    return true;
+bool AdvancedTemplateEngine::compile_all_templates(size_t threads) {
+    std::vector<std::pair<std::string, std::string>> sources;
+    {
+        auto templates = compiled_templates_.read();
+        sources.reserve(templates->size());
+        for (const auto& [shortcut, advanced_template] : *templates) {
+            sources.emplace_back(shortcut, advanced_template->get_source());
+        }
+    }
+    return add_advanced_templates(sources, threads) == sources.size();
 }
 
 std::vector<std::string> AdvancedTemplateEngine::get_required_variables(const std::string& shortcut) const {
-    std::shared_lock<std::shared_mutex> lock(advanced_mutex_);
-    auto it = compiled_templates_.find(shortcut);
-    if (it != compiled_templates_.end()) {
+    auto templates = compiled_templates_.read();
+    auto it = templates->find(shortcut);
+    if (it != templates->end()) {
         return it->second->get_required_variables();
     }
     return {};
 }
 
 bool AdvancedTemplateEngine::validate_template(const std::string& shortcut) const {
-    std::shared_lock<std::shared_mutex> lock(advanced_mutex_);
-    return compiled_templates_.find(shortcut) != compiled_templates_.end();
+    auto templates = compiled_templates_.read();
+    return templates->find(shortcut) != templates->end();
 }
 
 std::vector<std::string> AdvancedTemplateEngine::get_validation_errors(const std::string& shortcut) const {
@@ -446,10 +1884,32 @@ std::vector<std::string> AdvancedTemplateEngine::get_validation_errors(const std
     return {"Template not found: " + shortcut};
 }
 
-void AdvancedTemplateEngine::register_custom_function(const std::string& name, TemplateFunction func) {
+void AdvancedTemplateEngine::register_custom_function(const std::string& name, TemplateFunction func, bool pure) {
+    std::lock_guard<std::mutex> lock(advanced_mutex_);
     if (function_registry_) {
-        function_registry_->register_function(name, func);
+        function_registry_->register_function(name, std::move(func), pure);
+    }
+    
+    // Templates calling this slot may change output or purity
+    auto templates = compiled_templates_.read();
+    for (const auto& entry : *templates) {
+        entry.second->update_cacheability();
     }
+    functions_generation_.fetch_add(1, std::memory_order_release);
+}
+
+void AdvancedTemplateEngine::register_list_provider(const std::string& name, ListProvider provider) {
+    std::lock_guard<std::mutex> lock(advanced_mutex_);
+    if (function_registry_) {
+        function_registry_->register_list_provider(name, std::move(provider));
+    }
+    
+    // Loops over this list now read external data and must bypass the cache
+    auto templates = compiled_templates_.read();
+    for (const auto& entry : *templates) {
+        entry.second->update_cacheability();
+    }
+    functions_generation_.fetch_add(1, std::memory_order_release);
 }
 
 std::vector<std::string> AdvancedTemplateEngine::get_available_functions() const {
@@ -460,35 +1920,44 @@ std::vector<std::string> AdvancedTemplateEngine::get_available_functions() const
 }
 
 AdvancedTemplateEngine::CompilationStats AdvancedTemplateEngine::get_compilation_stats() const {
-    std::shared_lock<std::shared_mutex> lock(advanced_mutex_);
-    CompilationStats stats;
-    stats.total_templates = compiled_templates_.size();
-    stats.compiled_templates = compiled_templates_.size();
-    stats.failed_compilations = 0;
-    stats.total_compile_time = std::chrono::milliseconds(0);
-    stats.average_compile_time = std::chrono::milliseconds(0);
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    CompilationStats stats = stats_;
+    if (stats.total_templates > 0) {
+        stats.average_compile_time = stats.total_compile_time / static_cast<int64_t>(stats.total_templates);
+    }
     return stats;
 }
 
-// Missing function implementations
+std::chrono::microseconds AdvancedTemplateEngine::get_compile_time(const std::string& shortcut) const {
+    auto templates = compiled_templates_.read();
+    auto it = templates->find(shortcut);
+    return it != templates->end() ? it->second->compile_time() : std::chrono::microseconds(0);
+}
 
-std::shared_ptr<TemplateNode> AdvancedTemplate::parse_loop(const std::string& text, size_t& pos) {
-    // Simple loop parsing - for demonstration purposes
-    // In a full implementation, this would parse {for} ... {endfor} constructs
-    auto node = std::make_shared<TemplateNode>(NodeType::LITERAL, "[LOOP_PLACEHOLDER]");
-    return node;
+TemplateFootprint AdvancedTemplateEngine::get_template_footprint(const std::string& shortcut) const {
+    TemplateFootprint bytes = GetTemplateFootprint(shortcut);
+    auto templates = compiled_templates_.read();
+    auto it = templates->find(shortcut);
+    if (it != templates->end()) {
+        TemplateFootprint advanced = it->second->footprint();
+        if (GetTemplateSource(shortcut).shares(it->second->get_source_buffer())) {
+            advanced.source_bytes = 0;  // Already counted by the basic engine
+        }
+        bytes += advanced;
+    }
+    return bytes;
 }
 
-std::string AdvancedTemplate::execute_function(const TemplateNode& node, const Context& context) const {
-    // Simple function execution - for demonstration purposes
-    if (node.content == "date") {
-        return SystemVariables::get_current_date();
-    } else if (node.content == "time") {
-        return SystemVariables::get_current_time();
-    } else if (node.content == "user") {
-        return SystemVariables::get_username();
+TemplateFootprint AdvancedTemplateEngine::get_total_footprint() const {
+    TemplateFootprint total = GetTotalFootprint();
+    for (const auto& [shortcut, advanced_template] : *compiled_templates_.read()) {
+        TemplateFootprint advanced = advanced_template->footprint();
+        if (GetTemplateSource(shortcut).shares(advanced_template->get_source_buffer())) {
+            advanced.source_bytes = 0;
+        }
+        total += advanced;
     }
-    return "[UNKNOWN_FUNCTION]";
+    return total;
 }
 
 } // namespace crossexpand
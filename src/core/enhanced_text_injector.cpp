@@ -1,5 +1,6 @@
 #include "core/enhanced_text_injector.hpp"
 #include "utils/logger.hpp"
+#include "utils/performance_monitor.hpp"
 #include <X11/Xlib.h>
 #include <X11/extensions/XTest.h>
 #include <X11/keysym.h>
@@ -76,23 +77,7 @@ bool EnhancedTextInjector::inject_text_enhanced(const std::string& text, Injecti
     bool success = false;
     
     try {
-        switch (strategy) {
-            case InjectionStrategy::FAST_TYPING:
-                success = inject_fast_typing(text);
-                break;
-                
-            case InjectionStrategy::NATURAL_TYPING:
-                success = inject_natural_typing(text);
-                break;
-                
-            case InjectionStrategy::CLIPBOARD_PASTE:
-                success = inject_clipboard_paste(text);
-                break;
-                
-            default:
-                success = inject_fast_typing(text); // Fallback
-                break;
-        }
+        success = inject_with_strategy(text, strategy);
     } catch (const std::exception& e) {
         metrics.error_message = e.what();
         success = false;
@@ -112,9 +97,123 @@ bool EnhancedTextInjector::inject_text_enhanced(const std::string& text, Injecti
     return success;
 }
 
+bool EnhancedTextInjector::inject_stream(const ChunkProducer& produce, InjectionStrategy strategy) {
+    using Clock = std::chrono::steady_clock;
+    auto start_time = Clock::now();
+    
+    InjectionMetrics metrics{};
+    
+    // ADAPTIVE types chunks as they arrive and switches to one paste of the rest once the
+    // text outgrows ADAPTIVE_PASTE_THRESHOLD; paste never overwrites the clipboard per chunk
+    const bool adaptive = strategy == InjectionStrategy::ADAPTIVE;
+    if (adaptive) {
+        strategy = InjectionStrategy::FAST_TYPING;
+    }
+    metrics.strategy_used = strategy;
+    bool collect = strategy == InjectionStrategy::CLIPBOARD_PASTE;
+    bool first = true;
+    bool injected = true;
+    size_t total = 0;
+    std::string text;
+    auto inject = [&](const std::string& part) {
+        if (!inject_with_strategy(part, strategy)) {
+            return false;
+        }
+        metrics.characters_injected += part.size();
+        if (first) {
+            // Latency the user sees: the first character on screen, not the first chunk produced
+            first = false;
+            auto waited = Clock::now() - start_time;
+            metrics.preparation_time = std::chrono::duration_cast<std::chrono::milliseconds>(waited);
+            performance_monitor().timer("injection_first_char").record(
+                std::chrono::duration_cast<std::chrono::microseconds>(waited));
+        }
+        return true;
+    };
+    auto sink = [&](std::string_view chunk) {
+        total += chunk.size();
+        if (adaptive && !collect && total > ADAPTIVE_PASTE_THRESHOLD) {
+            strategy = InjectionStrategy::CLIPBOARD_PASTE;
+            metrics.strategy_used = strategy;
+            collect = true;
+            text.clear();
+        }
+        
+        if (collect) {
+            text.append(chunk.data(), chunk.size());
+            return true;
+        }
+        if (chunk.empty()) {
+            return true;
+        }
+        text.assign(chunk.data(), chunk.size());
+        injected = inject(text);
+        return injected;
+    };
+    
+    bool success = false;
+    try {
+        success = produce(sink) && injected;
+        if (success && collect && !text.empty()) {
+            success = inject(text);
+        }
+    } catch (const std::exception& e) {
+        metrics.error_message = e.what();
+        success = false;
+    }
+    
+    auto elapsed = Clock::now() - start_time;
+    performance_monitor().timer("injection_stream_total").record(
+        std::chrono::duration_cast<std::chrono::microseconds>(elapsed));
+    metrics.total_time = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed);
+    metrics.execution_time = metrics.total_time - metrics.preparation_time;
+    metrics.success = success;
+    
+    record_metrics(metrics);
+    
+    total_injections_.fetch_add(1);
+    if (success) {
+        successful_injections_.fetch_add(1);
+    }
+    
+    return success;
+}
+
+bool EnhancedTextInjector::set_strategy_injector(InjectionStrategy strategy, std::unique_ptr<TextInjector> injector) {
+    switch (strategy) {
+        case InjectionStrategy::FAST_TYPING:
+            fast_injector_ = std::move(injector);
+            return true;
+        case InjectionStrategy::NATURAL_TYPING:
+            natural_injector_ = std::move(injector);
+            return true;
+        case InjectionStrategy::CLIPBOARD_PASTE:
+            clipboard_injector_ = std::move(injector);
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool EnhancedTextInjector::inject_with_strategy(const std::string& text, InjectionStrategy strategy) {
+    switch (strategy) {
+        case InjectionStrategy::FAST_TYPING:
+            return inject_fast_typing(text);
+        
+        case InjectionStrategy::NATURAL_TYPING:
+            return inject_natural_typing(text);
+        
+        case InjectionStrategy::CLIPBOARD_PASTE:
+            return inject_clipboard_paste(text);
+        
+        default:
+            return inject_fast_typing(text); // Fallback
+    }
+}
+
 InjectionStrategy EnhancedTextInjector::choose_optimal_strategy(const std::string& text) const {
     // Simple heuristics for strategy selection
-    if (text.length() > 500) {
+    if (text.length() > ADAPTIVE_PASTE_THRESHOLD) {
         return InjectionStrategy::CLIPBOARD_PASTE;
     }
     
@@ -1,18 +1,222 @@
 #include "core/event_queue.hpp"
 #include "utils/logger.hpp"
 #include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <ctime>
+#include <thread>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 namespace crossexpand {
 
-EventQueue::EventQueue() 
-    : start_time_(std::chrono::steady_clock::now()) {
+namespace {
+
+// Polls before parking: a handoff that lands within this window costs no syscall
+constexpr int SPIN_POLLS = 64;
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex needs a plain 32-bit word");
+
+uint32_t* futex_word(std::atomic<uint32_t>& word) {
+    return reinterpret_cast<uint32_t*>(&word);
+}
+
+// Sleeps while word == expected, at most timeout; spurious returns are fine for callers
+void futex_wait(std::atomic<uint32_t>& word, uint32_t expected, std::chrono::nanoseconds timeout) {
+    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+    timespec relative{static_cast<time_t>(seconds.count()), static_cast<long>((timeout - seconds).count())};
+    syscall(SYS_futex, futex_word(word), FUTEX_WAIT_PRIVATE, expected, &relative, nullptr, 0);
+}
+
+void futex_wake(std::atomic<uint32_t>& word, int count) {
+    syscall(SYS_futex, futex_word(word), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+}
+
+int64_t stamp_of(std::chrono::steady_clock::time_point timestamp) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(timestamp.time_since_epoch()).count();
+}
+
+int64_t stamp_now() {
+    return stamp_of(std::chrono::steady_clock::now());
+}
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// Bounded producer wait under OverflowPolicy::BLOCK: spin, then yield, then nap
+void backoff(int attempt) {
+    if (attempt < 64) {
+        cpu_relax();
+    } else if (attempt < 128) {
+        std::this_thread::yield();
+    } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+}
+
+// Moves any drops not yet reported onto event; returns how many were taken
+uint32_t take_pending_drops(std::atomic<uint32_t>& pending, ProcessingEvent& event) {
+    if (pending.load(std::memory_order_relaxed) == 0) {
+        return 0;
+    }
+    const uint32_t taken = pending.exchange(0, std::memory_order_relaxed);
+    event.dropped_before += taken;
+    return taken;
+}
+
+} // namespace
+
+SchedulerConfig SchedulerConfig::strict() {
+    return SchedulerConfig();
+}
+
+SchedulerConfig SchedulerConfig::weighted() {
+    using std::chrono::milliseconds;
+    SchedulerConfig config;
+    config.weights = {1, 2, 4, 8};
+    config.max_wait = {milliseconds(250), milliseconds(100), milliseconds(50), milliseconds(10)};
+    return config;
+}
+
+uint64_t WaitHistogram::percentile_micros(double p) const {
+    if (total == 0) {
+        return 0;
+    }
+    const uint64_t rank = static_cast<uint64_t>(std::clamp(p, 0.0, 1.0) * (total - 1));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        seen += counts[i];
+        if (seen > rank) {
+            return i + 1 < BUCKETS ? (uint64_t{1} << i) : max_micros;
+        }
+    }
+    return max_micros;
+}
+
+template<typename RingPolicy>
+BasicEventQueue<RingPolicy>::BasicEventQueue(const SchedulerConfig& scheduler, const OverflowConfig& overflow)
+    : start_time_(std::chrono::steady_clock::now())
+    , overflow_config_(overflow) {
     for (auto& counter : drops_by_priority_) {
         counter.store(0);
     }
+    clear_wait_counters();
+    set_scheduler(scheduler);
     LOG_DEBUG("EventQueue initialized with {} priority levels", NUM_PRIORITIES);
 }
 
-bool EventQueue::push(const ProcessingEvent& event) {
+template<typename RingPolicy>
+void BasicEventQueue<RingPolicy>::clear_wait_counters() {
+    for (auto& level : wait_counters_) {
+        for (auto& count : level.counts) {
+            count.store(0);
+        }
+        level.slo_misses.store(0);
+        level.max_micros.store(0);
+    }
+}
+
+template<typename RingPolicy>
+void BasicEventQueue<RingPolicy>::set_scheduler(const SchedulerConfig& scheduler) {
+    scheduler_ = scheduler;
+    aging_ = false;
+    for (auto& weight : scheduler_.weights) {
+        weight = std::min(weight, SchedulerConfig::MAX_WEIGHT);
+    }
+    for (size_t level = 0; level < NUM_PRIORITIES; ++level) {
+        max_wait_ns_[level] = std::chrono::duration_cast<std::chrono::nanoseconds>(scheduler_.max_wait[level]).count();
+        aging_ |= max_wait_ns_[level] > 0;
+    }
+    
+    // Smooth weighted round robin: spreads each level's turns over the round instead of
+    // running them back to back, highest level first on ties
+    uint32_t total = 0;
+    for (uint32_t weight : scheduler_.weights) {
+        total += weight;
+    }
+    std::array<int64_t, NUM_PRIORITIES> current{};
+    schedule_length_ = total;
+    for (size_t turn = 0; turn < total; ++turn) {
+        size_t best = NUM_PRIORITIES - 1;
+        for (size_t level = NUM_PRIORITIES; level-- > 0;) {
+            current[level] += scheduler_.weights[level];
+            if (current[level] > current[best]) {
+                best = level;
+            }
+        }
+        current[best] -= total;
+        schedule_[turn] = static_cast<uint8_t>(best);
+    }
+}
+
+template<typename RingPolicy>
+size_t BasicEventQueue<RingPolicy>::next_level(int64_t now) {
+    // Turns are handed out with a plain load/store: two consumers occasionally sharing a
+    // turn only blurs the weights slightly, and spares every pop a locked instruction
+    const uint64_t turn = turn_.load(std::memory_order_relaxed);
+    turn_.store(turn + 1, std::memory_order_relaxed);
+    
+    if (aging_ && turn % AGING_CHECK_INTERVAL == 0) {
+        // An overdue CRITICAL event goes first; otherwise the most overdue level relative
+        // to its own limit does
+        size_t overdue = NUM_PRIORITIES;
+        double worst = 1.0;
+        for (size_t level = NUM_PRIORITIES; level-- > 0;) {
+            const int64_t limit = max_wait_ns_[level];
+            int64_t stamp;
+            bool waiting = limit > 0 && queues_[level].front_stamp(stamp);
+            if (limit > 0 && !waiting && overflow_[level].spilled.load(std::memory_order_relaxed) > 0) {
+                stamp = overflow_[level].front_stamp.load(std::memory_order_relaxed);
+                waiting = true;
+            }
+            if (waiting && now - stamp > limit) {
+                if (level == NUM_PRIORITIES - 1) {
+                    return level;
+                }
+                const double ratio = static_cast<double>(now - stamp) / limit;
+                if (ratio > worst) {
+                    worst = ratio;
+                    overdue = level;
+                }
+            }
+        }
+        if (overdue < NUM_PRIORITIES) {
+            return overdue;
+        }
+    }
+    if (schedule_length_ == 0) {
+        return NUM_PRIORITIES - 1;
+    }
+    return schedule_[turn % schedule_length_];
+}
+
+template<typename RingPolicy>
+void BasicEventQueue<RingPolicy>::record_wait(size_t level, const ProcessingEvent& event, int64_t now) {
+    const int64_t waited = std::max<int64_t>(now - stamp_of(event.timestamp), 0);
+    const uint64_t micros = static_cast<uint64_t>(waited / 1000);
+    const bool missed = max_wait_ns_[level] > 0 && waited > max_wait_ns_[level];
+    const size_t bucket = micros == 0 ? 0 : std::min<size_t>(64 - __builtin_clzll(micros), WaitHistogram::BUCKETS - 1);
+    
+    WaitCounters& counters = wait_counters_[level];
+    counters.counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    if (missed) {
+        counters.slo_misses.fetch_add(1, std::memory_order_relaxed);
+    }
+    uint64_t seen_max = counters.max_micros.load(std::memory_order_relaxed);
+    while (micros > seen_max &&
+           !counters.max_micros.compare_exchange_weak(seen_max, micros, std::memory_order_relaxed)) {
+        // Retry
+    }
+}
+
+template<typename RingPolicy>
+bool BasicEventQueue<RingPolicy>::push(const ProcessingEvent& event) {
     const size_t priority_index = static_cast<size_t>(event.priority);
     
     if (priority_index >= NUM_PRIORITIES) {
@@ -23,26 +227,262 @@ bool EventQueue::push(const ProcessingEvent& event) {
     ProcessingEvent event_copy = event;
     event_copy.sequence_id = sequence_counter_.fetch_add(1, std::memory_order_relaxed);
     
-    if (queues_[priority_index].try_push(event_copy)) {
-        total_pushed_.fetch_add(1, std::memory_order_relaxed);
-        return true;
+    // Fast path: nothing spilled ahead of us and no drop to report
+    const Overflow& overflow = overflow_[priority_index];
+    size_t coalesced = 0;
+    size_t accepted = 0;
+    if (overflow.spilled.load(std::memory_order_acquire) == 0 &&
+        overflow.pending_drops.load(std::memory_order_relaxed) == 0 &&
+        queues_[priority_index].try_push(event_copy, stamp_of(event_copy.timestamp))) {
+        accepted = 1;
     } else {
-        // Queue full, increment drop counter
-        drops_by_priority_[priority_index].fetch_add(1, std::memory_order_relaxed);
-        LOG_WARNING("Event queue full for priority {}, dropping event", priority_index);
+        accepted = overflow_events(priority_index, &event_copy, 1, event_copy.sequence_id, coalesced);
+    }
+    
+    if (accepted == 0) {
+        record_drops(priority_index, 1);
         return false;
     }
+    if (coalesced == 0) {
+        signal_pushed(1);
+    }
+    update_congestion(priority_index, true);
+    return true;
 }
 
-bool EventQueue::push(const SimpleKeyEvent& key_event, EventPriority priority) {
+template<typename RingPolicy>
+bool BasicEventQueue<RingPolicy>::push(const SimpleKeyEvent& key_event, EventPriority priority) {
     ProcessingEvent event(key_event, priority);
     return push(event);
 }
 
-bool EventQueue::pop(ProcessingEvent& event) {
-    // Check queues from highest to lowest priority
-    for (int priority = NUM_PRIORITIES - 1; priority >= 0; --priority) {
-        if (queues_[priority].try_pop(event)) {
+template<typename RingPolicy>
+size_t BasicEventQueue<RingPolicy>::overflow_events(size_t level, const ProcessingEvent* events, size_t count,
+                                                     uint64_t first_id, size_t& coalesced) {
+    const OverflowConfig& config = overflow_config_;
+    Ring& ring = queues_[level];
+    Overflow& overflow = overflow_[level];
+    size_t accepted = 0;
+    
+    if (config.policy == OverflowPolicy::DROP || config.policy == OverflowPolicy::BLOCK) {
+        const auto deadline = std::chrono::steady_clock::now() +
+            (config.policy == OverflowPolicy::BLOCK ? config.block_timeout : std::chrono::microseconds::zero());
+        int attempt = 0;
+        while (accepted < count) {
+            ProcessingEvent event = events[accepted];
+            event.sequence_id = first_id + accepted;
+            const uint32_t marked = take_pending_drops(overflow.pending_drops, event);
+            if (ring.try_push(event, stamp_of(event.timestamp))) {
+                accepted++;
+                attempt = 0;
+                continue;
+            }
+            overflow.pending_drops.fetch_add(marked, std::memory_order_relaxed);  // For the next one
+            if (config.policy == OverflowPolicy::DROP || std::chrono::steady_clock::now() >= deadline) {
+                break;
+            }
+            if (attempt == 0) {
+                blocked_.fetch_add(1, std::memory_order_relaxed);
+            }
+            backoff(attempt++);
+        }
+        return accepted;
+    }
+    
+    // SPILL and COALESCE: the ring first while nothing is spilled, then the spill
+    std::lock_guard<std::mutex> lock(overflow.mutex);
+    const bool coalesce = config.policy == OverflowPolicy::COALESCE;
+    for (; accepted < count; ++accepted) {
+        const SimpleKeyEvent& key = events[accepted].key_event;
+        if (coalesce && !key.is_pressed) {
+            // Workers act on presses only, so a press still waiting in the spill can stand
+            // for its release too. Releases of presses already queued or consumed are kept.
+            auto open = overflow.open_presses.find(key.keycode);
+            if (open != overflow.open_presses.end()) {
+                if (--open->second == 0) {
+                    overflow.open_presses.erase(open);
+                }
+                coalesced++;
+                continue;
+            }
+        }
+        ProcessingEvent event = events[accepted];
+        event.sequence_id = first_id + accepted;
+        const uint32_t marked = take_pending_drops(overflow.pending_drops, event);
+        if (overflow.spill.empty() && ring.try_push(event, stamp_of(event.timestamp))) {
+            continue;
+        }
+        if (overflow.spill.size() >= config.spill_limit) {
+            overflow.pending_drops.fetch_add(marked, std::memory_order_relaxed);
+            break;
+        }
+        overflow.spill.push_back(event);
+        total_spilled_.fetch_add(1, std::memory_order_relaxed);
+        if (coalesce && key.is_pressed) {
+            overflow.open_presses[key.keycode]++;
+        }
+    }
+    if (!overflow.spill.empty()) {
+        overflow.front_stamp.store(stamp_of(overflow.spill.front().timestamp), std::memory_order_relaxed);
+    }
+    overflow.spilled.store(overflow.spill.size(), std::memory_order_release);
+    if (coalesced > 0) {
+        coalesced_.fetch_add(coalesced, std::memory_order_relaxed);
+    }
+    return accepted;
+}
+
+template<typename RingPolicy>
+size_t BasicEventQueue<RingPolicy>::take_spilled(size_t level, ProcessingEvent* out, size_t max) {
+    Overflow& overflow = overflow_[level];
+    if (max == 0 || overflow.spilled.load(std::memory_order_acquire) == 0) {
+        return 0;
+    }
+    
+    std::lock_guard<std::mutex> lock(overflow.mutex);
+    const size_t n = std::min(max, overflow.spill.size());
+    if (!overflow.open_presses.empty()) {
+        // Presses leaving the spill can no longer absorb a release
+        for (size_t i = 0; i < n; ++i) {
+            const SimpleKeyEvent& key = overflow.spill[i].key_event;
+            auto open = key.is_pressed ? overflow.open_presses.find(key.keycode) : overflow.open_presses.end();
+            if (open != overflow.open_presses.end() && --open->second == 0) {
+                overflow.open_presses.erase(open);
+            }
+        }
+    }
+    std::move(overflow.spill.begin(), overflow.spill.begin() + n, out);
+    overflow.spill.erase(overflow.spill.begin(), overflow.spill.begin() + n);
+    if (!overflow.spill.empty()) {
+        overflow.front_stamp.store(stamp_of(overflow.spill.front().timestamp), std::memory_order_relaxed);
+    }
+    overflow.spilled.store(overflow.spill.size(), std::memory_order_release);
+    return n;
+}
+
+template<typename RingPolicy>
+size_t BasicEventQueue<RingPolicy>::take(size_t level, ProcessingEvent* out, size_t max) {
+    // The ring holds a level's oldest events; the spill only fills once it is full
+    size_t taken = max == 1 ? static_cast<size_t>(queues_[level].try_pop(*out))
+                            : queues_[level].try_pop_bulk(out, max);
+    taken += take_spilled(level, out + taken, max - taken);
+    if (taken > 0) {
+        update_congestion(level, false);
+    }
+    return taken;
+}
+
+template<typename RingPolicy>
+void BasicEventQueue<RingPolicy>::record_drops(size_t level, size_t count) {
+    Overflow& overflow = overflow_[level];
+    drops_by_priority_[level].fetch_add(count, std::memory_order_relaxed);
+    overflow.pending_drops.fetch_add(static_cast<uint32_t>(count), std::memory_order_relaxed);
+    overflow.unreported_drops.fetch_add(count);
+    drops_unreported_.store(true);
+    report_drops(false);
+}
+
+template<typename RingPolicy>
+void BasicEventQueue<RingPolicy>::report_drops(bool force) {
+    // One report per interval, by whichever thread gets there first; a drop counted
+    // after the flag is cleared sets it again and waits for the next report
+    const int64_t now = stamp_now();
+    const int64_t interval = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        overflow_config_.drop_report_interval).count();
+    int64_t last = last_drop_report_.load(std::memory_order_relaxed);
+    if (force) {
+        last_drop_report_.store(now, std::memory_order_relaxed);
+    } else if (now - last < interval ||
+               !last_drop_report_.compare_exchange_strong(last, now, std::memory_order_relaxed)) {
+        return;
+    }
+    drops_unreported_.store(false);
+    
+    std::array<uint64_t, NUM_PRIORITIES> dropped;
+    uint64_t total = 0;
+    for (size_t i = 0; i < NUM_PRIORITIES; ++i) {
+        dropped[i] = overflow_[i].unreported_drops.exchange(0);
+        total += dropped[i];
+    }
+    if (total == 0) {
+        return;
+    }
+    LOG_WARNING("Event queue overflow: dropped {} events (low {}, normal {}, high {}, critical {})",
+                total, dropped[0], dropped[1], dropped[2], dropped[3]);
+    if (overflow_config_.on_drops) {
+        overflow_config_.on_drops(dropped);
+    }
+}
+
+template<typename RingPolicy>
+void BasicEventQueue<RingPolicy>::signal_pushed(size_t queued) {
+    total_pushed_.fetch_add(queued, std::memory_order_relaxed);
+    if (drops_unreported_.load(std::memory_order_relaxed)) {
+        report_drops(false);
+    }
+    // Pairs with the fence in wait_pop: either we see the waiter or it sees the event
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const uint32_t waiting = waiters_.load(std::memory_order_relaxed);
+    if (waiting > 0) {
+        wakeups_.fetch_add(1, std::memory_order_relaxed);
+        wake_waiters(static_cast<int>(std::min<size_t>(waiting, queued)));
+    }
+}
+
+template<typename RingPolicy>
+void BasicEventQueue<RingPolicy>::update_congestion(size_t level, bool pushing) {
+    const OverflowConfig& config = overflow_config_;
+    if (!config.on_watermark) {
+        return;
+    }
+    
+    // Pushes can only raise the flag and pops only clear it
+    Overflow& overflow = overflow_[level];
+    bool congested = overflow.congested.load(std::memory_order_relaxed);
+    if (pushing == congested) {
+        return;
+    }
+    const double fill = static_cast<double>(depth(level)) / queues_[level].capacity();
+    if (pushing ? fill < config.high_watermark : fill > config.low_watermark) {
+        return;
+    }
+    if (overflow.congested.compare_exchange_strong(congested, pushing, std::memory_order_relaxed)) {
+        config.on_watermark(static_cast<EventPriority>(level), pushing);
+    }
+}
+
+template<typename RingPolicy>
+size_t BasicEventQueue<RingPolicy>::depth(size_t level) const {
+    return queues_[level].size() + overflow_[level].spilled.load(std::memory_order_relaxed);
+}
+
+template<typename RingPolicy>
+size_t BasicEventQueue<RingPolicy>::credits(EventPriority priority) const {
+    const size_t level = static_cast<size_t>(priority);
+    if (level >= NUM_PRIORITIES || overflow_[level].spilled.load(std::memory_order_relaxed) > 0) {
+        return 0;
+    }
+    const size_t used = queues_[level].size();
+    return used < queues_[level].capacity() ? queues_[level].capacity() - used : 0;
+}
+
+template<typename RingPolicy>
+bool BasicEventQueue<RingPolicy>::pop(ProcessingEvent& event) {
+    if (drops_unreported_.load(std::memory_order_relaxed)) {
+        report_drops(false);
+    }
+    const int64_t now = stamp_now();
+    const size_t chosen = next_level(now);
+    if (take(chosen, &event, 1)) {
+        record_wait(chosen, event, now);
+        total_popped_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    
+    // Chosen level empty: its turn goes to the highest non-empty one
+    for (size_t level = NUM_PRIORITIES; level-- > 0;) {
+        if (level != chosen && take(level, &event, 1)) {
+            record_wait(level, event, now);
             total_popped_.fetch_add(1, std::memory_order_relaxed);
             return true;
         }
@@ -50,7 +490,149 @@ bool EventQueue::pop(ProcessingEvent& event) {
     return false; // All queues empty
 }
 
-EventQueue::Stats EventQueue::get_stats() const {
+template<typename RingPolicy>
+size_t BasicEventQueue<RingPolicy>::push_batch(const ProcessingEvent* events, size_t count) {
+    if (count == 0) {
+        return 0;
+    }
+    
+    // Ids for the whole batch in one step; dropped events leave gaps, as with push()
+    const uint64_t first_id = sequence_counter_.fetch_add(count, std::memory_order_relaxed);
+    size_t accepted = 0;
+    size_t queued = 0;
+    
+    while (accepted < count) {
+        const size_t priority_index = static_cast<size_t>(events[accepted].priority);
+        if (priority_index >= NUM_PRIORITIES) {
+            LOG_ERROR("Invalid priority level: {}", priority_index);
+            break;
+        }
+        size_t run = 1;
+        while (accepted + run < count && events[accepted + run].priority == events[accepted].priority) {
+            run++;
+        }
+        
+        const size_t start = accepted;
+        const Overflow& overflow = overflow_[priority_index];
+        size_t done = 0;
+        if (overflow.spilled.load(std::memory_order_acquire) == 0 &&
+            overflow.pending_drops.load(std::memory_order_relaxed) == 0) {
+            done = queues_[priority_index].try_push_bulk(run, [&](ProcessingEvent& slot, size_t i) {
+                slot = events[start + i];
+                slot.sequence_id = first_id + start + i;
+                return stamp_of(slot.timestamp);
+            });
+        }
+        size_t coalesced = 0;
+        if (done < run) {
+            done += overflow_events(priority_index, events + start + done, run - done, first_id + start + done,
+                                    coalesced);
+        }
+        accepted += done;
+        queued += done - coalesced;
+        update_congestion(priority_index, true);
+        if (done < run) {
+            break; // Stop at the first loss so what was accepted stays a prefix
+        }
+    }
+    
+    for (size_t i = accepted; i < count;) {
+        size_t run = 1;
+        while (i + run < count && events[i + run].priority == events[i].priority) {
+            run++;
+        }
+        const size_t priority_index = static_cast<size_t>(events[i].priority);
+        if (priority_index < NUM_PRIORITIES) {
+            record_drops(priority_index, run);
+        }
+        i += run;
+    }
+    if (queued > 0) {
+        signal_pushed(queued);
+    }
+    return accepted;
+}
+
+template<typename RingPolicy>
+size_t BasicEventQueue<RingPolicy>::pop_batch(ProcessingEvent* out, size_t max) {
+    if (max == 0) {
+        return 0;
+    }
+    if (drops_unreported_.load(std::memory_order_relaxed)) {
+        report_drops(false);
+    }
+    
+    const int64_t now = stamp_now();
+    const size_t chosen = next_level(now);
+    size_t popped = take(chosen, out, max);
+    for (size_t i = 0; i < popped; ++i) {
+        record_wait(chosen, out[i], now);
+    }
+    for (size_t level = NUM_PRIORITIES; level-- > 0 && popped < max;) {
+        if (level == chosen) {
+            continue;
+        }
+        const size_t taken = take(level, out + popped, max - popped);
+        for (size_t i = popped; i < popped + taken; ++i) {
+            record_wait(level, out[i], now);
+        }
+        popped += taken;
+    }
+    if (popped > 0) {
+        total_popped_.fetch_add(popped, std::memory_order_relaxed);
+    }
+    return popped;
+}
+
+template<typename RingPolicy>
+bool BasicEventQueue<RingPolicy>::wait_pop(ProcessingEvent& event, std::chrono::nanoseconds timeout) {
+    for (int i = 0; i < SPIN_POLLS; ++i) {
+        if (pop(event)) {
+            return true;
+        }
+        cpu_relax();
+    }
+    
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (;;) {
+        // Announce the waiter, then look once more; a push racing with this either
+        // lands before the re-check or sees waiters_ and bumps the epoch we sleep on
+        const uint32_t epoch = wake_epoch_.load(std::memory_order_acquire);
+        waiters_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        
+        if (pop(event)) {
+            waiters_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+        const auto remaining = deadline - std::chrono::steady_clock::now();
+        if (shutdown_.load(std::memory_order_acquire) || remaining <= std::chrono::nanoseconds::zero()) {
+            waiters_.fetch_sub(1, std::memory_order_relaxed);
+            return false;
+        }
+        
+        parks_.fetch_add(1, std::memory_order_relaxed);
+        futex_wait(wake_epoch_, epoch, std::chrono::duration_cast<std::chrono::nanoseconds>(remaining));
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+template<typename RingPolicy>
+void BasicEventQueue<RingPolicy>::shutdown() {
+    shutdown_.store(true, std::memory_order_release);
+    wake_waiters(INT_MAX);
+    report_drops(true);
+    LOG_DEBUG("EventQueue shut down");
+}
+
+template<typename RingPolicy>
+void BasicEventQueue<RingPolicy>::wake_waiters(int count) {
+    wake_epoch_.fetch_add(1, std::memory_order_release);
+    futex_wake(wake_epoch_, count);
+}
+
+template<typename RingPolicy>
+typename BasicEventQueue<RingPolicy>::Stats BasicEventQueue<RingPolicy>::get_stats() const {
     Stats stats;
     stats.total_pushed = total_pushed_.load(std::memory_order_relaxed);
     stats.total_popped = total_popped_.load(std::memory_order_relaxed);
@@ -61,6 +643,24 @@ EventQueue::Stats EventQueue::get_stats() const {
         stats.total_dropped += stats.drops_by_priority[i];
         stats.current_sizes[i] = queues_[i].size();
     }
+    for (size_t i = 0; i < NUM_PRIORITIES; ++i) {
+        stats.spilled[i] = overflow_[i].spilled.load(std::memory_order_relaxed);
+    }
+    stats.total_spilled = total_spilled_.load(std::memory_order_relaxed);
+    stats.coalesced = coalesced_.load(std::memory_order_relaxed);
+    stats.blocked = blocked_.load(std::memory_order_relaxed);
+    stats.parks = parks_.load(std::memory_order_relaxed);
+    stats.wakeups = wakeups_.load(std::memory_order_relaxed);
+    for (size_t level = 0; level < NUM_PRIORITIES; ++level) {
+        const WaitCounters& counters = wait_counters_[level];
+        WaitHistogram& histogram = stats.wait_times[level];
+        for (size_t i = 0; i < WaitHistogram::BUCKETS; ++i) {
+            histogram.counts[i] = counters.counts[i].load(std::memory_order_relaxed);
+            histogram.total += histogram.counts[i];
+        }
+        histogram.slo_misses = counters.slo_misses.load(std::memory_order_relaxed);
+        histogram.max_micros = counters.max_micros.load(std::memory_order_relaxed);
+    }
     
     auto now = std::chrono::steady_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(now - start_time_);
@@ -75,25 +675,34 @@ EventQueue::Stats EventQueue::get_stats() const {
     return stats;
 }
 
-void EventQueue::reset_stats() {
+template<typename RingPolicy>
+void BasicEventQueue<RingPolicy>::reset_stats() {
     total_pushed_.store(0);
     total_popped_.store(0);
     for (auto& counter : drops_by_priority_) {
         counter.store(0);
     }
+    parks_.store(0);
+    wakeups_.store(0);
+    total_spilled_.store(0);
+    coalesced_.store(0);
+    blocked_.store(0);
+    clear_wait_counters();
     start_time_ = std::chrono::steady_clock::now();
     LOG_INFO("EventQueue statistics reset");
 }
 
-size_t EventQueue::total_size() const {
+template<typename RingPolicy>
+size_t BasicEventQueue<RingPolicy>::total_size() const {
     size_t total = 0;
-    for (const auto& queue : queues_) {
-        total += queue.size();
+    for (size_t level = 0; level < NUM_PRIORITIES; ++level) {
+        total += depth(level);  // Spilled events included
     }
     return total;
 }
 
-bool EventQueue::is_healthy() const {
+template<typename RingPolicy>
+bool BasicEventQueue<RingPolicy>::is_healthy() const {
     // Queue is healthy if:
     // 1. No queue is completely full
     // 2. Drop rate is low
@@ -116,7 +725,8 @@ bool EventQueue::is_healthy() const {
     return true;
 }
 
-double EventQueue::utilization() const {
+template<typename RingPolicy>
+double BasicEventQueue<RingPolicy>::utilization() const {
     size_t total_capacity = 0;
     size_t total_used = 0;
     
@@ -129,4 +739,7 @@ double EventQueue::utilization() const {
     return static_cast<double>(total_used) / total_capacity;
 }
 
+template class BasicEventQueue<SpscRing>;
+template class BasicEventQueue<MpmcRing>;
+
 } // namespace crossexpand
@@ -0,0 +1,95 @@
+#include "core/keystroke_expander.hpp"
+#include "utils/logger.hpp"
+
+namespace crossexpand {
+
+KeystrokeExpander::KeystrokeExpander(std::shared_ptr<AdvancedTemplateEngine> engine, InjectionSink inject,
+                                     std::shared_ptr<TriggerMatcher> matcher)
+    : template_engine_(std::move(engine))
+    , inject_(std::move(inject))
+    , trigger_matcher_(std::move(matcher)) {
+    
+    if (!trigger_matcher_) {
+        std::weak_ptr<AdvancedTemplateEngine> weak_engine = template_engine_;
+        trigger_matcher_ = std::make_shared<TriggerMatcher>([weak_engine]() {
+            auto engine = weak_engine.lock();
+            return engine ? engine->GetShortcuts() : std::vector<std::string>{};
+        });
+    }
+    
+    trigger_generation_ = template_engine_->GetGeneration();
+    trigger_matcher_->rebuild_now(trigger_generation_);
+}
+
+bool KeystrokeExpander::process_event(const ProcessingEvent& event) {
+    if (event.dropped_before > 0) {
+        // Keystrokes were lost just before this one, so the typed sequence is broken
+        trigger_cursor_.reset();
+    }
+    if (!event.key_event.is_pressed) {
+        return false;
+    }
+    
+    // Template set changed: rebuild in the background, keep matching on the old automaton
+    uint64_t generation = template_engine_->GetGeneration();
+    if (generation != trigger_generation_) {
+        trigger_generation_ = generation;
+        trigger_matcher_->request_rebuild(generation);
+    }
+    trigger_matcher_->sync(trigger_cursor_);
+    
+    char c = event.key_event.character;
+    if (c == 0) {
+        // Non-character keys (arrows, modifiers) break the typed sequence
+        trigger_cursor_.reset();
+        return false;
+    }
+    
+    template_lookups_.fetch_add(1, std::memory_order_relaxed);
+    const std::string* shortcut = trigger_cursor_.advance(c);
+    if (!shortcut) {
+        return false;
+    }
+    
+    std::string matched = *shortcut;
+    trigger_cursor_.reset();
+    return expand_and_inject(matched, matched.size());
+}
+
+void KeystrokeExpander::run(EventQueue& queue, const std::function<bool()>& should_stop,
+                            const ProcessedCallback& on_processed, std::chrono::milliseconds poll) {
+    ProcessingEvent event;
+    
+    while (!should_stop()) {
+        // A shutdown seen before the call means an empty result is final, not a timeout
+        bool closing = queue.is_shutdown();
+        if (!queue.wait_pop(event, poll)) {
+            if (closing) break;
+            continue;
+        }
+        
+        auto start = std::chrono::steady_clock::now();
+        process_event(event);
+        if (on_processed) {
+            on_processed(std::chrono::steady_clock::now() - start);
+        }
+    }
+}
+
+bool KeystrokeExpander::expand_and_inject(const std::string& shortcut, size_t trigger_length) {
+    std::string expansion = template_engine_->expand_advanced(shortcut);
+    if (expansion.empty()) {
+        LOG_WARNING("Trigger '{}' matched but expanded to nothing", shortcut);
+        return false;
+    }
+    
+    if (!inject_(trigger_length, expansion)) {
+        LOG_ERROR("Failed to inject expansion for '{}'", shortcut);
+        return false;
+    }
+    
+    expansions_performed_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+} // namespace crossexpand
@@ -137,6 +137,59 @@ bool MemoryPoolManager::is_under_pressure() const {
             stats.xlarge.utilization > pressure_threshold_);
 }
 
+// MonotonicArena Implementation
+MonotonicArena::MonotonicArena(size_t block_size)
+    : cursor_(nullptr)
+    , remaining_(0)
+    , block_size_(block_size)
+    , bytes_used_(0)
+    , bytes_reserved_(0) {
+}
+
+void* MonotonicArena::allocate(size_t size, size_t alignment) {
+    size_t padding = cursor_ ? (alignment - reinterpret_cast<uintptr_t>(cursor_) % alignment) % alignment : 0;
+    
+    if (!cursor_ || padding + size > remaining_) {
+        // Oversized requests get a dedicated block so small allocations keep packing
+        size_t block = std::max(block_size_, size + alignment);
+        blocks_.push_back(std::make_unique<char[]>(block));
+        cursor_ = blocks_.back().get();
+        remaining_ = block;
+        bytes_reserved_ += block;
+        padding = (alignment - reinterpret_cast<uintptr_t>(cursor_) % alignment) % alignment;
+    }
+    
+    char* result = cursor_ + padding;
+    cursor_ = result + size;
+    remaining_ -= padding + size;
+    bytes_used_ += size;
+    return result;
+}
+
+std::string_view MonotonicArena::copy_string(std::string_view str) {
+    if (str.empty()) return {};
+    char* ptr = static_cast<char*>(allocate(str.size(), 1));
+    std::memcpy(ptr, str.data(), str.size());
+    return std::string_view(ptr, str.size());
+}
+
+void MonotonicArena::reserve(size_t size) {
+    if (size == 0 || (cursor_ && remaining_ >= size)) return;
+    
+    blocks_.push_back(std::make_unique<char[]>(size));
+    cursor_ = blocks_.back().get();
+    remaining_ = size;
+    bytes_reserved_ += size;
+}
+
+void MonotonicArena::reset() {
+    blocks_.clear();
+    cursor_ = nullptr;
+    remaining_ = 0;
+    bytes_used_ = 0;
+    bytes_reserved_ = 0;
+}
+
 // StringInternPool Implementation
 std::string_view StringInternPool::intern(const std::string& str) {
     {
@@ -228,8 +228,9 @@ void MultithreadedProcessor::shutdown() {
     
     is_running_.store(false);
     
-    // Stop all worker threads
+    // Stop all worker threads; shutting the queue down wakes the parked ones
     stop_worker_threads();
+    event_queue_->shutdown();
     
     // Wait for threads to finish
     join_worker_threads();
@@ -365,6 +366,34 @@ void MultithreadedProcessor::cleanup() {
     event_queue_.reset();
 }
 
+// EventProcessorWorker Implementation
+EventProcessorWorker::EventProcessorWorker(std::shared_ptr<EventQueue> queue,
+                                           std::shared_ptr<AdvancedTemplateEngine> engine,
+                                           std::shared_ptr<EnhancedTextInjector> injector,
+                                           int worker_id,
+                                           std::shared_ptr<TriggerMatcher> matcher)
+    : ThreadWorker(ThreadType::EVENT_PROCESSOR, "EventProcessor-" + std::to_string(worker_id))
+    , event_queue_(std::move(queue))
+    , template_engine_(engine)
+    , text_injector_(std::move(injector))
+    , expander_(std::move(engine), [this](size_t trigger_length, const std::string& expansion) {
+          if (!text_injector_->DeletePreviousChars(trigger_length) ||
+              !text_injector_->inject_text_enhanced(expansion)) {
+              LOG_ERROR("Text injector: {}", text_injector_->GetLastError());
+              return false;
+          }
+          return true;
+      }, std::move(matcher)) {
+}
+
+void EventProcessorWorker::run() {
+    // Returns on stop(), or once shutdown() has closed the queue and it is drained
+    expander_.run(*event_queue_, [this]() { return should_stop(); },
+                  [this](std::chrono::steady_clock::duration elapsed) {
+                      increment_task_counter(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed));
+                  });
+}
+
 // TimingHelper Implementation
 TimingHelper::TimingHelper(const std::string& operation_name)
     : operation_name_(operation_name)
@@ -0,0 +1,125 @@
+#include "core/snapshot.hpp"
+#include "utils/logger.hpp"
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+namespace crossexpand {
+
+// Per-thread reader state; the slot is handed back when the thread exits
+struct EpochDomain::ThreadRecord {
+    EpochDomain::ReaderSlot* slot = nullptr;
+    uint32_t depth = 0;
+    
+    ~ThreadRecord() {
+        if (slot) {
+            slot->epoch.store(0, std::memory_order_release);
+            slot->claimed.store(false, std::memory_order_release);
+        }
+    }
+};
+
+EpochDomain& EpochDomain::global() {
+    static EpochDomain domain;
+    return domain;
+}
+
+EpochDomain::~EpochDomain() {
+    for (const auto& retired : retired_) {
+        retired.deleter(retired.ptr);
+    }
+}
+
+EpochDomain::ReaderSlot* EpochDomain::claim_slot() {
+    for (bool warned = false;; warned = true) {
+        for (auto& slot : slots_) {
+            bool expected = false;
+            if (!slot.claimed.load(std::memory_order_relaxed) &&
+                slot.claimed.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                return &slot;
+            }
+        }
+        if (!warned) {
+            LOG_WARNING("All {} epoch reader slots in use, waiting for a thread to exit", MAX_READERS);
+        }
+        std::this_thread::yield();
+    }
+}
+
+EpochDomain::ThreadRecord& EpochDomain::local_record() {
+    static thread_local ThreadRecord record;
+    return record;
+}
+
+void EpochDomain::enter() {
+    ThreadRecord& record = local_record();
+    if (record.depth++ > 0) {
+        return;
+    }
+    if (!record.slot) {
+        record.slot = claim_slot();
+    }
+    
+    // seq_cst store orders the announcement before the reader's snapshot load
+    record.slot->epoch.store(global_epoch_.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+}
+
+void EpochDomain::exit() {
+    ThreadRecord& record = local_record();
+    if (--record.depth == 0) {
+        record.slot->epoch.store(0, std::memory_order_release);
+    }
+}
+
+void EpochDomain::retire(void* ptr, void (*deleter)(void*)) {
+    if (!ptr) return;
+    
+    {
+        // Readers that entered at or before this epoch may still hold ptr
+        uint64_t epoch = global_epoch_.fetch_add(1, std::memory_order_seq_cst);
+        std::lock_guard<std::mutex> lock(retire_mutex_);
+        retired_.push_back({ptr, deleter, epoch});
+    }
+    
+    reclaim();
+}
+
+uint64_t EpochDomain::min_active_epoch() const {
+    uint64_t min_epoch = std::numeric_limits<uint64_t>::max();
+    for (const auto& slot : slots_) {
+        uint64_t epoch = slot.epoch.load(std::memory_order_seq_cst);
+        if (epoch != 0) {
+            min_epoch = std::min(min_epoch, epoch);
+        }
+    }
+    return min_epoch;
+}
+
+size_t EpochDomain::reclaim() {
+    std::vector<Retired> ready;
+    {
+        std::lock_guard<std::mutex> lock(retire_mutex_);
+        if (retired_.empty()) {
+            return 0;
+        }
+        
+        uint64_t min_epoch = min_active_epoch();
+        auto split = std::partition(retired_.begin(), retired_.end(),
+                                    [min_epoch](const Retired& r) { return r.epoch >= min_epoch; });
+        ready.assign(split, retired_.end());
+        retired_.erase(split, retired_.end());
+    }
+    
+    // Deleters may be arbitrarily expensive; run them outside the lock
+    for (const auto& retired : ready) {
+        retired.deleter(retired.ptr);
+    }
+    return ready.size();
+}
+
+size_t EpochDomain::pending() const {
+    std::lock_guard<std::mutex> lock(retire_mutex_);
+    return retired_.size();
+}
+
+} // namespace crossexpand
@@ -1,6 +1,5 @@
 #include "core/template_engine.hpp"
 #include "utils/logger.hpp"
-#include <regex>
 #include <algorithm>
 
 namespace crossexpand {
@@ -9,133 +8,515 @@ TemplateEngine::TemplateEngine() {
     LOG_DEBUG("TemplateEngine initialized");
 }
 
-void TemplateEngine::AddTemplate(const std::string& shortcut, const Template& tmpl) {
-    std::lock_guard<std::shared_mutex> lock(cache_mutex_);
-    templates_[shortcut] = tmpl;
-    LOG_DEBUG("Added template: {}", shortcut);
+std::shared_ptr<TemplateEngine::CompiledTemplate> TemplateEngine::Compile(SourceBuffer source, bool defer) {
+    // Segments are offsets into the source buffer, which is never copied
+    auto compiled = std::make_shared<CompiledTemplate>();
+    compiled->source = std::move(source);
+    const std::string_view text = compiled->source.view();
+    if (defer && text.find("{/") == std::string_view::npos) {
+        compiled->deferred = true;  // Cannot include anything, so the graph needs no segments
+        return compiled;
+    }
+    
+    compiled->segments = Tokenize(text);
+    for (const auto& segment : compiled->segments) {
+        if (segment.kind == TemplateSegment::Kind::INCLUDE) {
+            std::string name(text.substr(segment.offset, segment.length));
+            if (std::find(compiled->includes.begin(), compiled->includes.end(), name) == compiled->includes.end()) {
+                compiled->includes.push_back(std::move(name));
+            }
+        }
+    }
+    return compiled;
+}
+
+void TemplateEngine::CountSegments(const CompiledTemplate& compiled) {
+    compiled.literal_bytes = 0;
+    compiled.variable_count = 0;
+    for (const auto& segment : compiled.segments) {
+        if (segment.kind == TemplateSegment::Kind::LITERAL) {
+            compiled.literal_bytes += segment.length;
+        } else {
+            compiled.variable_count++;
+        }
+    }
+}
+
+TemplateEngine::CompiledTemplate::CompiledTemplate(const CompiledTemplate& other)
+    : source(other.source)
+    , segments(other.segments)
+    , includes(other.includes)
+    , deferred(other.deferred)
+    , linked_text(other.linked_text)
+    , linked_segments(other.linked_segments)
+    , literal_bytes(other.literal_bytes)
+    , variable_count(other.variable_count) {
+}
+
+const std::vector<TemplateSegment>& TemplateEngine::CompiledTemplate::expansion_segments() const {
+    if (deferred) {
+        // Readers share the snapshot, so the first one to get here tokenizes for all
+        std::call_once(tokenized, [this] {
+            segments = Tokenize(source.view());
+            CountSegments(*this);
+        });
+    }
+    return includes.empty() ? segments : linked_segments;
+}
+
+TemplateFootprint TemplateEngine::CompiledTemplate::footprint() const {
+    expansion_segments();  // Deferred segments are filled by another thread otherwise
+    TemplateFootprint bytes;
+    bytes.source_bytes = source.owned_bytes();
+    bytes.compiled_bytes = (segments.capacity() + linked_segments.capacity()) * sizeof(TemplateSegment) +
+                           includes.capacity() * sizeof(std::string);
+    for (const auto& include : includes) {
+        bytes.compiled_bytes += include.capacity();
+    }
+    bytes.linked_bytes = includes.empty() ? 0 : linked_text.capacity();
+    return bytes;
+}
+
+bool TemplateEngine::AddTemplate(const std::string& shortcut, const Template& tmpl) {
+    return AddTemplates({{shortcut, tmpl}}) == 1;
+}
+
+size_t TemplateEngine::AddTemplates(const std::vector<std::pair<std::string, Template>>& templates) {
+    std::vector<std::pair<std::string, std::shared_ptr<CompiledTemplate>>> compiled;
+    compiled.reserve(templates.size());
+    for (const auto& entry : templates) {
+        compiled.emplace_back(entry.first, Compile(std::make_shared<const std::string>(entry.second.text)));
+    }
+    return Publish(compiled);
+}
+
+size_t TemplateEngine::AddTemplates(std::vector<std::pair<std::string, Template>>&& templates) {
+    std::vector<std::pair<std::string, std::shared_ptr<CompiledTemplate>>> compiled;
+    compiled.reserve(templates.size());
+    for (auto& entry : templates) {
+        compiled.emplace_back(std::move(entry.first),
+                              Compile(std::make_shared<const std::string>(std::move(entry.second.text)), true));
+    }
+    templates.clear();
+    return Publish(compiled);
+}
+
+size_t TemplateEngine::AddTemplateSources(std::vector<std::pair<std::string, SourceBuffer>> sources,
+                                          std::vector<size_t>* rejected) {
+    std::vector<std::pair<std::string, std::shared_ptr<CompiledTemplate>>> compiled;
+    compiled.reserve(sources.size());
+    for (auto& entry : sources) {
+        compiled.emplace_back(std::move(entry.first), Compile(std::move(entry.second), true));
+    }
+    return Publish(compiled, rejected);
+}
+
+SourceBuffer TemplateEngine::GetTemplateSource(const std::string& shortcut) const {
+    auto set = templates_.read();
+    auto it = set->templates.find(shortcut);
+    return it != set->templates.end() ? it->second->source : SourceBuffer();
+}
+
+size_t TemplateEngine::Publish(std::vector<std::pair<std::string, std::shared_ptr<CompiledTemplate>>>& compiled,
+                               std::vector<size_t>* rejected) {
+    if (compiled.empty()) return 0;
+    
+    size_t added = 0;
+    templates_.update([&](TemplateSet& set) {
+        for (size_t i = 0; i < compiled.size(); ++i) {
+            const std::string& shortcut = compiled[i].first;
+            if (InsertTemplate(set, shortcut, std::move(compiled[i].second))) {
+                added++;
+                LOG_DEBUG("Added template: {}", shortcut);
+            } else {
+                LOG_ERROR("Rejected template '{}': its includes form a cycle", shortcut);
+                if (rejected) rejected->push_back(i);
+            }
+        }
+        return added > 0;
+    });
+    
+    if (added > 0) {
+        generation_.fetch_add(1, std::memory_order_release);
+    }
+    return added;
 }
 
 bool TemplateEngine::RemoveTemplate(const std::string& shortcut) {
-    std::lock_guard<std::shared_mutex> lock(cache_mutex_);
-    auto it = templates_.find(shortcut);
-    if (it != templates_.end()) {
-        templates_.erase(it);
-        LOG_DEBUG("Removed template: {}", shortcut);
+    bool removed = templates_.update([&](TemplateSet& set) {
+        auto it = set.templates.find(shortcut);
+        if (it == set.templates.end()) {
+            return false;
+        }
+        
+        for (const auto& include : it->second->includes) {
+            auto& users = set.dependents[include];
+            users.erase(std::remove(users.begin(), users.end(), shortcut), users.end());
+            if (users.empty()) {
+                set.dependents.erase(include);
+            }
+        }
+        set.templates.erase(it);
+        
+        // Templates including this one now render the include verbatim
+        RelinkDependents(set, shortcut);
         return true;
+    });
+    if (removed) {
+        generation_.fetch_add(1, std::memory_order_release);
+        LOG_DEBUG("Removed template: {}", shortcut);
     }
-    return false;
+    return removed;
 }
 
 bool TemplateEngine::HasTemplate(const std::string& shortcut) const {
-    std::shared_lock<std::shared_mutex> lock(cache_mutex_);
-    return templates_.find(shortcut) != templates_.end();
+    auto set = templates_.read();
+    return set->templates.find(shortcut) != set->templates.end();
 }
 
 std::string TemplateEngine::Expand(const std::string& shortcut, const Context& context) const {
-    std::shared_lock<std::shared_mutex> lock(cache_mutex_);
+    return ExpandShortcut(shortcut, [&context](const std::string& name) -> std::optional<std::string_view> {
+        auto it = context.find(name);
+        return it != context.end() ? std::optional<std::string_view>(it->second) : std::nullopt;
+    });
+}
+
+std::string TemplateEngine::ExpandWithLookup(const std::string& shortcut, const VariableLookup& lookup) const {
+    return ExpandShortcut(shortcut, lookup);
+}
+
+template<typename Lookup>
+std::string TemplateEngine::ExpandShortcut(const std::string& shortcut, const Lookup& lookup) const {
+    auto set = templates_.read();
     
-    auto it = templates_.find(shortcut);
-    if (it == templates_.end()) {
+    auto it = set->templates.find(shortcut);
+    if (it == set->templates.end()) {
         LOG_WARNING("Template not found: {}", shortcut);
         return "";
     }
     
-    const auto& tmpl = it->second;
-    
-    // Cycle detection
-    std::unordered_set<std::string> visited;
-    if (DetectCycle(tmpl.text, visited)) {
-        LOG_ERROR("Cycle detected in template: {}", shortcut);
-        return "";
-    }
-    
-    // Expand variables
-    std::string result = ExpandVariables(tmpl.text, context);
+    // Includes were inlined and checked for cycles when the template set changed
+    auto globals = global_variables_.read();
+    std::string result = ExpandVariables(*it->second, lookup, *globals);
     
     LOG_DEBUG("Expanded template '{}' to '{}'", shortcut, result);
     return result;
 }
 
 void TemplateEngine::SetVariable(const std::string& name, const std::string& value) {
-    std::lock_guard<std::shared_mutex> lock(cache_mutex_);
-    global_variables_[name] = value;
+    global_variables_.update([&](VariableMap& variables) {
+        variables[name] = value;
+        return true;
+    });
+    variables_generation_.fetch_add(1, std::memory_order_release);
     LOG_DEBUG("Set variable '{}' = '{}'", name, value);
 }
 
+void TemplateEngine::SetVariables(const std::unordered_map<std::string, std::string>& variables) {
+    if (variables.empty()) return;
+    
+    global_variables_.update([&](VariableMap& current) {
+        for (const auto& [name, value] : variables) {
+            current[name] = value;
+        }
+        return true;
+    });
+    variables_generation_.fetch_add(1, std::memory_order_release);
+    LOG_DEBUG("Set {} variables", variables.size());
+}
+
 std::string TemplateEngine::GetVariable(const std::string& name) const {
-    std::shared_lock<std::shared_mutex> lock(cache_mutex_);
-    auto it = global_variables_.find(name);
-    return it != global_variables_.end() ? it->second : "";
+    auto variables = global_variables_.read();
+    auto it = variables->find(name);
+    return it != variables->end() ? it->second : "";
 }
 
 size_t TemplateEngine::GetTemplateCount() const {
-    std::shared_lock<std::shared_mutex> lock(cache_mutex_);
-    return templates_.size();
+    return templates_.read()->templates.size();
+}
+
+std::vector<std::string> TemplateEngine::GetShortcuts() const {
+    auto set = templates_.read();
+    std::vector<std::string> shortcuts;
+    shortcuts.reserve(set->templates.size());
+    for (const auto& pair : set->templates) {
+        shortcuts.push_back(pair.first);
+    }
+    return shortcuts;
+}
+
+TemplateFootprint TemplateEngine::GetTemplateFootprint(const std::string& shortcut) const {
+    auto set = templates_.read();
+    auto it = set->templates.find(shortcut);
+    return it != set->templates.end() ? it->second->footprint() : TemplateFootprint{};
+}
+
+TemplateFootprint TemplateEngine::GetTotalFootprint() const {
+    TemplateFootprint total;
+    for (const auto& entry : templates_.read()->templates) {
+        total += entry.second->footprint();
+    }
+    return total;
+}
+
+std::vector<std::string> TemplateEngine::GetDependents(const std::string& shortcut) const {
+    auto dependents = CollectDependents(*templates_.read(), shortcut);
+    return std::vector<std::string>(dependents.begin(), dependents.end());
 }
 
 void TemplateEngine::ClearCache() {
-    std::lock_guard<std::shared_mutex> lock(cache_mutex_);
-    templates_.clear();
-    global_variables_.clear();
+    templates_.reset(std::make_unique<TemplateSet>());
+    global_variables_.reset(std::make_unique<VariableMap>());
+    generation_.fetch_add(1, std::memory_order_release);
+    variables_generation_.fetch_add(1, std::memory_order_release);
     LOG_INFO("Template cache cleared");
 }
 
-std::string TemplateEngine::ExpandVariables(const std::string& text, const Context& context) const {
-    std::string result = text;
+std::vector<TemplateSegment> TemplateEngine::Tokenize(std::string_view text) {
+    // Same grammar as the previous \{([^}]+)\} regex: a '{' followed by at least one
+    // non-'}' character and a closing '}' is a variable (an include if it starts with '/'),
+    // everything else is literal.
+    std::vector<TemplateSegment> segments;
+    size_t literal_start = 0;
+    size_t pos = 0;
     
-    // Replace variables in format {variable_name}
-    std::regex var_regex(R"(\{([^}]+)\})");
-    std::smatch match;
+    auto push = [&segments](TemplateSegment::Kind kind, size_t offset, size_t length) {
+        if (length > 0) {
+            segments.push_back({kind, static_cast<uint32_t>(offset), static_cast<uint32_t>(length)});
+        }
+    };
     
-    while (std::regex_search(result, match, var_regex)) {
-        std::string var_name = match[1].str();
-        std::string replacement;
+    while ((pos = text.find('{', pos)) != std::string::npos) {
+        size_t close = text.find('}', pos + 1);
+        if (close == std::string::npos) {
+            break;
+        }
+        if (close == pos + 1) {
+            pos++; // "{}" is literal
+            continue;
+        }
         
-        // Check context first, then global variables
-        auto ctx_it = context.find(var_name);
-        if (ctx_it != context.end()) {
-            replacement = ctx_it->second;
-        } else {
-            auto global_it = global_variables_.find(var_name);
-            if (global_it != global_variables_.end()) {
-                replacement = global_it->second;
-            } else {
-                LOG_WARNING("Variable not found: {}", var_name);
-                replacement = "{" + var_name + "}"; // Keep original if not found
-            }
+        push(TemplateSegment::Kind::LITERAL, literal_start, pos - literal_start);
+        push(text[pos + 1] == '/' ? TemplateSegment::Kind::INCLUDE : TemplateSegment::Kind::VARIABLE,
+             pos + 1, close - pos - 1);
+        pos = close + 1;
+        literal_start = pos;
+    }
+    
+    push(TemplateSegment::Kind::LITERAL, literal_start, text.length() - literal_start);
+    return segments;
+}
+
+template<typename Lookup>
+std::string TemplateEngine::ExpandVariables(const CompiledTemplate& compiled, const Lookup& lookup,
+                                            const VariableMap& globals) const {
+    const auto& segments = compiled.expansion_segments();
+    const std::string_view text = compiled.text();
+    
+    // Single pass over the precomputed spans; substituted values are not rescanned
+    std::string result;
+    result.reserve(compiled.literal_bytes + compiled.variable_count * 16);
+    
+    std::string var_name;
+    for (const auto& segment : segments) {
+        if (segment.kind == TemplateSegment::Kind::LITERAL) {
+            result.append(text, segment.offset, segment.length);
+            continue;
         }
         
-        result = std::regex_replace(result, var_regex, replacement, std::regex_constants::format_first_only);
+        var_name.assign(text, segment.offset, segment.length);
+        
+        // Check the caller's values first, then global variables
+        if (auto value = lookup(var_name)) {
+            result += *value;
+            continue;
+        }
+        
+        auto global_it = globals.find(var_name);
+        if (global_it != globals.end()) {
+            result += global_it->second;
+        } else {
+            LOG_WARNING("Variable not found: {}", var_name);
+            result.append(text, segment.offset - 1, segment.length + 2); // Keep original if not found
+        }
     }
     
     return result;
 }
 
-bool TemplateEngine::DetectCycle(const std::string& text, std::unordered_set<std::string>& visited) const {
-    // Simple cycle detection for template references
-    std::regex template_regex(R"(/\w+)");
-    std::sregex_iterator iter(text.begin(), text.end(), template_regex);
-    std::sregex_iterator end;
+bool TemplateEngine::CreatesCycle(const TemplateSet& set, const std::string& shortcut, const CompiledTemplate& compiled) {
+    // Adding shortcut closes a cycle iff shortcut is reachable from one of its includes
+    std::vector<const std::string*> stack;
+    std::unordered_set<std::string> visited;
+    for (const auto& include : compiled.includes) {
+        stack.push_back(&include);
+    }
     
-    for (; iter != end; ++iter) {
-        std::string referenced_template = iter->str();
-        if (visited.find(referenced_template) != visited.end()) {
-            return true; // Cycle detected
+    while (!stack.empty()) {
+        const std::string& name = *stack.back();
+        stack.pop_back();
+        if (name == shortcut) {
+            return true;
+        }
+        if (!visited.insert(name).second) {
+            continue;
         }
         
-        visited.insert(referenced_template);
-        
-        auto tmpl_it = templates_.find(referenced_template);
-        if (tmpl_it != templates_.end()) {
-            if (DetectCycle(tmpl_it->second.text, visited)) {
-                return true;
+        auto it = set.templates.find(name);
+        if (it != set.templates.end()) {
+            for (const auto& include : it->second->includes) {
+                stack.push_back(&include);
             }
         }
-        
-        visited.erase(referenced_template);
     }
     
     return false;
 }
 
+bool TemplateEngine::InsertTemplate(TemplateSet& set, const std::string& shortcut, std::shared_ptr<CompiledTemplate> compiled) {
+    if (CreatesCycle(set, shortcut, *compiled)) {
+        return false;
+    }
+    
+    // Replace this template's outgoing edges in the reverse graph
+    auto old = set.templates.find(shortcut);
+    if (old != set.templates.end()) {
+        for (const auto& include : old->second->includes) {
+            auto& users = set.dependents[include];
+            users.erase(std::remove(users.begin(), users.end(), shortcut), users.end());
+            if (users.empty()) {
+                set.dependents.erase(include);
+            }
+        }
+    }
+    for (const auto& include : compiled->includes) {
+        set.dependents[include].push_back(shortcut);
+    }
+    
+    Link(*compiled, set);
+    set.templates[shortcut] = std::move(compiled);
+    RelinkDependents(set, shortcut);
+    return true;
+}
+
+void TemplateEngine::Link(CompiledTemplate& compiled, const TemplateSet& set) {
+    compiled.linked_text.clear();
+    compiled.linked_segments.clear();
+    compiled.literal_bytes = 0;
+    compiled.variable_count = 0;
+    
+    if (compiled.includes.empty()) {
+        if (!compiled.deferred) {
+            CountSegments(compiled);
+        }
+        return;
+    }
+    
+    std::string& out = compiled.linked_text;
+    auto& segments = compiled.linked_segments;
+    
+    auto append_literal = [&](const char* data, size_t length) {
+        if (length == 0) return;
+        if (!segments.empty() && segments.back().kind == TemplateSegment::Kind::LITERAL &&
+            segments.back().offset + segments.back().length == out.size()) {
+            segments.back().length += static_cast<uint32_t>(length);
+        } else {
+            segments.push_back({TemplateSegment::Kind::LITERAL, static_cast<uint32_t>(out.size()), static_cast<uint32_t>(length)});
+        }
+        out.append(data, length);
+        compiled.literal_bytes += length;
+    };
+    
+    // Variables keep their braces in the linked text so unknown ones can be echoed verbatim
+    auto append_variable = [&](const char* name, size_t length) {
+        out += '{';
+        segments.push_back({TemplateSegment::Kind::VARIABLE, static_cast<uint32_t>(out.size()), static_cast<uint32_t>(length)});
+        out.append(name, length);
+        out += '}';
+        compiled.variable_count++;
+    };
+    
+    const std::string_view text = compiled.source.view();
+    for (const auto& segment : compiled.segments) {
+        const char* data = text.data() + segment.offset;
+        switch (segment.kind) {
+            case TemplateSegment::Kind::LITERAL:
+                append_literal(data, segment.length);
+                break;
+            
+            case TemplateSegment::Kind::VARIABLE:
+                append_variable(data, segment.length);
+                break;
+            
+            case TemplateSegment::Kind::INCLUDE: {
+                auto it = set.templates.find(std::string(data, segment.length));
+                if (it == set.templates.end()) {
+                    append_literal(data - 1, segment.length + 2); // Keep original if not found
+                    break;
+                }
+                
+                // Included templates are already linked, so one level of inlining suffices
+                const CompiledTemplate& included = *it->second;
+                const auto& included_segments = included.expansion_segments();
+                const std::string_view included_text = included.text();
+                for (const auto& inner : included_segments) {
+                    if (inner.kind == TemplateSegment::Kind::LITERAL) {
+                        append_literal(included_text.data() + inner.offset, inner.length);
+                    } else {
+                        append_variable(included_text.data() + inner.offset, inner.length);
+                    }
+                }
+                break;
+            }
+        }
+    }
+}
+
+std::unordered_set<std::string> TemplateEngine::CollectDependents(const TemplateSet& set, const std::string& shortcut) {
+    std::unordered_set<std::string> affected;
+    std::vector<std::string> stack{shortcut};
+    while (!stack.empty()) {
+        std::string name = std::move(stack.back());
+        stack.pop_back();
+        
+        auto it = set.dependents.find(name);
+        if (it == set.dependents.end()) continue;
+        for (const auto& dependent : it->second) {
+            if (affected.insert(dependent).second) {
+                stack.push_back(dependent);
+            }
+        }
+    }
+    return affected;
+}
+
+void TemplateEngine::RelinkDependents(TemplateSet& set, const std::string& shortcut) {
+    // Only templates that (transitively) include shortcut need their inlined text rebuilt
+    std::unordered_set<std::string> affected = CollectDependents(set, shortcut);
+    std::unordered_set<std::string> done;
+    for (const auto& name : affected) {
+        Relink(set, name, affected, done);
+    }
+}
+
+void TemplateEngine::Relink(TemplateSet& set, const std::string& shortcut,
+                            const std::unordered_set<std::string>& affected, std::unordered_set<std::string>& done) {
+    if (!done.insert(shortcut).second) return;
+    
+    auto it = set.templates.find(shortcut);
+    if (it == set.templates.end()) return;
+    
+    // Relink affected includes first; the graph is acyclic so this terminates
+    for (const auto& include : it->second->includes) {
+        if (affected.count(include)) {
+            Relink(set, include, affected, done);
+        }
+    }
+    
+    // Snapshot values are shared with readers, so relink a copy
+    auto relinked = std::make_shared<CompiledTemplate>(*it->second);
+    Link(*relinked, set);
+    it->second = std::move(relinked);
+}
+
 } // namespace crossexpand
@@ -0,0 +1,345 @@
+#include "core/template_store.hpp"
+#include "utils/logger.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace crossexpand {
+
+namespace {
+
+constexpr char STORE_MAGIC[8] = {'C', 'X', 'T', 'S', 'T', 'O', 'R', 'E'};
+constexpr uint32_t STORE_VERSION = 1;
+constexpr uint32_t STORE_ENDIAN_MARK = 0x01020304;
+
+} // namespace
+
+struct StoreSpan {
+    uint64_t offset;
+    uint64_t count;  // Elements, or bytes for strings
+};
+
+struct StoreHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian_mark;
+    // Layout fingerprint: the compiled arrays are stored as raw structs
+    uint8_t sizes[8];
+    uint64_t file_size;
+    uint64_t record_count;
+    uint64_t records_offset;
+};
+
+struct StoreRecord {
+    uint64_t source_hash;
+    StoreSpan shortcut;
+    StoreSpan source;
+    StoreSpan variables;  // Array of string Spans, in required_variables_ order
+    StoreSpan code;
+    StoreSpan calls;
+    StoreSpan args;
+    StoreSpan loops;
+    StoreSpan conditions;
+    StoreSpan text;
+    uint64_t loop_depth;
+};
+
+namespace {
+
+void layout_fingerprint(uint8_t (&sizes)[8]) {
+    std::memset(sizes, 0, sizeof(sizes));
+    sizes[0] = sizeof(Instruction);
+    sizes[1] = sizeof(FunctionCall);
+    sizes[2] = sizeof(CallArgument);
+    sizes[3] = sizeof(LoopInfo);
+    sizes[4] = sizeof(ConditionOp);
+}
+
+// Builds the file image in memory; every section starts 8-byte aligned
+class StoreWriter {
+private:
+    std::string buffer_;
+    std::unordered_map<std::string, uint64_t> strings_;  // Interned string -> offset
+
+public:
+    uint64_t align() {
+        buffer_.resize((buffer_.size() + 7) & ~size_t(7), '\0');
+        return buffer_.size();
+    }
+    
+    uint64_t reserve(size_t bytes) {
+        uint64_t offset = align();
+        buffer_.resize(buffer_.size() + bytes, '\0');
+        return offset;
+    }
+    
+    template<typename T>
+    StoreSpan array(const T* data, size_t count) {
+        if (count == 0) return {0, 0};
+        uint64_t offset = align();
+        buffer_.append(reinterpret_cast<const char*>(data), sizeof(T) * count);
+        return {offset, count};
+    }
+    
+    StoreSpan bytes(std::string_view data) {
+        if (data.empty()) return {0, 0};
+        uint64_t offset = buffer_.size();
+        buffer_.append(data.data(), data.size());
+        return {offset, data.size()};
+    }
+    
+    StoreSpan intern(std::string_view str) {
+        auto it = strings_.find(std::string(str));
+        if (it != strings_.end()) {
+            return {it->second, str.size()};
+        }
+        StoreSpan span = bytes(str);
+        strings_.emplace(std::string(str), span.offset);
+        return span;
+    }
+    
+    template<typename T>
+    void store(uint64_t offset, const T& value) {
+        std::memcpy(&buffer_[offset], &value, sizeof(T));
+    }
+    
+    const std::string& buffer() const { return buffer_; }
+};
+
+} // namespace
+
+TemplateStore::~TemplateStore() {
+    if (data_) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+uint64_t TemplateStore::hash_source(std::string_view source) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : source) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool TemplateStore::write(const std::string& path,
+                          const std::vector<std::pair<std::string, const AdvancedTemplate*>>& templates) {
+    std::vector<std::pair<std::string, const AdvancedTemplate*>> sorted;
+    for (const auto& entry : templates) {
+        if (entry.second && entry.second->is_compiled()) {
+            sorted.push_back(entry);
+        }
+    }
+    std::sort(sorted.begin(), sorted.end(),
+              [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+    
+    StoreWriter writer;
+    uint64_t header_offset = writer.reserve(sizeof(StoreHeader));
+    uint64_t records_offset = writer.reserve(sizeof(StoreRecord) * sorted.size());
+    
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        const std::string_view source = sorted[i].second->get_source();
+        const CompiledImage image = sorted[i].second->image();
+        
+        StoreRecord record{};
+        record.source_hash = hash_source(source);
+        record.shortcut = writer.intern(sorted[i].first);
+        record.source = writer.intern(source);
+        
+        std::vector<StoreSpan> names;
+        names.reserve(image.variables.size());
+        for (std::string_view name : image.variables) {
+            names.push_back(writer.intern(name));
+        }
+        record.variables = writer.array(names.data(), names.size());
+        record.code = writer.array(image.code, image.code_size);
+        record.calls = writer.array(image.calls, image.call_count);
+        record.args = writer.array(image.args, image.arg_count);
+        record.loops = writer.array(image.loops, image.loop_count);
+        record.conditions = writer.array(image.conditions, image.condition_count);
+        // Compiled templates use their source as the text pool, so the interned source
+        // doubles as the text section
+        const std::string_view text(image.text ? image.text : "", image.text_size);
+        record.text = text == source ? record.source : writer.bytes(text);
+        record.loop_depth = image.loop_depth;
+        writer.store(records_offset + i * sizeof(StoreRecord), record);
+    }
+    
+    StoreHeader header{};
+    std::memcpy(header.magic, STORE_MAGIC, sizeof(header.magic));
+    header.version = STORE_VERSION;
+    header.endian_mark = STORE_ENDIAN_MARK;
+    layout_fingerprint(header.sizes);
+    header.file_size = writer.align();
+    header.record_count = sorted.size();
+    header.records_offset = records_offset;
+    writer.store(header_offset, header);
+    
+    // Write a sibling file and rename it over the store: processes that still map the
+    // old file keep reading its (unlinked) pages
+    const std::string temp_path = path + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            LOG_ERROR("Failed to open template store for writing: {}", temp_path);
+            return false;
+        }
+        file.write(writer.buffer().data(), static_cast<std::streamsize>(writer.buffer().size()));
+        if (!file) {
+            LOG_ERROR("Failed to write template store: {}", temp_path);
+            std::remove(temp_path.c_str());
+            return false;
+        }
+    }
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        LOG_ERROR("Failed to replace template store: {}", path);
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    
+    LOG_INFO("Wrote {} precompiled templates ({} bytes) to {}", sorted.size(), writer.buffer().size(), path);
+    return true;
+}
+
+std::shared_ptr<const TemplateStore> TemplateStore::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_DEBUG("No template store at {}", path);
+        return nullptr;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(StoreHeader)) {
+        ::close(fd);
+        LOG_WARNING("Ignoring truncated template store: {}", path);
+        return nullptr;
+    }
+    
+    size_t size = static_cast<size_t>(st.st_size);
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        LOG_ERROR("Failed to map template store: {}", path);
+        return nullptr;
+    }
+    
+    std::shared_ptr<TemplateStore> store(new TemplateStore());
+    store->data_ = static_cast<const char*>(mapping);
+    store->size_ = size;
+    if (!store->validate()) {
+        LOG_WARNING("Ignoring incompatible or corrupt template store: {}", path);
+        return nullptr;
+    }
+    
+    LOG_INFO("Mapped {} precompiled templates from {}", store->record_count_, path);
+    return store;
+}
+
+bool TemplateStore::span_fits(const StoreSpan& span, size_t element_size) const {
+    if (span.count == 0) return true;
+    if (span.count > std::numeric_limits<uint32_t>::max()) return false;
+    if (span.offset > size_ || span.count > (size_ - span.offset) / element_size) return false;
+    // Raw structs are read in place, so arrays must be aligned for their type
+    return element_size == 1 || span.offset % 8 == 0;
+}
+
+bool TemplateStore::validate() {
+    StoreHeader header;
+    std::memcpy(&header, data_, sizeof(header));
+    uint8_t sizes[8];
+    layout_fingerprint(sizes);
+    
+    if (std::memcmp(header.magic, STORE_MAGIC, sizeof(header.magic)) != 0 || header.version != STORE_VERSION ||
+        header.endian_mark != STORE_ENDIAN_MARK || std::memcmp(header.sizes, sizes, sizeof(sizes)) != 0 ||
+        header.file_size != size_) {
+        return false;
+    }
+    if (!span_fits({header.records_offset, header.record_count}, sizeof(StoreRecord)) || header.records_offset == 0) {
+        return false;
+    }
+    
+    auto* records = reinterpret_cast<const StoreRecord*>(data_ + header.records_offset);
+    for (uint64_t i = 0; i < header.record_count; ++i) {
+        const StoreRecord& record = records[i];
+        bool ok = span_fits(record.shortcut, 1) && span_fits(record.source, 1) &&
+                  span_fits(record.variables, sizeof(StoreSpan)) && span_fits(record.code, sizeof(Instruction)) &&
+                  span_fits(record.calls, sizeof(FunctionCall)) && span_fits(record.args, sizeof(CallArgument)) &&
+                  span_fits(record.loops, sizeof(LoopInfo)) && span_fits(record.conditions, sizeof(ConditionOp)) &&
+                  span_fits(record.text, 1);
+        if (!ok) return false;
+        
+        auto* names = reinterpret_cast<const StoreSpan*>(data_ + record.variables.offset);
+        for (uint64_t n = 0; n < record.variables.count; ++n) {
+            if (!span_fits(names[n], 1)) return false;
+        }
+        if (i > 0 && !(string(records[i - 1].shortcut) < string(record.shortcut))) {
+            return false;
+        }
+    }
+    
+    records_ = records;
+    record_count_ = header.record_count;
+    return true;
+}
+
+std::string_view TemplateStore::string(const StoreSpan& span) const {
+    return span.count ? std::string_view(data_ + span.offset, span.count) : std::string_view();
+}
+
+std::optional<size_t> TemplateStore::find(std::string_view shortcut) const {
+    const StoreRecord* end = records_ + record_count_;
+    const StoreRecord* it = std::lower_bound(records_, end, shortcut, [this](const StoreRecord& record, std::string_view key) {
+        return string(record.shortcut) < key;
+    });
+    if (it == end || string(it->shortcut) != shortcut) {
+        return std::nullopt;
+    }
+    return static_cast<size_t>(it - records_);
+}
+
+std::string_view TemplateStore::shortcut(size_t index) const {
+    return string(records_[index].shortcut);
+}
+
+std::string_view TemplateStore::source(size_t index) const {
+    return string(records_[index].source);
+}
+
+uint64_t TemplateStore::source_hash(size_t index) const {
+    return records_[index].source_hash;
+}
+
+CompiledImage TemplateStore::image(size_t index) const {
+    const StoreRecord& record = records_[index];
+    CompiledImage image;
+    image.code = reinterpret_cast<const Instruction*>(data_ + record.code.offset);
+    image.code_size = static_cast<uint32_t>(record.code.count);
+    image.calls = reinterpret_cast<const FunctionCall*>(data_ + record.calls.offset);
+    image.call_count = static_cast<uint32_t>(record.calls.count);
+    image.args = reinterpret_cast<const CallArgument*>(data_ + record.args.offset);
+    image.arg_count = static_cast<uint32_t>(record.args.count);
+    image.loops = reinterpret_cast<const LoopInfo*>(data_ + record.loops.offset);
+    image.loop_count = static_cast<uint32_t>(record.loops.count);
+    image.conditions = reinterpret_cast<const ConditionOp*>(data_ + record.conditions.offset);
+    image.condition_count = static_cast<uint32_t>(record.conditions.count);
+    image.text = data_ + record.text.offset;
+    image.text_size = static_cast<uint32_t>(record.text.count);
+    image.loop_depth = static_cast<uint32_t>(record.loop_depth);
+    
+    auto* names = reinterpret_cast<const StoreSpan*>(data_ + record.variables.offset);
+    image.variables.reserve(record.variables.count);
+    for (uint64_t i = 0; i < record.variables.count; ++i) {
+        image.variables.push_back(string(names[i]));
+    }
+    return image;
+}
+
+} // namespace crossexpand
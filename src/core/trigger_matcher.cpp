@@ -0,0 +1,192 @@
+#include "core/trigger_matcher.hpp"
+#include "utils/logger.hpp"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+namespace crossexpand {
+
+// TriggerAutomaton Implementation
+std::shared_ptr<const TriggerAutomaton> TriggerAutomaton::build(std::vector<std::string> shortcuts,
+                                                                uint64_t generation) {
+    constexpr uint32_t MISSING = std::numeric_limits<uint32_t>::max();
+    
+    auto automaton = std::make_shared<TriggerAutomaton>();
+    automaton->generation_ = generation;
+    
+    shortcuts.erase(std::remove(shortcuts.begin(), shortcuts.end(), std::string()), shortcuts.end());
+    std::sort(shortcuts.begin(), shortcuts.end());
+    shortcuts.erase(std::unique(shortcuts.begin(), shortcuts.end()), shortcuts.end());
+    
+    // Compress the alphabet to the bytes that actually occur in shortcuts
+    size_t alphabet = 1;
+    for (const auto& shortcut : shortcuts) {
+        for (char c : shortcut) {
+            auto& cls = automaton->byte_class_[static_cast<unsigned char>(c)];
+            if (cls == 0) {
+                cls = static_cast<uint16_t>(alphabet++);
+            }
+        }
+    }
+    automaton->alphabet_size_ = alphabet;
+    
+    auto& trans = automaton->transitions_;
+    auto& output = automaton->output_;
+    
+    auto add_state = [&]() {
+        trans.resize(trans.size() + alphabet, MISSING);
+        output.push_back(-1);
+        return static_cast<uint32_t>(output.size() - 1);
+    };
+    
+    // Trie
+    add_state();
+    for (size_t i = 0; i < shortcuts.size(); ++i) {
+        uint32_t state = ROOT;
+        for (char c : shortcuts[i]) {
+            size_t slot = state * alphabet + automaton->byte_class_[static_cast<unsigned char>(c)];
+            if (trans[slot] == MISSING) {
+                uint32_t next = add_state(); // May reallocate; index by slot afterwards
+                trans[slot] = next;
+            }
+            state = trans[slot];
+        }
+        output[state] = static_cast<int32_t>(i);
+    }
+    
+    // Failure links in BFS order; missing edges inherit the failure state's edge
+    std::vector<uint32_t> fail(output.size(), ROOT);
+    std::vector<uint32_t> queue;
+    queue.reserve(output.size());
+    
+    for (size_t cls = 0; cls < alphabet; ++cls) {
+        uint32_t& next = trans[ROOT * alphabet + cls];
+        if (next == MISSING) {
+            next = ROOT;
+        } else {
+            queue.push_back(next);
+        }
+    }
+    
+    for (size_t head = 0; head < queue.size(); ++head) {
+        uint32_t state = queue[head];
+        
+        // Own match is the longest; otherwise report the longest proper suffix match
+        if (output[state] < 0) {
+            output[state] = output[fail[state]];
+        }
+        
+        for (size_t cls = 0; cls < alphabet; ++cls) {
+            uint32_t& next = trans[state * alphabet + cls];
+            uint32_t via_fail = trans[fail[state] * alphabet + cls];
+            if (next == MISSING) {
+                next = via_fail;
+            } else {
+                fail[next] = via_fail;
+                queue.push_back(next);
+            }
+        }
+    }
+    
+    automaton->shortcuts_ = std::move(shortcuts);
+    return automaton;
+}
+
+size_t TriggerAutomaton::memory_bytes() const {
+    size_t bytes = sizeof(*this) +
+                   transitions_.capacity() * sizeof(uint32_t) +
+                   output_.capacity() * sizeof(int32_t);
+    for (const auto& shortcut : shortcuts_) {
+        bytes += sizeof(std::string) + shortcut.capacity();
+    }
+    return bytes;
+}
+
+// TriggerMatcher Implementation
+TriggerMatcher::TriggerMatcher(ShortcutSource source)
+    : source_(std::move(source))
+    , current_(TriggerAutomaton::build({})) {
+    LOG_DEBUG("TriggerMatcher initialized");
+}
+
+TriggerMatcher::~TriggerMatcher() {
+    {
+        std::lock_guard<std::mutex> lock(builder_mutex_);
+        stop_ = true;
+    }
+    builder_cv_.notify_all();
+    
+    if (builder_.joinable()) {
+        builder_.join();
+    }
+}
+
+void TriggerMatcher::request_rebuild(uint64_t generation) {
+    {
+        std::lock_guard<std::mutex> lock(builder_mutex_);
+        requested_generation_ = std::max(requested_generation_, generation);
+        rebuild_pending_ = true;
+        
+        if (!builder_.joinable()) {
+            builder_ = std::thread(&TriggerMatcher::builder_loop, this);
+        }
+    }
+    builder_cv_.notify_one();
+}
+
+void TriggerMatcher::rebuild_now(uint64_t generation) {
+    publish(TriggerAutomaton::build(source_ ? source_() : std::vector<std::string>{}, generation));
+}
+
+void TriggerMatcher::sync(Cursor& cursor) const {
+    uint64_t version = version_.load(std::memory_order_acquire);
+    if (cursor.automaton_ && cursor.version_ == version) {
+        return;
+    }
+    
+    // State ids are only meaningful within one automaton, so start over
+    cursor.automaton_ = std::atomic_load(&current_);
+    cursor.version_ = version;
+    cursor.state_ = TriggerAutomaton::ROOT;
+}
+
+std::shared_ptr<const TriggerAutomaton> TriggerMatcher::snapshot() const {
+    return std::atomic_load(&current_);
+}
+
+uint64_t TriggerMatcher::generation() const {
+    return snapshot()->generation();
+}
+
+void TriggerMatcher::publish(std::shared_ptr<const TriggerAutomaton> automaton) {
+    LOG_DEBUG("Trigger automaton rebuilt: {} shortcuts, {} states, {} bytes",
+              automaton->shortcut_count(), automaton->state_count(), automaton->memory_bytes());
+    std::atomic_store(&current_, std::move(automaton));
+    version_.fetch_add(1, std::memory_order_release);
+}
+
+void TriggerMatcher::builder_loop() {
+    std::unique_lock<std::mutex> lock(builder_mutex_);
+    
+    while (true) {
+        builder_cv_.wait(lock, [this]() { return stop_ || rebuild_pending_; });
+        if (stop_) {
+            return;
+        }
+        
+        uint64_t generation = requested_generation_;
+        rebuild_pending_ = false;
+        
+        // Requests arriving during the build coalesce into the next pass
+        lock.unlock();
+        auto start = std::chrono::steady_clock::now();
+        auto automaton = TriggerAutomaton::build(source_ ? source_() : std::vector<std::string>{}, generation);
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+        publish(std::move(automaton));
+        LOG_DEBUG("Trigger automaton build took {} μs", elapsed.count());
+        lock.lock();
+    }
+}
+
+} // namespace crossexpand
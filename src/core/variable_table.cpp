@@ -0,0 +1,114 @@
+#include "core/variable_table.hpp"
+#include <algorithm>
+
+namespace crossexpand {
+
+// VariableSymbols Implementation
+uint32_t VariableSymbols::intern(const std::string& name) {
+    uint32_t id = find(name);
+    if (id != INVALID_ID) {
+        return id;
+    }
+    
+    // Re-check under the writer lock in case another compile interned it first
+    table_.update([&](Table& table) {
+        auto [it, inserted] = table.ids.emplace(name, static_cast<uint32_t>(table.names.size()));
+        if (inserted) {
+            table.names.push_back(name);
+            size_.store(table.names.size(), std::memory_order_release);
+        }
+        id = it->second;
+        return inserted;
+    });
+    return id;
+}
+
+uint32_t VariableSymbols::find(const std::string& name) const {
+    auto table = table_.read();
+    auto it = table->ids.find(name);
+    return it != table->ids.end() ? it->second : INVALID_ID;
+}
+
+std::string VariableSymbols::name(uint32_t id) const {
+    auto table = table_.read();
+    return id < table->names.size() ? table->names[id] : std::string();
+}
+
+// SlotContext Implementation
+void SlotContext::set(uint32_t id, std::string_view value) {
+    if (id >= values_.size()) {
+        values_.resize(id + 1);
+    }
+    values_[id] = value;
+}
+
+void SlotContext::set_owned(uint32_t id, std::string value) {
+    owned_.push_back(std::make_shared<const std::string>(std::move(value)));
+    set(id, *owned_.back());
+}
+
+void SlotContext::unset(uint32_t id) {
+    if (id < values_.size()) {
+        values_[id].reset();
+    }
+}
+
+void SlotContext::clear() {
+    std::fill(values_.begin(), values_.end(), std::nullopt);
+    owned_.clear();
+}
+
+void SlotContext::reset(const std::vector<uint32_t>& ids) {
+    for (uint32_t id : ids) {
+        unset(id);
+    }
+    owned_.clear();
+    context_ = nullptr;
+}
+
+const Context& SlotContext::context() const {
+    static const Context empty;
+    return context_ ? *context_ : empty;
+}
+
+// ContextChain Implementation
+ContextChain::ContextChain(std::initializer_list<const Context*> layers) {
+    for (const Context* layer : layers) {
+        if (layer) {
+            push(*layer);
+        }
+    }
+}
+
+bool ContextChain::push(const Context& layer) {
+    if (size_ == MAX_LAYERS) {
+        return false;
+    }
+    layers_[size_++] = &layer;
+    return true;
+}
+
+ContextChain ContextChain::with_fallback(const Context& layer) const {
+    ContextChain chain = *this;
+    if (chain.size_ <= MAX_LAYERS) {
+        chain.layers_[chain.size_++] = &layer;
+    }
+    return chain;
+}
+
+std::optional<std::string_view> ContextChain::find(const std::string& name) const {
+    for (size_t i = 0; i < size_; ++i) {
+        auto it = layers_[i]->find(name);
+        if (it != layers_[i]->end()) {
+            return std::string_view(it->second);
+        }
+    }
+    return std::nullopt;
+}
+
+const Context& ContextChain::front() const {
+    static const Context empty;
+    return size_ > 0 ? *layers_[0] : empty;
+}
+
+} // namespace crossexpand
@@ -326,10 +326,14 @@ void WebGUI::handle_api_expand(const HttpRequest& request, HttpResponse& respons
         auto request_data = nlohmann::json::parse(request.body);
         std::string template_text = request_data["template"];
         
+        // The request's map is the caller layer; globals and system variables are
+        // layered under it by the engine instead of being merged in here
         Context context;
-        if (request_data.contains("context")) {
-            for (const auto& [key, value] : request_data["context"].items()) {
-                context[key] = value.get<std::string>();
+        const auto context_data = request_data.find("context");
+        if (context_data != request_data.end()) {
+            context.reserve(context_data->size());
+            for (const auto& [key, value] : context_data->items()) {
+                context.emplace(key, value.get<std::string>());
             }
         }
         
@@ -350,7 +354,7 @@ void WebGUI::handle_api_expand(const HttpRequest& request, HttpResponse& respons
         response_data["success"] = true;
         response_data["result"] = result;
         response_data["template"] = template_text;
-        response_data["context"] = context;
+        response_data["context"] = context_data != request_data.end() ? *context_data : nlohmann::json::object();
         
         response.set_json_content(response_data.dump());
     } catch (const std::exception& e) {
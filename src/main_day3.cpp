@@ -75,17 +75,23 @@ bool initialize_core_systems() {
         LOG_WARNING("⚠️ Text injector initialization failed (X11 not available?)");
     }
     
-    // Add some sample templates
-    g_advanced_template_engine->add_advanced_template("greeting", "Hello {name}, welcome to CrossExpand Day 3!");
-    g_advanced_template_engine->add_advanced_template("email_signature", 
-        "Best regards,\n{user()}\n{company}\nEmail: {email}\nPhone: {phone}");
-    g_advanced_template_engine->add_advanced_template("current_datetime", 
-        "Current date and time: {date()} at {time()}");
-    g_advanced_template_engine->add_advanced_template("code_comment", 
-        "// Created by {user()} on {date()}\n// {description}");
+    // Add some sample templates, reusing the images precompiled by the previous run
+    const std::string store_path = ConfigManager().GetTemplateStorePath();
+    bool store_current = g_advanced_template_engine->attach_template_store(store_path);
+    g_advanced_template_engine->add_advanced_templates({
+        {"greeting", "Hello {name}, welcome to CrossExpand Day 3!"},
+        {"email_signature", "Best regards,\n{user()}\n{company}\nEmail: {email}\nPhone: {phone}"},
+        {"current_datetime", "Current date and time: {date()} at {time()}"},
+        {"code_comment", "// Created by {user()} on {date()}\n// {description}"},
+    });
     
     LOG_INFO("✅ Sample templates loaded");
     
+    if (!store_current || monitor.counter("template_store_misses").get() > 0) {
+        std::filesystem::create_directories(std::filesystem::path(store_path).parent_path());
+        g_advanced_template_engine->save_template_store(store_path);
+    }
+    
     return true;
 }
 
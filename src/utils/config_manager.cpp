@@ -1,4 +1,5 @@
 #include "utils/config_manager.hpp"
+#include <cstdio>
 #include <fstream>
 #include <filesystem>
 #include <pwd.h>
@@ -6,32 +7,300 @@
 
 namespace crossexpand {
 
+namespace {
+
+// Sections of a config file collected while parsing, committed only if the parse succeeds
+struct LoadedConfig {
+    bool has_templates = false;
+    bool has_variables = false;
+    std::unordered_map<std::string, std::string> variables;
+    AppSettings settings;
+};
+
+// SAX handler for both file layouts. Templates are handed to the sink as soon as their
+// object closes, with strings moved out of the parser, so memory stays proportional to
+// the largest single template rather than the file.
+class ConfigSaxHandler : public nlohmann::json_sax<nlohmann::json> {
+public:
+    enum class Mode {
+        CONFIG,  // {"templates": {...}, "variables": {...}, "settings": {...}}
+        RECORD   // One {"shortcut": ..., "text": ...} object (a template line)
+    };
+    
+    ConfigSaxHandler(Mode mode, const ConfigManager::TemplateSink& sink, LoadedConfig& loaded)
+        : mode_(mode), sink_(sink), loaded_(loaded) {}
+    
+    const std::string& error() const { return error_; }
+    bool stopped() const { return stopped_; }
+    
+    bool null() override { return scalar(nullptr, 0, false); }
+    bool boolean(bool value) override { return scalar(nullptr, value ? 1 : 0, true); }
+    bool number_integer(number_integer_t value) override { return scalar(nullptr, value, true); }
+    bool number_unsigned(number_unsigned_t value) override {
+        return scalar(nullptr, static_cast<int64_t>(value), true);
+    }
+    bool number_float(number_float_t value, const string_t&) override {
+        return scalar(nullptr, static_cast<int64_t>(value), true);
+    }
+    bool string(string_t& value) override { return scalar(&value, 0, false); }
+    bool binary(binary_t&) override { return scalar(nullptr, 0, false); }
+    
+    bool key(string_t& value) override {
+        if (depth_ == 1) {
+            (mode_ == Mode::CONFIG ? section_ : field_) = value;
+        } else if (mode_ == Mode::CONFIG && depth_ == 2) {
+            (section_ == "templates" ? shortcut_ : field_) = std::move(value);
+        } else if (mode_ == Mode::CONFIG && depth_ == 3) {
+            field_ = value;
+        }
+        return true;
+    }
+    
+    bool start_object(std::size_t) override {
+        ++depth_;
+        if (depth_ == 1) {
+            return true;
+        }
+        if (mode_ == Mode::CONFIG && depth_ == 2) {
+            loaded_.has_templates |= section_ == "templates";
+            loaded_.has_variables |= section_ == "variables";
+        } else if (in_template_object()) {
+            current_ = Template();
+        }
+        return true;
+    }
+    
+    bool end_object() override {
+        bool ok = true;
+        if (in_template_object()) {
+            ok = emit(mode_ == Mode::CONFIG ? std::move(shortcut_) : std::move(record_shortcut_));
+        }
+        --depth_;
+        return ok;
+    }
+    
+    bool start_array(std::size_t) override {
+        if (depth_ == 0) {
+            return fail("expected an object");
+        }
+        if (mode_ == Mode::CONFIG && depth_ == 2 && section_ == "templates") {
+            return fail("template '" + shortcut_ + "' must be a string or an object");
+        }
+        ++depth_;
+        return true;
+    }
+    
+    bool end_array() override {
+        --depth_;
+        return true;
+    }
+    
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& e) override {
+        return fail(e.what());
+    }
+
+private:
+    Mode mode_;
+    const ConfigManager::TemplateSink& sink_;
+    LoadedConfig& loaded_;
+    size_t depth_ = 0;
+    std::string section_;
+    std::string shortcut_;
+    std::string field_;
+    std::string record_shortcut_;
+    Template current_;
+    std::string error_;
+    bool stopped_ = false;
+    
+    // Depth of the object holding one template's fields
+    bool in_template_object() const {
+        return mode_ == Mode::RECORD ? depth_ == 1 : depth_ == 3 && section_ == "templates";
+    }
+    
+    bool fail(const std::string& reason) {
+        if (error_.empty()) {
+            error_ = reason;
+        }
+        return false;
+    }
+    
+    bool emit(std::string shortcut) {
+        if (shortcut.empty()) {
+            return fail("template without a shortcut");
+        }
+        if (!sink_(std::move(shortcut), std::move(current_))) {
+            stopped_ = true;
+            return false;
+        }
+        return true;
+    }
+    
+    // text is set for strings; number carries integers and booleans when is_number is set
+    bool scalar(string_t* text, int64_t number, bool is_number) {
+        if (depth_ == 0) {
+            return fail("expected an object");
+        }
+        
+        // Template fields: depth 1 of a record, depth 3 under "templates"
+        const size_t field_depth = mode_ == Mode::RECORD ? 1 : 3;
+        const bool in_templates = mode_ == Mode::RECORD || section_ == "templates";
+        if (in_templates && depth_ == field_depth) {
+            if (field_ == "variables" || (!text && (field_ == "text" || field_ == "shortcut"))) {
+                return fail("template field '" + field_ + "' has the wrong type");
+            }
+            if (!text) return true;
+            if (field_ == "text") current_.text = std::move(*text);
+            else if (field_ == "description") current_.description = std::move(*text);
+            else if (field_ == "shortcut" && mode_ == Mode::RECORD) record_shortcut_ = std::move(*text);
+            return true;
+        }
+        if (in_templates && depth_ == field_depth + 1 && field_ == "variables") {
+            if (!text) return fail("template variables must be strings");
+            current_.variables.push_back(std::move(*text));
+            return true;
+        }
+        if (mode_ == Mode::RECORD || depth_ != 2) {
+            return true;  // Unknown fields are ignored
+        }
+        
+        if (section_ == "templates") {
+            // "shortcut": "text" shorthand
+            if (!text) return fail("template '" + shortcut_ + "' must be a string or an object");
+            current_ = Template(std::move(*text));
+            return emit(std::move(shortcut_));
+        }
+        if (section_ == "variables") {
+            if (!text) return fail("variable '" + field_ + "' must be a string");
+            loaded_.variables[field_] = std::move(*text);
+            return true;
+        }
+        if (section_ == "settings") {
+            AppSettings& settings = loaded_.settings;
+            if (field_ == "log_file") {
+                if (!text) return fail("setting 'log_file' must be a string");
+                settings.log_file = std::move(*text);
+            } else if (field_ == "expansion_delay_ms" || field_ == "max_template_length" ||
+                       field_ == "enable_logging" || field_ == "log_level") {
+                if (!is_number) return fail("setting '" + field_ + "' must be a number or boolean");
+                if (field_ == "expansion_delay_ms") settings.expansion_delay_ms = static_cast<int>(number);
+                else if (field_ == "max_template_length") settings.max_template_length = static_cast<int>(number);
+                else if (field_ == "enable_logging") settings.enable_logging = number != 0;
+                else settings.log_level = static_cast<LogLevel>(number);
+            }
+        }
+        return true;
+    }
+};
+
+bool ends_with(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Parse path into sink and loaded; false (after logging) on I/O or format errors
+bool parse_config_file(const std::string& path, const ConfigManager::TemplateSink& sink, LoadedConfig& loaded) {
+    if (!ConfigManager::IsTemplateLinesFile(path)) {
+        // FILE* input reads through stdio's buffer, much faster than an istream adapter
+        std::unique_ptr<std::FILE, int (*)(std::FILE*)> file(std::fopen(path.c_str(), "rb"), &std::fclose);
+        if (!file) {
+            LOG_ERROR("Failed to open config file: {}", path);
+            return false;
+        }
+        ConfigSaxHandler handler(ConfigSaxHandler::Mode::CONFIG, sink, loaded);
+        if (nlohmann::json::sax_parse(file.get(), &handler) || handler.stopped()) {
+            return true;
+        }
+        LOG_ERROR("Failed to parse config file {}: {}", path, handler.error());
+        return false;
+    }
+    
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        LOG_ERROR("Failed to open template file: {}", path);
+        return false;
+    }
+    
+    // One record per line; blank lines are skipped
+    loaded.has_templates = true;
+    std::string line;
+    for (size_t number = 1; std::getline(file, line); ++number) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+        ConfigSaxHandler handler(ConfigSaxHandler::Mode::RECORD, sink, loaded);
+        if (!nlohmann::json::sax_parse(line, &handler)) {
+            if (handler.stopped()) {
+                return true;
+            }
+            LOG_ERROR("Failed to parse {} line {}: {}", path, number, handler.error());
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
 ConfigManager::ConfigManager() {
     CreateDefaultConfig();
 }
 
+bool ConfigManager::IsTemplateLinesFile(const std::string& path) {
+    return ends_with(path, ".ndjson") || ends_with(path, ".jsonl");
+}
+
 bool ConfigManager::LoadConfig(const std::string& config_path) {
     std::string path = config_path.empty() ? GetDefaultConfigPath() : config_path;
     
-    std::ifstream file(path);
-    if (!file.is_open()) {
+    if (!std::filesystem::exists(path)) {
         LOG_WARNING("Config file not found: {}, creating default", path);
         return SaveConfig(path);
     }
     
-    try {
-        nlohmann::json json;
-        file >> json;
-        
-        if (DeserializeFromJson(json)) {
-            LOG_INFO("Configuration loaded from: {}", path);
-            return true;
-        }
-    } catch (const std::exception& e) {
-        LOG_ERROR("Failed to parse config file: {}", e.what());
+    // Build the new template map in place; the current one is kept if parsing fails
+    std::unordered_map<std::string, Template> templates;
+    LoadedConfig loaded;
+    loaded.settings = settings_;
+    bool ok = parse_config_file(path, [&templates](std::string shortcut, Template tmpl) {
+        templates[std::move(shortcut)] = std::move(tmpl);
+        return true;
+    }, loaded);
+    if (!ok) {
+        return false;
     }
     
-    return false;
+    if (loaded.has_templates) {
+        templates_ = std::move(templates);
+    }
+    if (loaded.has_variables) {
+        variables_ = std::move(loaded.variables);
+    }
+    settings_ = loaded.settings;
+    LOG_INFO("Configuration loaded from: {} ({} templates)", path, templates_.size());
+    return true;
+}
+
+bool ConfigManager::LoadTemplates(const std::string& path, const TemplateSink& sink) {
+    LoadedConfig loaded;
+    return parse_config_file(path, sink, loaded);
+}
+
+size_t ConfigManager::LoadTemplatesInto(const std::string& path, TemplateEngine& engine) {
+    std::vector<std::pair<std::string, Template>> batch;
+    batch.reserve(LOAD_BATCH);
+    size_t added = 0;
+    bool ok = LoadTemplates(path, [&](std::string shortcut, Template tmpl) {
+        batch.emplace_back(std::move(shortcut), std::move(tmpl));
+        if (batch.size() == LOAD_BATCH) {
+            added += engine.AddTemplates(std::move(batch));
+        }
+        return true;
+    });
+    if (ok) {
+        added += engine.AddTemplates(std::move(batch));
+    } else {
+        LOG_ERROR("Stopped loading {} after {} templates", path, added);
+    }
+    return added;
 }
 
 bool ConfigManager::SaveConfig(const std::string& config_path) {
@@ -41,6 +310,10 @@ bool ConfigManager::SaveConfig(const std::string& config_path) {
     std::filesystem::path file_path(path);
     std::filesystem::create_directories(file_path.parent_path());
     
+    if (IsTemplateLinesFile(path)) {
+        return SaveTemplateLines(path);
+    }
+    
     std::ofstream file(path);
     if (!file.is_open()) {
         LOG_ERROR("Failed to open config file for writing: {}", path);
@@ -58,6 +331,34 @@ bool ConfigManager::SaveConfig(const std::string& config_path) {
     }
 }
 
+bool ConfigManager::SaveTemplateLines(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        LOG_ERROR("Failed to open template file for writing: {}", path);
+        return false;
+    }
+    
+    try {
+        for (const auto& [shortcut, tmpl] : templates_) {
+            nlohmann::json record;
+            record["shortcut"] = shortcut;
+            record["text"] = tmpl.text;
+            if (!tmpl.description.empty()) {
+                record["description"] = tmpl.description;
+            }
+            if (!tmpl.variables.empty()) {
+                record["variables"] = tmpl.variables;
+            }
+            file << record.dump() << '\n';
+        }
+        LOG_INFO("Templates saved to: {}", path);
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Failed to save template file: {}", e.what());
+        return false;
+    }
+}
+
 const std::unordered_map<std::string, Template>& ConfigManager::GetTemplates() const {
     return templates_;
 }
@@ -66,6 +367,10 @@ void ConfigManager::SetTemplates(const std::unordered_map<std::string, Template>
     templates_ = templates;
 }
 
+void ConfigManager::SetTemplates(std::unordered_map<std::string, Template>&& templates) {
+    templates_ = std::move(templates);
+}
+
 const std::unordered_map<std::string, std::string>& ConfigManager::GetVariables() const {
     return variables_;
 }
@@ -92,6 +397,10 @@ std::string ConfigManager::GetDefaultConfigPath() const {
     return std::string(home) + "/.config/crossexpand/config.json";
 }
 
+std::string ConfigManager::GetTemplateStorePath() const {
+    return std::filesystem::path(GetDefaultConfigPath()).replace_filename("templates.store").string();
+}
+
 void ConfigManager::CreateDefaultConfig() {
     // Default templates
     templates_["/hello"] = Template("Hello, World!");
@@ -150,54 +459,4 @@ nlohmann::json ConfigManager::SerializeToJson() const {
     return json;
 }
 
-bool ConfigManager::DeserializeFromJson(const nlohmann::json& json) {
-    try {
-        // Templates
-        if (json.contains("templates")) {
-            templates_.clear();
-            for (const auto& [shortcut, tmpl_json] : json["templates"].items()) {
-                Template tmpl;
-                tmpl.text = tmpl_json["text"];
-                if (tmpl_json.contains("description")) {
-                    tmpl.description = tmpl_json["description"];
-                }
-                if (tmpl_json.contains("variables")) {
-                    tmpl.variables = tmpl_json["variables"];
-                }
-                templates_[shortcut] = tmpl;
-            }
-        }
-        
-        // Variables
-        if (json.contains("variables")) {
-            variables_ = json["variables"];
-        }
-        
-        // Settings
-        if (json.contains("settings")) {
-            const auto& settings_json = json["settings"];
-            if (settings_json.contains("expansion_delay_ms")) {
-                settings_.expansion_delay_ms = settings_json["expansion_delay_ms"];
-            }
-            if (settings_json.contains("max_template_length")) {
-                settings_.max_template_length = settings_json["max_template_length"];
-            }
-            if (settings_json.contains("enable_logging")) {
-                settings_.enable_logging = settings_json["enable_logging"];
-            }
-            if (settings_json.contains("log_level")) {
-                settings_.log_level = static_cast<LogLevel>(settings_json["log_level"].get<int>());
-            }
-            if (settings_json.contains("log_file")) {
-                settings_.log_file = settings_json["log_file"];
-            }
-        }
-        
-        return true;
-    } catch (const std::exception& e) {
-        LOG_ERROR("Failed to deserialize config: {}", e.what());
-        return false;
-    }
-}
-
 } // namespace crossexpand
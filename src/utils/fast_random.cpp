@@ -0,0 +1,165 @@
+#include "utils/fast_random.hpp"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <utility>
+#include <sys/random.h>
+
+namespace crossexpand {
+
+namespace {
+
+uint64_t splitmix64(uint64_t& x) {
+    uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+// Fill buffer from the kernel CSPRNG; false if getrandom() is unavailable
+bool fill_entropy(unsigned char* buffer, size_t size) {
+    while (size > 0) {
+        ssize_t n = getrandom(buffer, size, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        buffer += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Last-resort seed when getrandom() fails: distinct per thread and per start
+uint64_t fallback_seed() {
+    uint64_t seed = static_cast<uint64_t>(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+    return seed ^ (std::hash<std::thread::id>{}(std::this_thread::get_id()) << 1);
+}
+
+struct EntropyPool {
+    unsigned char bytes[ThreadRandom::ENTROPY_BUFFER];
+    size_t used = ThreadRandom::ENTROPY_BUFFER;  // Empty until first use
+    
+    const unsigned char* take(size_t count) {
+        if (used + count > sizeof(bytes)) {
+            if (!fill_entropy(bytes, sizeof(bytes))) {
+                // No kernel entropy: the generator still gives unique-looking UUIDs
+                Xoshiro256& generator = ThreadRandom::generator();
+                for (size_t i = 0; i < sizeof(bytes); i += sizeof(uint64_t)) {
+                    uint64_t value = generator.next();
+                    std::memcpy(bytes + i, &value, sizeof(value));
+                }
+            }
+            used = 0;
+        }
+        const unsigned char* result = bytes + used;
+        used += count;
+        return result;
+    }
+};
+
+constexpr char HEX_DIGITS[] = "0123456789abcdef";
+
+// Two hex digits per byte, looked up instead of formatted
+struct HexTable {
+    char pairs[256][2];
+    
+    HexTable() {
+        for (int i = 0; i < 256; ++i) {
+            pairs[i][0] = HEX_DIGITS[i >> 4];
+            pairs[i][1] = HEX_DIGITS[i & 0x0f];
+        }
+    }
+};
+
+const HexTable HEX;
+
+} // namespace
+
+Xoshiro256::Xoshiro256(uint64_t seed) {
+    for (uint64_t& word : state_) {
+        word = splitmix64(seed);
+    }
+}
+
+Xoshiro256::Xoshiro256(uint64_t s0, uint64_t s1, uint64_t s2, uint64_t s3) : state_{s0, s1, s2, s3} {
+    if ((s0 | s1 | s2 | s3) == 0) {
+        *this = Xoshiro256(0);  // All-zero state would only ever produce zeros
+    }
+}
+
+uint64_t Xoshiro256::next() {
+    const uint64_t result = rotl(state_[1] * 5, 7) * 9;
+    const uint64_t t = state_[1] << 17;
+    state_[2] ^= state_[0];
+    state_[3] ^= state_[1];
+    state_[1] ^= state_[2];
+    state_[0] ^= state_[3];
+    state_[2] ^= t;
+    state_[3] = rotl(state_[3], 45);
+    return result;
+}
+
+int64_t Xoshiro256::uniform(int64_t min, int64_t max) {
+    if (max < min) {
+        std::swap(min, max);
+    }
+    const uint64_t span = static_cast<uint64_t>(max) - static_cast<uint64_t>(min);
+    if (span == UINT64_MAX) {
+        return static_cast<int64_t>(next());
+    }
+    
+    // Lemire's multiply-shift; rejects the few low products that would bias the result
+    const uint64_t range = span + 1;
+    unsigned __int128 product = static_cast<unsigned __int128>(next()) * range;
+    uint64_t low = static_cast<uint64_t>(product);
+    if (low < range) {
+        const uint64_t threshold = (0 - range) % range;
+        while (low < threshold) {
+            product = static_cast<unsigned __int128>(next()) * range;
+            low = static_cast<uint64_t>(product);
+        }
+    }
+    return static_cast<int64_t>(static_cast<uint64_t>(min) + static_cast<uint64_t>(product >> 64));
+}
+
+Xoshiro256& ThreadRandom::generator() {
+    thread_local Xoshiro256 generator = [] {
+        uint64_t seed[4];
+        if (!fill_entropy(reinterpret_cast<unsigned char*>(seed), sizeof(seed))) {
+            return Xoshiro256(fallback_seed());
+        }
+        return Xoshiro256(seed[0], seed[1], seed[2], seed[3]);
+    }();
+    return generator;
+}
+
+void ThreadRandom::uuid_v4(char* out) {
+    thread_local EntropyPool pool;
+    unsigned char bytes[16];
+    std::memcpy(bytes, pool.take(sizeof(bytes)), sizeof(bytes));
+    bytes[6] = static_cast<unsigned char>((bytes[6] & 0x0f) | 0x40);  // Version 4
+    bytes[8] = static_cast<unsigned char>((bytes[8] & 0x3f) | 0x80);  // RFC 4122 variant
+    
+    for (int i = 0; i < 16; ++i) {
+        if (i == 4 || i == 6 || i == 8 || i == 10) {
+            *out++ = '-';
+        }
+        *out++ = HEX.pairs[bytes[i]][0];
+        *out++ = HEX.pairs[bytes[i]][1];
+    }
+}
+
+std::string ThreadRandom::uuid_v4() {
+    std::string uuid(36, '\0');
+    uuid_v4(uuid.data());
+    return uuid;
+}
+
+} // namespace crossexpand
@@ -1,6 +1,6 @@
 #include "utils/logger.hpp"
+#include "utils/time_formatter.hpp"
 #include <chrono>
-#include <iomanip>
 
 namespace crossexpand {
 
@@ -34,11 +34,15 @@ std::string Logger::GetTimestamp() {
     auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
         now.time_since_epoch()) % 1000;
     
-    std::ostringstream oss;
-    oss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
-    oss << '.' << std::setfill('0') << std::setw(3) << ms.count();
+    // Seconds part is formatted once per second per thread
+    std::string timestamp = LocalClock::format(time_t, "%Y-%m-%d %H:%M:%S");
+    int millis = static_cast<int>(ms.count());
+    timestamp += '.';
+    timestamp += static_cast<char>('0' + millis / 100);
+    timestamp += static_cast<char>('0' + millis / 10 % 10);
+    timestamp += static_cast<char>('0' + millis % 10);
     
-    return oss.str();
+    return timestamp;
 }
 
 std::string Logger::GetLevelString(LogLevel level) {
@@ -0,0 +1,232 @@
+#include "utils/time_formatter.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace crossexpand {
+
+namespace {
+
+const char* const WEEKDAY_NAMES[] = {"Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"};
+const char* const MONTH_NAMES[] = {"January", "February", "March", "April", "May", "June",
+                                   "July", "August", "September", "October", "November", "December"};
+
+// Composite conversions, spelled out so their parts take the direct path
+std::string expand_composites(std::string_view format) {
+    std::string expanded;
+    expanded.reserve(format.size());
+    for (size_t i = 0; i < format.size(); ++i) {
+        if (format[i] != '%' || i + 1 >= format.size()) {
+            expanded += format[i];
+            continue;
+        }
+        switch (format[i + 1]) {
+            case 'F': expanded += "%Y-%m-%d"; break;
+            case 'T': expanded += "%H:%M:%S"; break;
+            case 'R': expanded += "%H:%M"; break;
+            case 'D': expanded += "%m/%d/%y"; break;
+            default: expanded.append(format.data() + i, 2); break;  // Includes "%%"
+        }
+        i++;
+    }
+    return expanded;
+}
+
+// Decimal of at least width digits, padded with pad
+void append_number(std::string& out, int value, int width, char pad = '0') {
+    if (value < 0) {
+        out += '-';
+        value = -value;
+    }
+    char digits[12];
+    int count = 0;
+    do {
+        digits[count++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    for (int i = count; i < width; ++i) {
+        out += pad;
+    }
+    while (count > 0) {
+        out += digits[--count];
+    }
+}
+
+void append_name(std::string& out, const char* const* names, int index, int count, bool abbreviated) {
+    if (index < 0 || index >= count) {
+        out += '?';
+        return;
+    }
+    out.append(names[index], abbreviated ? 3 : std::strlen(names[index]));
+}
+
+} // namespace
+
+TimeFormatter::TimeFormatter(std::string_view format) : pattern_(format), expanded_(expand_composites(format)) {
+    size_t literal_start = 0;
+    size_t pos = 0;
+    while ((pos = expanded_.find('%', pos)) != std::string::npos) {
+        // Flags, widths and E/O modifiers precede the conversion letter
+        size_t end = pos + 1;
+        while (end < expanded_.size() && expanded_[end] != '\0' && std::strchr("-_0^#EO123456789", expanded_[end])) {
+            end++;
+        }
+        if (end >= expanded_.size()) {
+            break;  // Incomplete conversion: kept as text, like strftime
+        }
+        
+        add_literal(literal_start, pos - literal_start);
+        Field field = Field::STRFTIME;
+        if (end == pos + 1) {
+            switch (expanded_[end]) {
+                case 'Y': field = Field::YEAR; break;
+                case 'y': field = Field::YEAR_SHORT; break;
+                case 'C': field = Field::CENTURY; break;
+                case 'm': field = Field::MONTH; break;
+                case 'd': field = Field::DAY; break;
+                case 'e': field = Field::DAY_SPACE; break;
+                case 'j': field = Field::DAY_OF_YEAR; break;
+                case 'H': field = Field::HOUR; break;
+                case 'I': field = Field::HOUR_12; break;
+                case 'M': field = Field::MINUTE; break;
+                case 'S': field = Field::SECOND; break;
+                case 'p': field = Field::AM_PM; break;
+                case 'w': field = Field::WEEKDAY; break;
+                case 'u': field = Field::WEEKDAY_ISO; break;
+                case 'a': field = Field::WEEKDAY_SHORT; break;
+                case 'A': field = Field::WEEKDAY_LONG; break;
+                case 'b':
+                case 'h': field = Field::MONTH_SHORT; break;
+                case 'B': field = Field::MONTH_LONG; break;
+                case '%': field = Field::LITERAL; break;
+                default: break;
+            }
+        }
+        
+        if (field == Field::LITERAL) {
+            add_literal(end, 1);
+        } else {
+            steps_.push_back({field, static_cast<uint32_t>(pos), static_cast<uint32_t>(end + 1 - pos)});
+        }
+        pos = end + 1;
+        literal_start = pos;
+    }
+    add_literal(literal_start, expanded_.size() - literal_start);
+}
+
+void TimeFormatter::add_literal(size_t offset, size_t length) {
+    if (length == 0) return;
+    
+    // "%%" splits text into adjacent spans; keep them as one step
+    if (!steps_.empty() && steps_.back().field == Field::LITERAL &&
+        steps_.back().offset + steps_.back().length == offset) {
+        steps_.back().length += static_cast<uint32_t>(length);
+        return;
+    }
+    steps_.push_back({Field::LITERAL, static_cast<uint32_t>(offset), static_cast<uint32_t>(length)});
+}
+
+void TimeFormatter::format_to(std::string& out, const std::tm& tm) const {
+    const int year = tm.tm_year + 1900;
+    for (const Step& step : steps_) {
+        switch (step.field) {
+            case Field::LITERAL: out.append(expanded_, step.offset, step.length); break;
+            case Field::YEAR: append_number(out, year, 4); break;
+            case Field::YEAR_SHORT: append_number(out, (year % 100 + 100) % 100, 2); break;
+            case Field::CENTURY: append_number(out, year / 100, 2); break;
+            case Field::MONTH: append_number(out, tm.tm_mon + 1, 2); break;
+            case Field::DAY: append_number(out, tm.tm_mday, 2); break;
+            case Field::DAY_SPACE: append_number(out, tm.tm_mday, 2, ' '); break;
+            case Field::DAY_OF_YEAR: append_number(out, tm.tm_yday + 1, 3); break;
+            case Field::HOUR: append_number(out, tm.tm_hour, 2); break;
+            case Field::HOUR_12: append_number(out, (tm.tm_hour + 11) % 12 + 1, 2); break;
+            case Field::MINUTE: append_number(out, tm.tm_min, 2); break;
+            case Field::SECOND: append_number(out, tm.tm_sec, 2); break;
+            case Field::AM_PM: out += tm.tm_hour < 12 ? "AM" : "PM"; break;
+            case Field::WEEKDAY: append_number(out, tm.tm_wday, 1); break;
+            case Field::WEEKDAY_ISO: append_number(out, tm.tm_wday == 0 ? 7 : tm.tm_wday, 1); break;
+            case Field::WEEKDAY_SHORT: append_name(out, WEEKDAY_NAMES, tm.tm_wday, 7, true); break;
+            case Field::WEEKDAY_LONG: append_name(out, WEEKDAY_NAMES, tm.tm_wday, 7, false); break;
+            case Field::MONTH_SHORT: append_name(out, MONTH_NAMES, tm.tm_mon, 12, true); break;
+            case Field::MONTH_LONG: append_name(out, MONTH_NAMES, tm.tm_mon, 12, false); break;
+            case Field::STRFTIME: {
+                char conversion[16];
+                char buffer[128];
+                size_t length = std::min<size_t>(step.length, sizeof(conversion) - 1);
+                std::memcpy(conversion, expanded_.data() + step.offset, length);
+                conversion[length] = '\0';
+                out.append(buffer, std::strftime(buffer, sizeof(buffer), conversion, &tm));
+                break;
+            }
+        }
+    }
+}
+
+std::string TimeFormatter::format(const std::tm& tm) const {
+    std::string out;
+    out.reserve(expanded_.size() + 16);
+    format_to(out, tm);
+    return out;
+}
+
+namespace {
+
+struct CachedFormat {
+    TimeFormatter formatter;
+    std::time_t second;
+    std::string text;  // formatter output for second
+};
+
+struct ThreadClock {
+    std::time_t second = -1;
+    std::tm tm{};
+    std::vector<CachedFormat> formats;  // Oldest first
+};
+
+ThreadClock& thread_clock() {
+    thread_local ThreadClock clock;
+    return clock;
+}
+
+} // namespace
+
+const std::tm& LocalClock::local_time(std::time_t second) {
+    ThreadClock& clock = thread_clock();
+    if (second != clock.second) {
+        // Once per second per thread: pick up TZ changes like localtime() did
+        tzset();
+        localtime_r(&second, &clock.tm);
+        clock.second = second;
+    }
+    return clock.tm;
+}
+
+std::string LocalClock::format_now(std::string_view format) {
+    return LocalClock::format(std::time(nullptr), format);
+}
+
+std::string LocalClock::format(std::time_t second, std::string_view format) {
+    ThreadClock& clock = thread_clock();
+    CachedFormat* entry = nullptr;
+    for (auto& cached : clock.formats) {
+        if (cached.formatter.pattern() == format) {
+            entry = &cached;
+            break;
+        }
+    }
+    if (!entry) {
+        if (clock.formats.size() == MAX_CACHED_FORMATS) {
+            clock.formats.erase(clock.formats.begin());
+        }
+        clock.formats.push_back({TimeFormatter(format), -1, {}});
+        entry = &clock.formats.back();
+    }
+    
+    if (entry->second != second) {
+        entry->text.clear();
+        entry->formatter.format_to(entry->text, local_time(second));
+        entry->second = second;
+    }
+    return entry->text;
+}
+
+} // namespace crossexpand
@@ -1,7 +1,22 @@
 #include <iostream>
 #include <cassert>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <unordered_set>
 #include "core/template_engine.hpp"
+#include "core/advanced_template_engine.hpp"
+#include "core/template_store.hpp"
+#include "core/trigger_matcher.hpp"
+#include "core/keystroke_expander.hpp"
+#include "core/event_queue.hpp"
+#include "core/enhanced_text_injector.hpp"
 #include "utils/config_manager.hpp"
+#include "utils/performance_monitor.hpp"
+#include "utils/time_formatter.hpp"
+#include "utils/fast_random.hpp"
 
 using namespace crossexpand;
 
@@ -24,9 +39,1293 @@ void TestTemplateEngine() {
     Context ctx{{"name", "Alice"}};
     assert(engine.Expand("/greet", ctx) == "Hello, Alice!");
     
+    // Unknown variables are kept verbatim, "{}" is literal
+    engine.AddTemplate("/partial", Template("{name} and {missing} {}"));
+    assert(engine.Expand("/partial") == "John and {missing} {}");
+    
+    // Adjacent placeholders and substituted values are not rescanned
+    Context braces{{"a", "{b}"}, {"b", "B"}};
+    engine.AddTemplate("/adjacent", Template("{a}{b}"));
+    assert(engine.Expand("/adjacent", braces) == "{b}B");
+    
+    // Includes are inlined at add time and relinked when an included template changes
+    bool added = engine.AddTemplate("/sig", Template("-- {name}"));
+    assert(added);
+    added = engine.AddTemplate("/mail", Template("Hi {to},\n{/body}\n{/sig}"));
+    assert(added);
+    assert(engine.Expand("/mail", {{"to", "Bob"}}) == "Hi Bob,\n{/body}\n-- John");
+    added = engine.AddTemplate("/body", Template("See {/sig}"));
+    assert(added);
+    assert(engine.Expand("/mail", {{"to", "Bob"}}) == "Hi Bob,\nSee -- John\n-- John");
+    added = engine.AddTemplate("/sig", Template("Regards"));
+    assert(added);
+    assert(engine.Expand("/mail", {{"to", "Bob"}}) == "Hi Bob,\nSee Regards\nRegards");
+    assert(engine.GetDependents("/sig").size() == 2);
+    
+    // Cycles are rejected up front and leave the previous definition in place
+    added = engine.AddTemplate("/sig", Template("{/mail}"));
+    assert(!added);
+    added = engine.AddTemplate("/self", Template("{/self}"));
+    assert(!added);
+    assert(!engine.HasTemplate("/self"));
+    assert(engine.Expand("/sig") == "Regards");
+    
+    bool removed = engine.RemoveTemplate("/body");
+    assert(removed);
+    assert(engine.Expand("/mail", {{"to", "Bob"}}) == "Hi Bob,\n{/body}\nRegards");
+    
     std::cout << "TemplateEngine tests passed!" << std::endl;
 }
 
+void TestAdvancedTemplateEngine() {
+    std::cout << "Testing AdvancedTemplateEngine..." << std::endl;
+    
+    AdvancedTemplateEngine engine;
+    
+    // Variables and literals
+    bool added = engine.add_advanced_template("/greet", "Hello {{name}}, {{missing}}!");
+    assert(added);
+    assert(engine.expand_advanced("/greet", {{"name", "Alice"}}) == "Hello Alice, {missing}!");
+    
+    // Nested conditionals
+    added = engine.add_advanced_template("/cond",
+        "A{%if premium%}B{%if vip%}C{%endif%}D{%endif%}E");
+    assert(added);
+    assert(engine.expand_advanced("/cond", {{"premium", "true"}, {"vip", "1"}}) == "ABCDE");
+    assert(engine.expand_advanced("/cond", {{"premium", "true"}, {"vip", "0"}}) == "ABDE");
+    assert(engine.expand_advanced("/cond", {{"premium", "false"}, {"vip", "1"}}) == "AE");
+    
+    // Condition expressions: comparisons (numeric when both sides are numbers), logic, literals
+    added = engine.add_advanced_template("/expr",
+        "{% if tier == 'gold' and not (age < 18) %}G{%endif%}{%if count > 9 or name != \"x\"%}C{%endif%}");
+    assert(added);
+    assert(engine.expand_advanced("/expr", {{"tier", "gold"}, {"age", "30"}, {"count", "10"}, {"name", "x"}}) == "GC");
+    assert(engine.expand_advanced("/expr", {{"tier", "gold"}, {"age", "9"}, {"count", "9"}, {"name", "x"}}) == "");
+    assert(engine.expand_advanced("/expr", {{"tier", "silver"}, {"name", "y"}}) == "C");
+    added = engine.add_advanced_template("/loopcond", "{%for n in ns%}{%if n > 2%}{{n}}{%endif%}{%endfor%}");
+    assert(added);
+    assert(engine.expand_advanced("/loopcond", {{"ns", "1\n3\n10"}}) == "310");
+    added = engine.add_advanced_template("/badcond", "{%if a ==%}x{%endif%}");
+    assert(!added);
+    added = engine.add_advanced_template("/nocond", "{%if%}x{%endif%}");
+    assert(!added);
+    added = engine.add_advanced_template("/blankcond", "{% if   %}x{%endif%}");
+    assert(!added);
+    
+    // System variables are resolved only when referenced
+    added = engine.add_advanced_template("/who", "{{username}}@{{hostname}}");
+    assert(added);
+    assert(engine.expand_advanced("/who").find('{') == std::string::npos);
+    assert(SystemVariables::find_provider("current_date") != nullptr);
+    assert(SystemVariables::find_provider("name") == nullptr);
+    
+    // Deterministic providers are resolved once and bound by view
+    const SystemVariableProvider* host = SystemVariables::find_provider("hostname");
+    assert(host && host->deterministic);
+    assert(SystemVariables::memoized(*host) == SystemVariables::get_hostname());
+    assert(SystemVariables::memoized(*host).data() == SystemVariables::memoized(*host).data());
+    assert(engine.expand_advanced("/who") == SystemVariables::get_username() + "@" + SystemVariables::get_hostname());
+    
+    // Slot contexts are indexed by engine-wide variable IDs and give the same results
+    SlotContext slots = engine.make_slot_context();
+    slots.set(engine.variable_id("name"), "Slot");
+    assert(engine.expand_advanced("/greet", slots) == "Hello Slot, {missing}!");
+    slots.set(engine.variable_id("tier"), "gold");
+    slots.set(engine.variable_id("age"), "40");
+    assert(engine.expand_advanced("/expr", slots) == "GC");
+    assert(engine.expand_advanced("/who", slots).find('{') == std::string::npos);
+    
+    // Function calls: literal and variable arguments, late binding, unknown names
+    added = engine.add_advanced_template("/fn", "{{upper('abc')}}-{{lower(name)}}-{{shout(name, \"!\")}}-{{nope()}}");
+    assert(added);
+    assert(engine.expand_advanced("/fn", {{"name", "BoB"}}) == "ABC-bob-[UNKNOWN_FUNCTION:shout]-[UNKNOWN_FUNCTION:nope]");
+    engine.register_custom_function("shout", [](const FunctionArgs& args, const Context&) {
+        return std::string(args[0]) + std::string(args[1]);
+    });
+    assert(engine.expand_advanced("/fn", {{"name", "BoB"}}) == "ABC-bob-BoB!-[UNKNOWN_FUNCTION:nope]");
+    
+    // Expansion cache: only deterministic templates are memoized, keyed by the values they read
+    engine.enable_expansion_cache(2);
+    added = engine.add_advanced_template("/memo", "{{upper(name)}}{%if vip%}*{%endif%}");
+    assert(added);
+    added = engine.add_advanced_template("/rand", "{{random_number}}");
+    assert(added);
+    auto& hits = performance_monitor().counter("expansion_cache_hits");
+    uint64_t hits_before = hits.get();
+    assert(engine.expand_advanced("/memo", {{"name", "ann"}, {"unused", "x"}}) == "ANN");
+    assert(engine.expand_advanced("/memo", {{"name", "ann"}, {"unused", "y"}}) == "ANN");
+    assert(engine.expand_advanced("/memo", {{"name", "ann"}, {"vip", "1"}}) == "ANN*");
+    assert(hits.get() == hits_before + 1);
+    engine.expand_advanced("/rand");
+    engine.expand_advanced("/fn", {{"name", "BoB"}});
+    assert(engine.expansion_cache_size() == 2);
+    engine.SetVariable("anything", "1");
+    assert(engine.expand_advanced("/memo", {{"name", "ann"}}) == "ANN");
+    assert(hits.get() == hits_before + 1);
+    assert(engine.expansion_cache_size() == 1);
+    
+    // Removing a template retires its cached expansions instead of serving them
+    assert(engine.expand_advanced("/memo", {{"name", "ann"}}) == "ANN");
+    assert(hits.get() == hits_before + 2);
+    bool removed = engine.RemoveTemplate("/memo");
+    assert(removed);
+    assert(engine.expand_advanced("/memo", {{"name", "ann"}}).empty());
+    assert(hits.get() == hits_before + 2);
+    added = engine.add_advanced_template("/memo", "{{upper(name)}}!");
+    assert(added);
+    assert(engine.expand_advanced("/memo", {{"name", "ann"}}) == "ANN!");
+    assert(hits.get() == hits_before + 2);
+    assert(engine.expansion_cache_size() == 1);
+    
+    // Loops over newline-separated lists, nested loops and loop variables as arguments
+    added = engine.add_advanced_template("/list", "{% for item in items %}[{{item}}]{% endfor %}");
+    assert(added);
+    assert(engine.expand_advanced("/list", {{"items", "a\nb\r\nc\n"}}) == "[a][b][c]");
+    assert(engine.expand_advanced("/list", {{"items", ""}}) == "");
+    assert(engine.expand_advanced("/list") == "");
+    added = engine.add_advanced_template("/grid",
+        "{%for row in rows%}{{row}}:{%for cell in cells%}{{upper(cell)}}{%if sep%},{%endif%}{%endfor%};{%endfor%}");
+    assert(added);
+    assert(engine.expand_advanced("/grid", {{"rows", "1\n2"}, {"cells", "x\ny"}, {"sep", "1"}}) == "1:X,Y,;2:X,Y,;");
+    
+    // List providers are iterated lazily and keep templates out of the cache
+    struct CountCursor : ListCursor {
+        int remaining;
+        std::string current;
+        explicit CountCursor(int n) : remaining(n) {}
+        bool next(std::string_view& item) override {
+            if (remaining == 0) return false;
+            current = std::to_string(remaining--);
+            item = current;
+            return true;
+        }
+    };
+    added = engine.add_advanced_template("/count", "{%for n in countdown%}{{n}} {%endfor%}go");
+    assert(added);
+    assert(engine.expand_advanced("/count") == "go");
+    engine.register_list_provider("countdown", [](const Context&) { return std::make_unique<CountCursor>(3); });
+    assert(engine.expand_advanced("/count") == "3 2 1 go");
+    assert(engine.expand_advanced("/count", {{"countdown", "x"}}) == "x go");
+    
+    // Streaming hands the same output to the sink in chunks and can be stopped early
+    std::string rows;
+    for (int i = 0; i < 100; ++i) rows += "row" + std::to_string(i) + "\n";
+    Context row_context{{"items", rows}};
+    std::string streamed;
+    size_t chunks = 0;
+    auto& first_chunk = performance_monitor().timer("expansion_first_chunk");
+    uint64_t first_before = first_chunk.count();
+    bool completed = engine.expand_advanced_streaming("/list", row_context, [&](std::string_view chunk) {
+        streamed += chunk;
+        chunks++;
+        return true;
+    }, 64);
+    assert(completed);
+    assert(streamed == engine.expand_advanced("/list", row_context));
+    assert(chunks > 1);
+    assert(first_chunk.count() == first_before + 1);
+    chunks = 0;
+    completed = engine.expand_advanced_streaming("/list", row_context, [&](std::string_view) { return ++chunks < 2; }, 64);
+    assert(!completed);
+    assert(chunks == 2);
+    
+    // Malformed, unclosed or mismatched blocks fail to compile
+    added = engine.add_advanced_template("/bad", "{%for x%}{%endfor%}");
+    assert(!added);
+    added = engine.add_advanced_template("/open", "{%for x in xs%}body");
+    assert(!added);
+    added = engine.add_advanced_template("/cross", "{%if a%}{%for x in xs%}{%endif%}{%endfor%}");
+    assert(!added);
+    added = engine.add_advanced_template("/stray", "text{%endif%}");
+    assert(!added);
+    added = engine.add_advanced_template("/unknown", "{%while a%}");
+    assert(!added);
+    
+    // Lone braces stay literal and tags tolerate inner whitespace
+    added = engine.add_advanced_template("/braces", "{ {{ name }} }{x}{");
+    assert(added);
+    assert(engine.expand_advanced("/braces", {{"name", "N"}}) == "{ N }{x}{");
+    
+    std::cout << "AdvancedTemplateEngine tests passed!" << std::endl;
+}
+
+void TestSnapshotReads() {
+    std::cout << "Testing snapshot reads..." << std::endl;
+    
+    AdvancedTemplateEngine engine;
+    engine.add_advanced_template("/stable", "S{{n}}");
+    
+    // Readers run without locks while a writer keeps publishing new snapshots
+    std::atomic<bool> stop{false};
+    std::atomic<int> bad{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&]() {
+            while (!stop.load()) {
+                if (engine.expand_advanced("/stable", {{"n", "1"}}) != "S1") bad++;
+                std::string v = engine.Expand("/v0");
+                if (!v.empty() && v != "v") bad++;
+            }
+        });
+    }
+    for (int i = 0; i < 200; ++i) {
+        engine.add_advanced_templates({{"/v" + std::to_string(i % 3), "v"}, {"/w", "w{{n}}"}});
+        engine.RemoveTemplate("/v0");
+        engine.SetVariable("n", std::to_string(i));
+    }
+    stop = true;
+    for (auto& reader : readers) reader.join();
+    assert(bad.load() == 0);
+    
+    // Nothing reads any more, so every retired snapshot can be freed
+    EpochDomain::global().reclaim();
+    assert(EpochDomain::global().pending() == 0);
+    
+    std::cout << "Snapshot read tests passed!" << std::endl;
+}
+
+void TestParallelCompile() {
+    std::cout << "Testing parallel compilation..." << std::endl;
+    
+    // Every 50th source is broken; the rest must match a serial compile exactly
+    std::vector<std::pair<std::string, std::string>> sources;
+    for (int i = 0; i < 500; ++i) {
+        std::string source = i % 50 == 7 ? "ok {%if flag%}never closed"
+                                          : "T" + std::to_string(i) + " {{name}}{%if n > " + std::to_string(i % 7) +
+                                                "%}+{%endif%}{%for x in items%}<{{upper(x)}}>{%endfor%}";
+        sources.emplace_back("/p" + std::to_string(i), source);
+    }
+    
+    AdvancedTemplateEngine serial;
+    AdvancedTemplateEngine parallel;
+    size_t serial_added = serial.add_advanced_templates(sources, 1);
+    size_t parallel_added = parallel.add_advanced_templates(sources, 4);
+    assert(serial_added == 490 && parallel_added == 490);
+    Context context = {{"name", "Ann"}, {"n", "3"}, {"items", "a\nb"}};
+    for (const auto& entry : sources) {
+        assert(parallel.expand_advanced(entry.first, context) == serial.expand_advanced(entry.first, context));
+    }
+    assert(parallel.expand_advanced("/p0", context) == "T0 Ann+<A><B>");
+    
+    auto stats = parallel.get_compilation_stats();
+    assert(stats.total_templates == 500 && stats.compiled_templates == 490 && stats.failed_compilations == 10);
+    assert(stats.last_batch_threads == 4);
+    assert(stats.total_compile_time.count() > 0 && stats.average_compile_time <= stats.max_compile_time);
+    assert(stats.recent_failures.size() == 10);
+    assert(stats.recent_failures[0].shortcut == "/p7" && stats.recent_failures[0].offset == 3);
+    
+    // Condition errors point at the offending token inside the tag
+    bool added = parallel.add_advanced_template("/badpos", "ab{%if x ==%}y{%endif%}");
+    assert(!added);
+    stats = parallel.get_compilation_stats();
+    assert(stats.recent_failures.back().shortcut == "/badpos" && stats.recent_failures.back().offset == 11);
+    
+    // Recompiling republishes every template with the same output
+    bool recompiled = parallel.compile_all_templates(4);
+    assert(recompiled);
+    recompiled = parallel.compile_template("/p0");
+    assert(recompiled);
+    recompiled = parallel.compile_template("/missing");
+    assert(!recompiled);
+    assert(parallel.expand_advanced("/p1", context) == serial.expand_advanced("/p1", context));
+    assert(parallel.get_compilation_stats().compiled_templates == 490 + 490 + 1);
+    
+    // An include cycle is rejected by both engines and the previous definition stays
+    added = parallel.add_advanced_template("/inc_a", "A{/inc_b}");
+    assert(added);
+    added = parallel.add_advanced_template("/inc_b", "B");
+    assert(added);
+    size_t cycle_added = parallel.add_advanced_templates({{"/inc_b", "B{/inc_a}"}, {"/inc_c", "C"}});
+    assert(cycle_added == 1);
+    assert(parallel.expand_advanced("/inc_b") == "B");
+    assert(parallel.expand_advanced("/inc_c") == "C");
+    added = parallel.add_advanced_template("/inc_self", "{/inc_self}");
+    assert(!added);
+    assert(!parallel.validate_template("/inc_self") && !parallel.HasTemplate("/inc_self"));
+    
+    std::cout << "Parallel compilation tests passed!" << std::endl;
+}
+
+void TestSharedTemplateSource() {
+    std::cout << "Testing shared template source..." << std::endl;
+    
+    AdvancedTemplateEngine engine;
+    const std::string signature = "Best regards,\nThe Support Team\n-- sent from CrossExpand";
+    const std::string greeting = "Hello {{name}}, {%if vip%}welcome back{%endif%} {{upper(name)}} 'quoted'";
+    size_t added = engine.add_advanced_templates({{"/sig", signature}, {"/hi", greeting}});
+    assert(added == 2);
+    assert(engine.Expand("/sig") == signature);
+    assert(engine.expand_advanced("/hi", {{"name", "ann"}, {"vip", "true"}}) == "Hello ann, welcome back ANN 'quoted'");
+    
+    // Literals, names and arguments point into the source instead of a private copy
+    AdvancedTemplate tmpl(std::make_shared<const std::string>(greeting));
+    bool compiled = tmpl.compile();
+    assert(compiled);
+    assert(tmpl.image().text == tmpl.get_source().data() && tmpl.image().text_size == greeting.size());
+    
+    // The source is counted once although both engines expand from it
+    TemplateFootprint sig = engine.get_template_footprint("/sig");
+    TemplateFootprint hi = engine.get_template_footprint("/hi");
+    assert(sig.source_bytes >= signature.size() && sig.source_bytes < 2 * signature.size());
+    assert(hi.compiled_bytes > 0 && hi.linked_bytes == 0);
+    assert(engine.get_total_footprint().total() == sig.total() + hi.total());
+    assert(engine.get_template_footprint("/missing").total() == 0);
+    
+    // Removal through the advanced engine drops the template from both views
+    uint64_t generation = engine.GetGeneration();
+    bool removed = engine.RemoveTemplate("/sig");
+    assert(removed);
+    assert(engine.GetGeneration() > generation);
+    assert(!engine.HasTemplate("/sig") && engine.Expand("/sig").empty());
+    assert(engine.expand_advanced("/sig").empty());
+    assert(engine.get_template_footprint("/sig").total() == 0);
+    assert(engine.get_total_footprint().total() == hi.total());
+    removed = engine.RemoveTemplate("/sig");
+    assert(!removed);
+    
+    std::cout << "Shared template source tests passed!" << std::endl;
+}
+
+void TestTemplateStore() {
+    std::cout << "Testing TemplateStore..." << std::endl;
+    
+    const std::string path = (std::filesystem::temp_directory_path() / "crossexpand_test.store").string();
+    const std::vector<std::pair<std::string, std::string>> sources = {
+        {"/plain", "Hello {{name}}!"},
+        {"/call", "{{shout(name)}} {{upper('x')}}"},
+        {"/loop", "{%for i in items%}[{{i}}{%if i == 'b'%}!{%endif%}]{%endfor%}"},
+        {"/cond", "{%if n > 2 and not quiet%}big{%endif%}{{n}}"},
+    };
+    auto shout = [](const FunctionArgs& args, const Context&) {
+        return args.empty() ? std::string() : std::string(args[0]) + "!";
+    };
+    Context context = {{"name", "Ann"}, {"items", "a\nb"}, {"n", "3"}, {"quiet", "false"}};
+    
+    AdvancedTemplateEngine original;
+    original.register_custom_function("shout", shout, true);
+    size_t added = original.add_advanced_templates(sources);
+    assert(added == sources.size());
+    bool saved = original.save_template_store(path);
+    assert(saved);
+    
+    auto store = TemplateStore::open(path);
+    assert(store && store->size() == sources.size());
+    assert(store->find("/loop") && !store->find("/missing"));
+    assert(store->source_hash(*store->find("/plain")) == TemplateStore::hash_source("Hello {{name}}!"));
+    
+    // Loading needs no sources; functions registered afterwards still bind by name
+    auto& hits = performance_monitor().counter("template_store_hits");
+    auto& misses = performance_monitor().counter("template_store_misses");
+    uint64_t hits_before = hits.get();
+    AdvancedTemplateEngine loaded;
+    size_t loaded_count = loaded.load_template_store(path);
+    assert(loaded_count == sources.size());
+    loaded.register_custom_function("shout", shout, true);
+    assert(hits.get() - hits_before == sources.size());
+    for (const auto& entry : sources) {
+        const std::string& shortcut = entry.first;
+        assert(loaded.expand_advanced(shortcut, context) == original.expand_advanced(shortcut, context));
+        assert(loaded.HasTemplate(shortcut));
+    }
+    assert(loaded.expand_advanced("/loop", context) == "[a][b!]");
+    
+    // Loaded sources stay in the mapping; the basic engine tokenizes on first use
+    assert(loaded.get_template_footprint("/plain").source_bytes == 0);
+    assert(loaded.TemplateEngine::Expand("/cond", context) == original.TemplateEngine::Expand("/cond", context));
+    
+    // An attached store only serves templates whose source is unchanged
+    uint64_t misses_before = misses.get();
+    AdvancedTemplateEngine attached;
+    bool attached_ok = attached.attach_template_store(path);
+    assert(attached_ok);
+    added = attached.add_advanced_templates({{"/plain", "Hello {{name}}!"}, {"/cond", "changed {{n}}"}});
+    assert(added == 2);
+    assert(misses.get() - misses_before == 1);
+    assert(attached.expand_advanced("/plain", context) == "Hello Ann!");
+    assert(attached.expand_advanced("/cond", context) == "changed 3");
+    
+    // Foreign or truncated files are ignored rather than mapped
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << std::string(256, 'x');
+    }
+    AdvancedTemplateEngine rejected;
+    attached_ok = rejected.attach_template_store(path);
+    assert(!attached_ok);
+    loaded_count = rejected.load_template_store(path);
+    assert(loaded_count == 0);
+    std::filesystem::remove(path);
+    
+    std::cout << "TemplateStore tests passed!" << std::endl;
+}
+
+void TestTimeFormatter() {
+    std::cout << "Testing time formatter..." << std::endl;
+    
+    // Direct fields, composites, escapes and strftime fallbacks must all match strftime
+    const char* formats[] = {"%Y-%m-%d", "%H:%M:%S", "%F %T", "%D %R", "%a %A %b %B %h", "%I%p %e %j %u %w %y %C",
+                             "100%% at %H%%", "%c | %Z | %-d | %Ey", "plain text", "tail %", ""};
+    std::time_t second = 1700000000;
+    for (int day = 0; day < 400; day += 37) {
+        for (int hour = 0; hour < 24; hour += 5) {
+            std::time_t t = second + day * 86400 + hour * 3600 + day * 61;
+            std::tm tm{};
+            localtime_r(&t, &tm);
+            for (const char* format : formats) {
+                char expected[256];
+                size_t length = std::strftime(expected, sizeof(expected), format, &tm);
+                assert(TimeFormatter(format).format(tm) == std::string(expected, length));
+                assert(LocalClock::format(t, format) == std::string(expected, length));
+            }
+        }
+    }
+    
+    // Cached per second and per format: repeated calls agree, other formats stay independent
+    std::time_t now = std::time(nullptr);
+    assert(LocalClock::format(now, "%Y") == LocalClock::format(now, "%Y"));
+    for (int i = 0; i < 40; ++i) {
+        LocalClock::format(now, "fmt " + std::to_string(i) + " %S");
+    }
+    assert(LocalClock::format(now + 60, "%M") != LocalClock::format(now, "%M"));
+    
+    std::cout << "Time formatter tests passed!" << std::endl;
+}
+
+void TestThreadRandom() {
+    std::cout << "Testing thread-local random..." << std::endl;
+    
+    // Same seed, same sequence; every value of a small range shows up, bounds in either order
+    Xoshiro256 a(42), b(42);
+    for (int i = 0; i < 100; ++i) {
+        uint64_t first = a.next();
+        uint64_t second = b.next();
+        assert(first == second);
+    }
+    bool seen[7] = {};
+    for (int i = 0; i < 1000; ++i) {
+        int64_t value = a.uniform(9, 3);
+        assert(value >= 3 && value <= 9);
+        seen[value - 3] = true;
+    }
+    for (bool hit : seen) assert(hit);
+    int64_t fixed = a.uniform(-5, -5);
+    assert(fixed == -5);
+    
+    // UUIDs are v4, RFC 4122 variant, and unique across buffer refills and threads
+    std::vector<std::vector<std::string>> per_thread(4);
+    std::vector<std::thread> threads;
+    for (auto& uuids : per_thread) {
+        threads.emplace_back([&uuids] {
+            for (int i = 0; i < 1000; ++i) uuids.push_back(ThreadRandom::uuid_v4());
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    std::unordered_set<std::string> unique;
+    for (const auto& uuids : per_thread) {
+        for (const auto& uuid : uuids) {
+            assert(uuid.size() == 36 && uuid[8] == '-' && uuid[13] == '-' && uuid[18] == '-' && uuid[23] == '-');
+            assert(uuid[14] == '4' && std::string("89ab").find(uuid[19]) != std::string::npos);
+            assert(uuid.find_first_not_of("0123456789abcdef-") == std::string::npos);
+            unique.insert(uuid);
+        }
+    }
+    assert(unique.size() == 4000);
+    
+    AdvancedTemplateEngine engine;
+    engine.add_advanced_template("/rand", "{{random(5, 5)}} {{uuid()}}");
+    std::string result = engine.expand_advanced("/rand");
+    assert(result.size() == 2 + 36 && result.compare(0, 2, "5 ") == 0);
+    
+    std::cout << "Thread-local random tests passed!" << std::endl;
+}
+
+void TestContextChain() {
+    std::cout << "Testing layered context..." << std::endl;
+    
+    AdvancedTemplateEngine engine;
+    engine.SetVariable("company", "Acme");
+    engine.add_advanced_template("/sig", "{{name}} @ {{company}} as {{username}}");
+    
+    // Caller values win over globals, globals over system providers
+    std::string user = SystemVariables::get_username();
+    assert(engine.expand_advanced("/sig", {{"name", "Ann"}}) == "Ann @ Acme as " + user);
+    assert(engine.expand_advanced("/sig", {{"name", "Ann"}, {"company", "Initech"}}) == "Ann @ Initech as " + user);
+    engine.SetVariable("username", "support");
+    assert(engine.expand_advanced("/sig", {{"name", "Ann"}}) == "Ann @ Acme as support");
+    
+    // Caller-assembled layers are searched before the globals
+    Context request = {{"name", "Bob"}};
+    Context defaults = {{"name", "Default"}, {"company", "Globex"}};
+    assert(engine.expand_advanced("/sig", ContextChain{&request, &defaults}) == "Bob @ Globex as support");
+    
+    // A full chain still falls back to the globals
+    Context empty;
+    ContextChain full{&request, &empty, &empty, &empty};
+    assert(full.size() == ContextChain::MAX_LAYERS);
+    assert(engine.expand_advanced("/sig", full) == "Bob @ Acme as support");
+    
+    // Basic-only templates resolve through every layer too
+    engine.AddTemplate("/basic", Template("{name} of {company}"));
+    assert(engine.expand_advanced("/basic", ContextChain{&request, &defaults}) == "Bob of Globex");
+    
+    // The reused slot array keeps nothing from the previous expansion
+    engine.add_advanced_template("/name", "[{{name}}]");
+    std::string unbound = engine.expand_advanced("/name");
+    engine.expand_advanced("/name", {{"name", "Carol"}});
+    assert(engine.expand_advanced("/name") == unbound);
+    
+    // An expansion started from a function gets its own slots
+    engine.register_custom_function("inner", [&engine](const FunctionArgs&, const Context&) {
+        return engine.expand_advanced("/name", {{"name", "inner"}});
+    });
+    engine.add_advanced_template("/outer", "{{name}}{{inner()}}{{name}}");
+    assert(engine.expand_advanced("/outer", {{"name", "out"}}) == "out[inner]out");
+    
+    std::cout << "Layered context tests passed!" << std::endl;
+}
+
+void TestEventQueueMpmc() {
+    std::cout << "Testing MPMC event queue..." << std::endl;
+    
+    // Single-threaded: highest priority first, FIFO within a level
+    EventQueue queue;
+    queue.push(SimpleKeyEvent(1, 'a', true), EventPriority::LOW);
+    queue.push(SimpleKeyEvent(2, 'b', true), EventPriority::CRITICAL);
+    queue.push(SimpleKeyEvent(3, 'c', true), EventPriority::LOW);
+    ProcessingEvent event;
+    for (int expected : {2, 1, 3}) {
+        bool got = queue.pop(event);
+        assert(got && event.key_event.keycode == expected);
+    }
+    bool got = queue.pop(event);
+    assert(!got);
+    
+    // Several producers and consumers: every event comes out exactly once
+    const int producers = 4;
+    const int consumers = 4;
+    const int per_producer = 20000;
+    const int total = producers * per_producer;
+    std::vector<std::atomic<int>> seen(total);
+    std::atomic<int> popped{0};
+    
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&queue, p] {
+            for (int i = 0; i < per_producer; ++i) {
+                SimpleKeyEvent key(p * per_producer + i, 'x', true);
+                auto priority = static_cast<EventPriority>(i % 4);
+                while (!queue.push(key, priority)) {
+                    std::this_thread::yield();  // Full: retry rather than lose it
+                }
+            }
+        });
+    }
+    for (int c = 0; c < consumers; ++c) {
+        threads.emplace_back([&] {
+            ProcessingEvent item;
+            while (popped.load() < total) {
+                if (queue.pop(item)) {
+                    seen[item.key_event.keycode].fetch_add(1);
+                    popped.fetch_add(1);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    
+    for (auto& count : seen) {
+        assert(count.load() == 1);
+    }
+    assert(queue.total_size() == 0);
+    assert(queue.get_stats().total_popped == static_cast<uint64_t>(total) + 3);
+    
+    // The SPSC variant keeps the same interface for single-producer paths
+    SpscEventQueue spsc;
+    std::thread producer([&spsc] {
+        for (int i = 0; i < 10000; ++i) {
+            while (!spsc.push(SimpleKeyEvent(i, 'y', true))) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    for (int expected = 0; expected < 10000;) {
+        if (spsc.pop(event)) {
+            assert(event.key_event.keycode == expected);
+            expected++;
+        }
+    }
+    producer.join();
+    
+    std::cout << "MPMC event queue tests passed!" << std::endl;
+}
+
+void TestEventQueueWaitPop() {
+    std::cout << "Testing blocking event queue pop..." << std::endl;
+    using namespace std::chrono;
+    
+    EventQueue queue;
+    ProcessingEvent event;
+    
+    // Nothing arrives: returns false after roughly the timeout
+    auto start = steady_clock::now();
+    bool got = queue.wait_pop(event, milliseconds(20));
+    assert(!got);
+    assert(steady_clock::now() - start >= milliseconds(20));
+    
+    // Pushes with nobody parked never wake anyone
+    queue.push(SimpleKeyEvent(1, 'a', true));
+    got = queue.wait_pop(event, seconds(1));
+    assert(got && event.key_event.keycode == 1);
+    assert(queue.get_stats().wakeups == 0);
+    
+    // A parked consumer is woken by the push, long before its timeout
+    std::atomic<int> received{-1};
+    uint64_t parks = queue.get_stats().parks;
+    std::thread consumer([&] {
+        ProcessingEvent item;
+        if (queue.wait_pop(item, seconds(10))) {
+            received = item.key_event.keycode;
+        }
+    });
+    while (queue.get_stats().parks == parks) {
+        std::this_thread::yield();
+    }
+    start = steady_clock::now();
+    queue.push(SimpleKeyEvent(2, 'b', true));
+    consumer.join();
+    assert(received == 2);
+    assert(steady_clock::now() - start < seconds(1));
+    assert(queue.get_stats().wakeups >= 1);
+    
+    // Shutdown releases every waiter at once; what is queued is still drained
+    parks = queue.get_stats().parks;
+    std::vector<std::thread> waiters;
+    std::atomic<int> released{0};
+    for (int i = 0; i < 3; ++i) {
+        waiters.emplace_back([&] {
+            ProcessingEvent item;
+            if (!queue.wait_pop(item, seconds(10))) {
+                released++;
+            }
+        });
+    }
+    while (queue.get_stats().parks < parks + 3) {
+        std::this_thread::yield();
+    }
+    start = steady_clock::now();
+    queue.shutdown();
+    for (auto& waiter : waiters) {
+        waiter.join();
+    }
+    assert(released == 3);
+    assert(steady_clock::now() - start < seconds(1));
+    
+    queue.push(SimpleKeyEvent(3, 'c', true));
+    got = queue.wait_pop(event, seconds(10));
+    assert(got && event.key_event.keycode == 3);
+    got = queue.wait_pop(event, seconds(10));
+    assert(!got);
+    
+    std::cout << "Blocking event queue pop tests passed!" << std::endl;
+}
+
+void TestEventQueueBatch() {
+    std::cout << "Testing batched event queue operations..." << std::endl;
+    
+    // Mixed priorities: one call each way, highest level drained first, FIFO within it
+    EventQueue queue;
+    std::vector<ProcessingEvent> burst;
+    for (int i = 0; i < 10; ++i) {
+        burst.emplace_back(SimpleKeyEvent(i, 'a', true), i < 6 ? EventPriority::NORMAL : EventPriority::HIGH);
+    }
+    size_t pushed = queue.push_batch(burst.data(), burst.size());
+    assert(pushed == 10);
+    
+    std::vector<ProcessingEvent> out(16);
+    size_t taken = queue.pop_batch(out.data(), 3);
+    assert(taken == 3);
+    assert(out[0].key_event.keycode == 6 && out[2].key_event.keycode == 8);
+    taken = queue.pop_batch(out.data(), out.size());
+    assert(taken == 7);
+    assert(out[0].key_event.keycode == 9 && out[1].key_event.keycode == 0 && out[6].key_event.keycode == 5);
+    assert(out[6].sequence_id == out[1].sequence_id + 5);
+    taken = queue.pop_batch(out.data(), out.size());
+    assert(taken == 0);
+    
+    auto stats = queue.get_stats();
+    assert(stats.total_pushed == 10 && stats.total_popped == 10);
+    
+    // Under DROP, a batch larger than the ring queues what fits and counts the rest as drops
+    OverflowConfig drop;
+    drop.policy = OverflowPolicy::DROP;
+    EventQueue dropping(SchedulerConfig(), drop);
+    std::vector<ProcessingEvent> flood(5000, ProcessingEvent(SimpleKeyEvent(1, 'f', true), EventPriority::LOW));
+    size_t queued = dropping.push_batch(flood.data(), flood.size());
+    assert(queued == 4096);
+    assert(dropping.get_stats().drops_by_priority[0] == flood.size() - queued);
+    SpscEventQueue spsc(SchedulerConfig(), drop);
+    pushed = spsc.push_batch(flood.data(), flood.size());
+    assert(pushed == 4095);
+    taken = spsc.pop_batch(out.data(), out.size());
+    assert(taken == out.size());
+    
+    // Concurrent batches lose and duplicate nothing
+    EventQueue shared;
+    const int producers = 2;
+    const int batches = 500;
+    const int batch_size = 64;
+    const int total = producers * batches * batch_size;
+    std::vector<std::atomic<int>> seen(total);
+    std::atomic<int> popped{0};
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&shared, p] {
+            std::vector<ProcessingEvent> batch(batch_size);
+            for (int b = 0; b < batches; ++b) {
+                for (int i = 0; i < batch_size; ++i) {
+                    int id = (p * batches + b) * batch_size + i;
+                    batch[i] = ProcessingEvent(SimpleKeyEvent(id, 'x', true), static_cast<EventPriority>(i % 2 * 2));
+                }
+                size_t sent = shared.push_batch(batch.data(), batch.size());
+                while (sent < batch.size()) {
+                    std::this_thread::yield();  // Full: let the consumers catch up
+                    sent += shared.push_batch(batch.data() + sent, batch.size() - sent);
+                }
+            }
+        });
+    }
+    for (int c = 0; c < 2; ++c) {
+        threads.emplace_back([&] {
+            std::vector<ProcessingEvent> items(batch_size);
+            while (popped.load() < total) {
+                size_t n = shared.pop_batch(items.data(), items.size());
+                if (n == 0) {
+                    std::this_thread::yield();
+                }
+                for (size_t i = 0; i < n; ++i) {
+                    seen[items[i].key_event.keycode].fetch_add(1);
+                }
+                popped.fetch_add(static_cast<int>(n));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (auto& count : seen) {
+        assert(count.load() == 1);
+    }
+    
+    std::cout << "Batched event queue tests passed!" << std::endl;
+}
+
+void TestEventQueueScheduler() {
+    std::cout << "Testing event queue scheduling..." << std::endl;
+    using namespace std::chrono;
+    
+    auto fill = [](EventQueue& queue, EventPriority priority, int count) {
+        for (int i = 0; i < count; ++i) {
+            queue.push(SimpleKeyEvent(static_cast<int>(priority), 'q', true), priority);
+        }
+    };
+    auto count_low = [](EventQueue& queue, int pops) {
+        ProcessingEvent event;
+        int low = 0;
+        for (int i = 0; i < pops && queue.pop(event); ++i) {
+            low += event.priority == EventPriority::LOW;
+        }
+        return low;
+    };
+    
+    // Weighted round robin: LOW gets its share while CRITICAL stays busy
+    SchedulerConfig weighted;
+    weighted.weights = {1, 0, 0, 3};
+    weighted.max_wait.fill(microseconds::zero());
+    EventQueue shared(weighted);
+    fill(shared, EventPriority::CRITICAL, 100);
+    fill(shared, EventPriority::LOW, 100);
+    int low_popped = count_low(shared, 40);
+    assert(low_popped == 10);
+    
+    // Strict priority (the default) starves LOW until CRITICAL is empty
+    assert(SchedulerConfig().weights == SchedulerConfig::strict().weights);
+    assert(SchedulerConfig().max_wait == SchedulerConfig::strict().max_wait);
+    EventQueue strict;
+    fill(strict, EventPriority::CRITICAL, 100);
+    fill(strict, EventPriority::LOW, 100);
+    low_popped = count_low(strict, 100);
+    assert(low_popped == 0);
+    low_popped = count_low(strict, 100);
+    assert(low_popped == 100);
+    
+    // Aging: an event past its level's max_wait overtakes strict order
+    SchedulerConfig aging = SchedulerConfig::strict();
+    aging.max_wait[0] = milliseconds(1);
+    EventQueue aged(aging);
+    ProcessingEvent old(SimpleKeyEvent(7, 'o', true), EventPriority::LOW);
+    old.timestamp -= milliseconds(5);
+    aged.push(old);
+    fill(aged, EventPriority::CRITICAL, 10);
+    ProcessingEvent event;
+    bool got = aged.pop(event);
+    assert(got && event.key_event.keycode == 7);
+    got = aged.pop(event);
+    assert(got && event.priority == EventPriority::CRITICAL);
+    
+    // Wait histograms per level, with SLO misses against max_wait
+    auto stats = aged.get_stats();
+    const WaitHistogram& low = stats.wait_times[0];
+    assert(low.total == 1 && low.slo_misses == 1);
+    assert(low.max_micros >= 5000 && low.percentile_micros(0.5) >= 4096);
+    assert(stats.wait_times[3].total == 1 && stats.wait_times[3].slo_misses == 0);
+    aged.reset_stats();
+    assert(aged.get_stats().wait_times[0].total == 0);
+    
+    // An overdue CRITICAL event is never overtaken by a level further past its own limit
+    SchedulerConfig opted = SchedulerConfig::weighted();
+    opted.max_wait[0] = milliseconds(1);
+    opted.max_wait[3] = milliseconds(1);
+    EventQueue guarded(opted);
+    ProcessingEvent stale_low(SimpleKeyEvent(8, 'l', true), EventPriority::LOW);
+    stale_low.timestamp -= milliseconds(50);
+    ProcessingEvent stale_critical(SimpleKeyEvent(9, 'c', true), EventPriority::CRITICAL);
+    stale_critical.timestamp -= milliseconds(5);
+    guarded.push(stale_low);
+    guarded.push(stale_critical);
+    got = guarded.pop(event);
+    assert(got && event.key_event.keycode == 9);
+    got = guarded.pop(event);
+    assert(got && event.key_event.keycode == 8);
+    
+    std::cout << "Event queue scheduling tests passed!" << std::endl;
+}
+
+void TestEventQueueOverflow() {
+    std::cout << "Testing event queue overflow policies..." << std::endl;
+    using namespace std::chrono;
+    
+    const int ring = 4096;
+    auto press = [](int id) { return ProcessingEvent(SimpleKeyEvent(id, 'k', true)); };
+    
+    // SPILL (default): a burst past the ring is kept and comes back in order
+    EventQueue spilling;
+    int accepted = 0;
+    for (int i = 0; i < ring + 1000; ++i) {
+        accepted += spilling.push(press(i));
+    }
+    assert(accepted == ring + 1000);
+    auto stats = spilling.get_stats();
+    assert(stats.spilled[1] == 1000 && stats.total_spilled == 1000 && stats.total_dropped == 0);
+    assert(spilling.total_size() == ring + 1000 && spilling.credits(EventPriority::NORMAL) == 0);
+    ProcessingEvent event;
+    for (int i = 0; i < ring + 1000; ++i) {
+        bool got = spilling.pop(event);
+        assert(got && event.key_event.keycode == i);
+    }
+    bool got = spilling.pop(event);
+    assert(!got && spilling.credits(EventPriority::NORMAL) == ring);
+    
+    // The spill is bounded; past it events are dropped and reported once per interval
+    OverflowConfig bounded;
+    bounded.spill_limit = 10;
+    int reports = 0;
+    uint64_t reported = 0;
+    bounded.on_drops = [&](const std::array<uint64_t, EVENT_PRIORITY_LEVELS>& dropped) {
+        reports++;
+        reported += dropped[1];
+    };
+    EventQueue limited(SchedulerConfig(), bounded);
+    accepted = 0;
+    for (int i = 0; i < ring + 100; ++i) {
+        accepted += limited.push(press(i));
+    }
+    assert(accepted == ring + 10);
+    assert(limited.get_stats().drops_by_priority[1] == 90);
+    assert(reports == 1 && reported == 1);  // The rest wait for the next interval
+    
+    // The next queued event at that level says how many were lost before it
+    while (limited.pop(event)) {
+        // Drain
+    }
+    bool pushed = limited.push(press(-1));
+    got = limited.pop(event);
+    assert(pushed && got);
+    assert(event.key_event.keycode == -1 && event.dropped_before == 90);
+    pushed = limited.push(press(-2));
+    got = limited.pop(event);
+    assert(pushed && got && event.dropped_before == 0);
+    
+    // Shutdown reports the rest of the burst without waiting for the interval
+    limited.shutdown();
+    assert(reports == 2 && reported == 90);
+    
+    // Otherwise it goes out with the first push or pop once the interval has passed
+    bounded.drop_report_interval = milliseconds(5);
+    EventQueue reporting(SchedulerConfig(), bounded);
+    reports = 0;
+    reported = 0;
+    for (int i = 0; i < ring + 100; ++i) {
+        reporting.push(press(i));
+    }
+    assert(reports >= 1);
+    std::this_thread::sleep_for(milliseconds(10));
+    got = reporting.pop(event);
+    assert(got && reported == 90);
+    
+    // BLOCK: waits for room up to block_timeout, then drops
+    OverflowConfig blocking;
+    blocking.policy = OverflowPolicy::BLOCK;
+    blocking.block_timeout = milliseconds(5);
+    EventQueue blocked(SchedulerConfig(), blocking);
+    accepted = 0;
+    for (int i = 0; i < ring; ++i) {
+        accepted += blocked.push(press(i));
+    }
+    assert(accepted == ring);
+    auto start = steady_clock::now();
+    pushed = blocked.push(press(ring));
+    assert(!pushed);
+    assert(steady_clock::now() - start >= milliseconds(5));
+    std::thread consumer([&blocked] {
+        std::this_thread::sleep_for(milliseconds(1));
+        ProcessingEvent item;
+        blocked.pop(item);
+    });
+    pushed = blocked.push(press(ring + 1));
+    consumer.join();
+    assert(pushed);
+    assert(blocked.get_stats().blocked == 2);
+    
+    // COALESCE: once the ring is full, a release is folded into its press if that press
+    // is still spilled; releases of presses already in the ring are spilled as usual
+    OverflowConfig coalescing;
+    coalescing.policy = OverflowPolicy::COALESCE;
+    EventQueue coalesced(SchedulerConfig(), coalescing);
+    auto key = [](int keycode, bool pressed) { return ProcessingEvent(SimpleKeyEvent(keycode, 'k', pressed)); };
+    accepted = 0;
+    for (int i = 0; i < ring; ++i) {
+        accepted += coalesced.push(key(i, true));
+    }
+    for (int i = 0; i < 100; ++i) {
+        accepted += coalesced.push(key(ring + i, true));
+        accepted += coalesced.push(key(ring + i, false));
+    }
+    accepted += coalesced.push(key(0, false));        // Press sits in the ring
+    accepted += coalesced.push(key(ring + 200, false));  // Press never seen
+    assert(accepted == ring + 202);
+    stats = coalesced.get_stats();
+    assert(stats.coalesced == 100 && stats.spilled[1] == 102 && stats.total_pushed == ring + 102);
+    
+    // A press that has left the spill no longer absorbs its release
+    pushed = coalesced.push(key(-1, true));
+    assert(pushed);
+    ProcessingEvent drained;
+    int popped = 0;
+    for (int i = 0; i < ring + 102; ++i) {
+        popped += coalesced.pop(drained);
+    }
+    assert(popped == ring + 102);
+    got = coalesced.pop(drained);
+    assert(got && drained.key_event.keycode == -1);
+    pushed = coalesced.push(key(-1, false));
+    assert(pushed);
+    assert(coalesced.get_stats().coalesced == 100);
+    
+    // Every press is delivered once, in order, and no release of a spilled press survives
+    EventQueue paired(SchedulerConfig(), coalescing);
+    accepted = 0;
+    for (int i = 0; i < ring; ++i) {
+        accepted += paired.push(key(i, true));
+    }
+    for (int i = 0; i < 50; ++i) {
+        accepted += paired.push(key(1000, true));
+        accepted += paired.push(key(1000, false));
+    }
+    assert(accepted == ring + 100);
+    int presses = 0;
+    int releases = 0;
+    while (paired.pop(drained)) {
+        (drained.key_event.is_pressed ? presses : releases)++;
+    }
+    assert(presses == ring + 50 && releases == 0);
+    
+    // Watermarks: one signal going over the high mark, one coming back under the low mark
+    OverflowConfig watched;
+    std::vector<bool> signals;
+    watched.on_watermark = [&](EventPriority priority, bool congested) {
+        assert(priority == EventPriority::NORMAL);
+        signals.push_back(congested);
+    };
+    EventQueue watched_queue(SchedulerConfig(), watched);
+    for (int i = 0; i < ring; ++i) {
+        watched_queue.push(press(i));
+    }
+    assert(signals.size() == 1 && signals[0]);
+    while (watched_queue.pop(event)) {
+        // Drain
+    }
+    assert(signals.size() == 2 && !signals[1]);
+    
+    std::cout << "Event queue overflow tests passed!" << std::endl;
+}
+
+void TestTriggerMatcher() {
+    std::cout << "Testing TriggerMatcher..." << std::endl;
+    
+    auto type = [](TriggerMatcher::Cursor& cursor, const std::string& keys) -> std::string {
+        const std::string* match = nullptr;
+        for (char c : keys) {
+            match = cursor.advance(c);
+        }
+        return match ? *match : "";
+    };
+    
+    TemplateEngine engine;
+    engine.AddTemplate("/sig", Template("sig"));
+    engine.AddTemplate("ig", Template("ig"));
+    engine.AddTemplate("/email", Template("mail"));
+    
+    TriggerMatcher matcher([&engine]() { return engine.GetShortcuts(); });
+    matcher.rebuild_now(engine.GetGeneration());
+    
+    TriggerMatcher::Cursor cursor;
+    matcher.sync(cursor);
+    
+    // Longest shortcut ending at the current key wins; matching is incremental
+    std::string match = type(cursor, "a/si");
+    assert(match == "");
+    match = type(cursor, "g");
+    assert(match == "/sig");
+    match = type(cursor, "big");
+    assert(match == "ig");
+    match = type(cursor, "//ema/email");
+    assert(match == "/email");
+    
+    // Background rebuild picks up new templates; the cursor resyncs to the new automaton
+    engine.AddTemplate("/addr", Template("addr"));
+    matcher.request_rebuild(engine.GetGeneration());
+    for (int i = 0; i < 1000 && matcher.generation() != engine.GetGeneration(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    assert(matcher.generation() == engine.GetGeneration());
+    matcher.sync(cursor);
+    match = type(cursor, "x/addr");
+    assert(match == "/addr");
+    
+    std::cout << "TriggerMatcher tests passed!" << std::endl;
+}
+
+void TestKeystrokeExpander() {
+    std::cout << "Testing KeystrokeExpander..." << std::endl;
+    
+    auto engine = std::make_shared<AdvancedTemplateEngine>();
+    engine->add_advanced_template("/sig", "Best regards");
+    engine->add_advanced_template("/empty", "");
+    
+    std::vector<std::pair<size_t, std::string>> injected;
+    bool inject_ok = true;
+    KeystrokeExpander expander(engine, [&](size_t trigger_length, const std::string& expansion) {
+        injected.emplace_back(trigger_length, expansion);
+        return inject_ok;
+    });
+    
+    auto type = [&expander](const std::string& keys) {
+        bool expanded = false;
+        for (char c : keys) {
+            expanded = expander.process_event(ProcessingEvent(SimpleKeyEvent(0, c, true)));
+            expander.process_event(ProcessingEvent(SimpleKeyEvent(0, c, false)));
+        }
+        return expanded;
+    };
+    
+    // The trigger is erased and replaced by its expansion
+    bool expanded = type("hi /si");
+    assert(!expanded);
+    expanded = type("g");
+    assert(expanded);
+    assert(injected.size() == 1);
+    assert(injected[0].first == 4 && injected[0].second == "Best regards");
+    assert(expander.get_expansions_performed() == 1);
+    
+    // A non-character key breaks the typed sequence
+    expanded = type("/s");
+    assert(!expanded);
+    expander.process_event(ProcessingEvent(SimpleKeyEvent(0, 0, true)));
+    expanded = type("ig");
+    assert(!expanded);
+    
+    // Templates added later are matched once the background rebuild lands
+    engine->add_advanced_template("/addr", "1 Main St");
+    bool matched = false;
+    for (int i = 0; i < 1000 && !matched; ++i) {
+        matched = type("/addr");
+        if (!matched) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    assert(matched && injected.back().second == "1 Main St");
+    
+    // Empty expansions and failed injections are not counted
+    uint64_t performed = expander.get_expansions_performed();
+    expanded = type("/empty");
+    assert(!expanded);
+    inject_ok = false;
+    expanded = type("/sig");
+    assert(!expanded);
+    assert(expander.get_expansions_performed() == performed);
+    
+    std::cout << "KeystrokeExpander tests passed!" << std::endl;
+}
+
+void TestKeystrokeExpanderRun() {
+    std::cout << "Testing KeystrokeExpander consumer loop..." << std::endl;
+    
+    auto engine = std::make_shared<AdvancedTemplateEngine>();
+    engine->add_advanced_template("/sig", "Best regards");
+    
+    std::atomic<int> injections{0};
+    KeystrokeExpander expander(engine, [&injections](size_t, const std::string&) {
+        injections++;
+        return true;
+    });
+    
+    EventQueue queue;
+    std::atomic<int> processed{0};
+    std::thread consumer([&]() {
+        expander.run(queue, []() { return false; },
+                     [&processed](std::chrono::steady_clock::duration) { processed++; });
+    });
+    
+    // The consumer parks between keystrokes and wakes for each one
+    const std::string typed = "a /sig b /sig";
+    for (char c : typed) {
+        queue.push(SimpleKeyEvent(0, c, true));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    
+    // Shutdown ends the loop only after what was queued has been processed
+    for (char c : std::string(" /sig")) {
+        queue.push(SimpleKeyEvent(0, c, true));
+    }
+    queue.shutdown();
+    consumer.join();
+    
+    assert(processed.load() == static_cast<int>(typed.size() + 5));
+    assert(injections.load() == 3);
+    assert(expander.get_expansions_performed() == 3);
+    
+    // A stop request ends the loop without a shutdown
+    EventQueue idle_queue;
+    std::atomic<bool> stop{false};
+    std::thread idle_consumer([&]() {
+        expander.run(idle_queue, [&stop]() { return stop.load(); }, nullptr, std::chrono::milliseconds(5));
+    });
+    stop.store(true);
+    idle_consumer.join();
+    
+    std::cout << "KeystrokeExpander consumer loop tests passed!" << std::endl;
+}
+
+void TestStreamInjection() {
+    std::cout << "Testing streamed injection..." << std::endl;
+    
+    struct RecordingInjector : TextInjector {
+        std::vector<std::string>& calls;
+        explicit RecordingInjector(std::vector<std::string>& out) : calls(out) {}
+        bool Initialize() override { return true; }
+        void Shutdown() override {}
+        bool InjectText(const std::string& text, InjectionMethod) override {
+            calls.push_back(text);
+            return true;
+        }
+        bool DeletePreviousChars(size_t) override { return true; }
+        bool IsReady() const override { return true; }
+        std::string GetLastError() const override { return ""; }
+    };
+    
+    std::vector<std::string> fast, natural, pasted;
+    EnhancedTextInjector injector;
+    bool installed = injector.set_strategy_injector(InjectionStrategy::FAST_TYPING, std::make_unique<RecordingInjector>(fast));
+    assert(installed);
+    installed = injector.set_strategy_injector(InjectionStrategy::NATURAL_TYPING, std::make_unique<RecordingInjector>(natural));
+    assert(installed);
+    installed = injector.set_strategy_injector(InjectionStrategy::CLIPBOARD_PASTE, std::make_unique<RecordingInjector>(pasted));
+    assert(installed);
+    installed = injector.set_strategy_injector(InjectionStrategy::ADAPTIVE, nullptr);
+    assert(!installed);
+    
+    auto chunks_of = [](const std::string& text, size_t size) -> ChunkProducer {
+        return [text, size](const ChunkSink& sink) {
+            for (size_t pos = 0; pos < text.size(); pos += size) {
+                if (!sink(std::string_view(text).substr(pos, size))) return false;
+            }
+            return true;
+        };
+    };
+    
+    // A multi-KB expansion is typed while short, then the rest is pasted once
+    auto& first_char = performance_monitor().timer("injection_first_char");
+    uint64_t first_before = first_char.count();
+    std::string long_text;
+    for (int i = 0; i < 400; ++i) long_text += "line " + std::to_string(i) + "\n";
+    bool injected = injector.inject_stream(chunks_of(long_text, 256));
+    assert(injected);
+    assert(fast.size() == 1 && fast[0].size() == 256);
+    assert(pasted.size() == 1 && fast[0] + pasted[0] == long_text);
+    assert(natural.empty());
+    assert(first_char.count() == first_before + 1);
+    
+    // Short text is typed chunk by chunk as it arrives
+    fast.clear();
+    injected = injector.inject_stream(chunks_of("Best regards", 4));
+    assert(injected);
+    assert(fast.size() == 3 && fast[0] == "Best" && fast[0] + fast[1] + fast[2] == "Best regards");
+    const std::string medium(300, 'm');
+    fast.clear();
+    injected = injector.inject_stream(chunks_of(medium, 64));
+    assert(injected);
+    assert(fast.size() == 5 && pasted.size() == 1);
+    
+    // Explicit paste pastes once; explicit typing injects chunk by chunk
+    injected = injector.inject_stream(chunks_of(medium, 64), InjectionStrategy::CLIPBOARD_PASTE);
+    assert(injected);
+    assert(pasted.size() == 2 && pasted[1] == medium);
+    fast.clear();
+    injected = injector.inject_stream(chunks_of(medium, 100), InjectionStrategy::NATURAL_TYPING);
+    assert(injected);
+    assert(natural.size() == 3 && natural[0] + natural[1] + natural[2] == medium);
+    assert(fast.empty());
+    
+    // A producer that fails part-way leaves nothing half-pasted
+    first_before = first_char.count();
+    injected = injector.inject_stream([&long_text](const ChunkSink& sink) {
+        sink(long_text);
+        return false;
+    });
+    assert(!injected);
+    assert(pasted.size() == 2);
+    assert(first_char.count() == first_before);
+    
+    // Fed straight from the engine's streaming expansion
+    AdvancedTemplateEngine engine;
+    bool added = engine.add_advanced_template("/rows", "{%for r in rows%}<li>{{r}}</li>\n{%endfor%}");
+    assert(added);
+    Context context{{"rows", long_text}};
+    fast.clear();
+    injected = injector.inject_stream([&](const ChunkSink& sink) {
+        return engine.expand_advanced_streaming("/rows", context, sink, 64);
+    });
+    assert(injected);
+    std::string typed;
+    for (const auto& part : fast) typed += part;
+    assert(!fast.empty() && typed.size() <= EnhancedTextInjector::ADAPTIVE_PASTE_THRESHOLD);
+    assert(pasted.size() == 3 && typed + pasted[2] == engine.expand_advanced("/rows", context));
+    
+    std::cout << "Streamed injection tests passed!" << std::endl;
+}
+
 void TestConfigManager() {
     std::cout << "Testing ConfigManager..." << std::endl;
     
@@ -42,12 +1341,100 @@ void TestConfigManager() {
     assert(!variables.empty());
     assert(variables.find("name") != variables.end());
     
+    // Streaming load of a full config; "shortcut": "text" is accepted as shorthand
+    const auto dir = std::filesystem::temp_directory_path();
+    const std::string json_path = (dir / "crossexpand_test_config.json").string();
+    {
+        std::ofstream file(json_path);
+        file << R"({"version": "1.0", "templates": {"/a": {"text": "A {x}", "description": "d",)"
+             << R"( "variables": ["x"], "extra": {"nested": [1, 2]}}, "/b": "B"},)"
+             << R"( "variables": {"x": "1"}, "settings": {"expansion_delay_ms": 7, "enable_logging": false}})";
+    }
+    ConfigManager loaded;
+    bool ok = loaded.LoadConfig(json_path);
+    assert(ok);
+    assert(loaded.GetTemplates().size() == 2);
+    assert(loaded.GetTemplates().at("/a").text == "A {x}");
+    assert(loaded.GetTemplates().at("/a").description == "d");
+    assert(loaded.GetTemplates().at("/a").variables == std::vector<std::string>{"x"});
+    assert(loaded.GetTemplates().at("/b").text == "B");
+    assert(loaded.GetVariables().size() == 1 && loaded.GetVariables().at("x") == "1");
+    assert(loaded.GetSettings().expansion_delay_ms == 7 && !loaded.GetSettings().enable_logging);
+    
+    // A malformed file leaves the previous configuration untouched
+    {
+        std::ofstream file(json_path);
+        file << R"({"templates": {"/c": {"text": 5}}})";
+    }
+    ok = loaded.LoadConfig(json_path);
+    assert(!ok);
+    assert(loaded.GetTemplates().count("/a") == 1);
+    std::filesystem::remove(json_path);
+    
+    // Line-delimited libraries: later lines replace earlier ones
+    const std::string lines_path = (dir / "crossexpand_test_templates.ndjson").string();
+    {
+        std::ofstream file(lines_path);
+        file << R"({"shortcut": "/hi", "text": "Hi {name}"})" << "\n\n"
+             << R"({"shortcut": "/bye", "text": "Bye"})" << "\n"
+             << R"({"shortcut": "/hi", "text": "Hello {name}"})" << "\n";
+    }
+    TemplateEngine engine;
+    size_t read = config.LoadTemplatesInto(lines_path, engine);
+    assert(read == 3);
+    assert(engine.GetTemplateCount() == 2);
+    assert(engine.Expand("/hi", {{"name", "Ann"}}) == "Hello Ann");
+    
+    // Large libraries are published in batches; a bad line keeps the batches before it
+    {
+        std::ofstream file(lines_path);
+        for (size_t i = 0; i < ConfigManager::LOAD_BATCH + 10; ++i) {
+            file << R"({"shortcut": "/n)" << i << R"(", "text": "N"})" << "\n";
+        }
+        file << "{broken\n";
+    }
+    TemplateEngine batched;
+    read = config.LoadTemplatesInto(lines_path, batched);
+    assert(read == ConfigManager::LOAD_BATCH);
+    assert(batched.HasTemplate("/n0") && !batched.HasTemplate("/n" + std::to_string(ConfigManager::LOAD_BATCH)));
+    
+    size_t seen = 0;
+    ok = config.LoadTemplates(lines_path, [&seen](std::string, Template) { return ++seen < 2; });
+    assert(ok);
+    assert(seen == 2);
+    
+    // Saving to a line-delimited path round-trips through the same loader
+    ok = loaded.SaveConfig(lines_path);
+    assert(ok);
+    ConfigManager reloaded;
+    ok = reloaded.LoadConfig(lines_path);
+    assert(ok);
+    assert(reloaded.GetTemplates().size() == 2 && reloaded.GetTemplates().at("/a").variables.size() == 1);
+    std::filesystem::remove(lines_path);
+    
     std::cout << "ConfigManager tests passed!" << std::endl;
 }
 
 int main() {
     try {
         TestTemplateEngine();
+        TestAdvancedTemplateEngine();
+        TestSnapshotReads();
+        TestParallelCompile();
+        TestSharedTemplateSource();
+        TestTemplateStore();
+        TestTimeFormatter();
+        TestThreadRandom();
+        TestContextChain();
+        TestEventQueueMpmc();
+        TestEventQueueWaitPop();
+        TestEventQueueBatch();
+        TestEventQueueScheduler();
+        TestEventQueueOverflow();
+        TestTriggerMatcher();
+        TestKeystrokeExpander();
+        TestKeystrokeExpanderRun();
+        TestStreamInjection();
         TestConfigManager();
         
         std::cout << "All tests passed!" << std::endl;